@@ -0,0 +1,232 @@
+// startup_harness.cpp
+//
+// Measures exec-to-ready latency of a dotenv program. For every .env size in
+// --sizes, a synthetic file is generated and the probe binary is spawned
+// --runs times. Each run is split into:
+//
+//   load    spawn -> first constructor of the probe (exec, dynamic loading,
+//           relocation, shared-library initializers)
+//   static  first constructor -> main (static initialization of the probe)
+//   parse   main -> dotenv::init returned
+//   total   spawn -> dotenv::init returned
+//
+// Probes that do not print startup_probe's timestamps (e.g. csv_reporter) are
+// measured from spawn to exit only.
+//
+// Usage:
+//   startup_harness [--probe PATH] [--runs N] [--sizes 10,100,1000]
+//                   [--slo-p99-us US]
+//
+// With --slo-p99-us the exit status is 1 if the p99 total of any size
+// exceeds the given budget, so the harness can gate CI.
+
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+extern char** environ;
+
+namespace {
+
+struct Options {
+    std::string probe = "./startup_probe";
+    int runs = 1000;
+    std::vector<int> sizes = {10, 100, 1000, 10000};
+    double slo_p99_us = 0.0;  // 0 = no SLO
+};
+
+struct Sample {
+    double load_us = 0.0;
+    double static_us = 0.0;
+    double parse_us = 0.0;
+    double total_us = 0.0;
+    bool breakdown = false;   // the probe printed its timestamps
+};
+
+long long now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<long long>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+bool parse_options(int argc, char** argv, Options& opts) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const std::string value = argv[++i];
+        if (arg == "--probe") {
+            opts.probe = value;
+        } else if (arg == "--runs") {
+            opts.runs = std::atoi(value.c_str());
+        } else if (arg == "--slo-p99-us") {
+            opts.slo_p99_us = std::atof(value.c_str());
+        } else if (arg == "--sizes") {
+            opts.sizes.clear();
+            std::istringstream ss(value);
+            std::string item;
+            while (std::getline(ss, item, ',')) {
+                opts.sizes.push_back(std::atoi(item.c_str()));
+            }
+        } else {
+            return false;
+        }
+    }
+    return opts.runs > 0 && !opts.sizes.empty();
+}
+
+// Writes an .env file with `lines` assignments; every tenth one references
+// the previous variable so that variable resolution is part of the cost.
+std::string write_env_file(int lines) {
+    const std::string path = "startup_harness_" + std::to_string(lines) + ".env";
+    std::ofstream out(path);
+    out << "# generated by startup_harness\n";
+    for (int i = 0; i < lines; ++i) {
+        out << "STARTUP_VAR_" << i << '=';
+        if (i > 0 && i % 10 == 0) {
+            out << "${STARTUP_VAR_" << (i - 1) << "}/nested";
+        } else {
+            out << "\"value-" << i << "-abcdefghijklmnopqrstuvwxyz\"";
+        }
+        out << '\n';
+    }
+    return path;
+}
+
+// Spawns the probe once. Returns false if it could not be run or failed.
+bool run_once(const Options& opts, const std::string& env_path, Sample& sample) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return false;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&actions, fds[0]);
+    posix_spawn_file_actions_addclose(&actions, fds[1]);
+
+    std::vector<char*> args = {const_cast<char*>(opts.probe.c_str()),
+                               const_cast<char*>(env_path.c_str()), nullptr};
+
+    pid_t pid = 0;
+    const long long spawn_ns = now_ns();
+    const int rc = posix_spawn(&pid, opts.probe.c_str(), &actions, nullptr,
+                               args.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+    if (rc != 0) {
+        close(fds[0]);
+        return false;
+    }
+
+    std::string output;
+    char buf[256];
+    ssize_t n = 0;
+    while ((n = read(fds[0], buf, sizeof(buf))) > 0) {
+        output.append(buf, static_cast<size_t>(n));
+    }
+    close(fds[0]);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    const long long exit_ns = now_ns();
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        return false;
+    }
+
+    long long loaded_ns = 0;
+    long long main_ns = 0;
+    long long ready_ns = 0;
+    std::istringstream ss(output);
+    if (ss >> loaded_ns >> main_ns >> ready_ns) {
+        sample.load_us   = (loaded_ns - spawn_ns) / 1000.0;
+        sample.static_us = (main_ns - loaded_ns) / 1000.0;
+        sample.parse_us  = (ready_ns - main_ns) / 1000.0;
+        sample.total_us  = (ready_ns - spawn_ns) / 1000.0;
+        sample.breakdown = true;
+    } else {
+        sample.total_us = (exit_ns - spawn_ns) / 1000.0;
+    }
+    return true;
+}
+
+double percentile(std::vector<double> values, double p) {
+    std::sort(values.begin(), values.end());
+    const auto rank = static_cast<std::size_t>(p * (values.size() - 1) + 0.5);
+    return values[rank];
+}
+
+void print_row(const std::string& phase, const std::vector<double>& values) {
+    std::cout << "  " << std::left << std::setw(8) << phase << std::right
+              << std::setw(12) << percentile(values, 0.50)
+              << std::setw(12) << percentile(values, 0.99) << "\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options opts;
+    if (!parse_options(argc, argv, opts)) {
+        std::cerr << "usage: " << argv[0]
+                  << " [--probe PATH] [--runs N] [--sizes 10,100,1000]"
+                     " [--slo-p99-us US]\n";
+        return 2;
+    }
+
+    bool slo_met = true;
+    std::cout << std::fixed << std::setprecision(1);
+
+    for (int size : opts.sizes) {
+        const std::string env_path = write_env_file(size);
+
+        std::vector<double> load, stat, parse, total;
+        bool breakdown = true;
+        for (int i = 0; i < opts.runs; ++i) {
+            Sample s;
+            if (!run_once(opts, env_path, s)) {
+                std::cerr << "[ERROR] Failed to run " << opts.probe << "\n";
+                std::remove(env_path.c_str());
+                return 1;
+            }
+            load.push_back(s.load_us);
+            stat.push_back(s.static_us);
+            parse.push_back(s.parse_us);
+            total.push_back(s.total_us);
+            breakdown = breakdown && s.breakdown;
+        }
+        std::remove(env_path.c_str());
+
+        std::cout << size << " variables, " << opts.runs << " runs (us)\n"
+                  << "  " << std::left << std::setw(8) << "phase" << std::right
+                  << std::setw(12) << "p50" << std::setw(12) << "p99" << "\n";
+        if (breakdown) {
+            print_row("load",   load);
+            print_row("static", stat);
+            print_row("parse",  parse);
+        } else {
+            std::cout << "  (no phase breakdown: the probe prints no timestamps)\n";
+        }
+        print_row("total",  total);
+
+        if (opts.slo_p99_us > 0.0 && percentile(total, 0.99) > opts.slo_p99_us) {
+            std::cout << "  SLO exceeded: p99 total > " << opts.slo_p99_us << " us\n";
+            slo_met = false;
+        }
+    }
+
+    return slo_met ? 0 : 1;
+}
@@ -0,0 +1,45 @@
+// startup_probe.cpp
+//
+// Smallest useful dotenv program, spawned repeatedly by startup_harness.
+// It loads the .env file named on the command line and prints three
+// CLOCK_MONOTONIC timestamps (ns) to stdout:
+//
+//   <first constructor> <entering main> <dotenv::init returned>
+//
+// Together with the harness' own timestamp taken just before spawning, these
+// split startup into dynamic loading, static initialization and parsing.
+
+#include <dotenv.h>
+
+#include <cstdio>
+#include <ctime>
+
+namespace {
+
+long long now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<long long>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+long long loaded_ns = 0;
+
+// Runs before all default-priority constructors of this executable, i.e.
+// right after the loader has mapped, relocated and initialized the shared
+// libraries.
+__attribute__((constructor(101))) void mark_loaded() {
+    loaded_ns = now_ns();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const long long main_ns = now_ns();
+
+    dotenv::init(argc > 1 ? argv[1] : ".env");
+
+    const long long ready_ns = now_ns();
+
+    std::printf("%lld %lld %lld\n", loaded_ns, main_ns, ready_ns);
+    return 0;
+}
@@ -0,0 +1,266 @@
+// csv_reporter_bench.cpp
+//
+// Google Benchmark suite for the report pipeline, on data from
+// data_generator.h with fixed seeds, so that two builds are compared on the
+// same bytes (across platforms only for uniform, zipf = 0, data).  Every
+// stage is measured on its own, with its input prepared outside the timed
+// loop, and then end to end:
+//
+//   ParseCsvContent      sales file -> CsvTable
+//   ParseSalesRows       CsvTable -> SalesRecord list
+//   ParseSalesBatch      CsvTable -> columnar SalesBatch
+//   JoinWithInventory    record and columnar joins; the columnar one also
+//                        over skewed product popularity (second argument:
+//                        Zipf exponent in tenths)
+//   FilterByAmount       record and columnar filters
+//   ComputeSummary       record and columnar summaries
+//   Pipeline             batch (parse, join, run_queries) and stream
+//                        (run_queries_stream) runs of two queries, also
+//                        over a file with 5% malformed rows
+//
+// The first argument is the number of sales rows.  Throughput is reported
+// in bytes of sales file per second.
+//
+// Usage:
+//   csv_reporter_bench [--benchmark_filter=REGEX] [--benchmark_repetitions=N]
+// Larger inputs are best generated with csv_reporter_datagen and timed
+// through csv_reporter itself.
+
+#include <benchmark/benchmark.h>
+
+#include "csv_parser.h"
+#include "data_generator.h"
+#include "diagnostics.h"
+#include "inventory_index.h"
+#include "reporter.h"
+
+#include <cstdint>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+constexpr std::uint32_t kProducts = 100000;
+constexpr double kMinAmount = 5000.0;
+
+struct Dataset {
+    std::string sales;
+    std::string inventory;
+};
+
+// Generated once per shape and kept for the rest of the run.
+const Dataset& dataset(std::int64_t rows, double zipf = 0.0, double malformed = 0.0) {
+    static std::map<std::tuple<std::int64_t, double, double>, Dataset> cache;
+    auto it = cache.find({rows, zipf, malformed});
+    if (it == cache.end()) {
+        DataSpec spec;
+        spec.sales_rows = static_cast<std::uint64_t>(rows);
+        spec.products = kProducts;
+        spec.zipf = zipf;
+        spec.malformed = malformed;
+        it = cache.emplace(std::make_tuple(rows, zipf, malformed),
+                           Dataset{generate_sales(spec), generate_inventory(spec)}).first;
+    }
+    return it->second;
+}
+
+// Counts malformed rows without writing any of them.
+struct QuietDiagnostics {
+    std::ostringstream sink;
+    Diagnostics diagnostics{sink, DiagnosticsLimits{0, 0.0}};
+};
+
+std::vector<SalesRecord> sales_records(const Dataset& data) {
+    QuietDiagnostics quiet;
+    return parse_sales_rows(parse_csv_content(data.sales, ','), quiet.diagnostics);
+}
+
+std::vector<InventoryRecord> inventory_records(const Dataset& data) {
+    QuietDiagnostics quiet;
+    return parse_inventory_rows(parse_csv_content(data.inventory, ','), quiet.diagnostics);
+}
+
+SalesBatch sales_batch(const Dataset& data) {
+    QuietDiagnostics quiet;
+    return parse_sales_batch(parse_csv_content(data.sales, ','), quiet.diagnostics);
+}
+
+const std::vector<Query>& two_queries() {
+    static const std::vector<Query> queries = {
+        {"large", kMinAmount, "json", ""},
+        {"by_product", 100.0, "json", "product_id"},
+    };
+    return queries;
+}
+
+void set_bytes(benchmark::State& state, const Dataset& data) {
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                            static_cast<std::int64_t>(data.sales.size()));
+}
+
+void Rows(benchmark::internal::Benchmark* b) {
+    b->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+}
+
+}  // namespace
+
+// ---------------------------------------------------------------------------
+// Parsing
+// ---------------------------------------------------------------------------
+
+static void BM_ParseCsvContent(benchmark::State& state) {
+    const Dataset& data = dataset(state.range(0));
+    for (auto _ : state) {
+        CsvTable table = parse_csv_content(data.sales, ',');
+        benchmark::DoNotOptimize(table);
+    }
+    set_bytes(state, data);
+}
+BENCHMARK(BM_ParseCsvContent)->Apply(Rows);
+
+static void BM_ParseSalesRows(benchmark::State& state) {
+    const Dataset& data = dataset(state.range(0));
+    const CsvTable table = parse_csv_content(data.sales, ',');
+    for (auto _ : state) {
+        QuietDiagnostics quiet;
+        auto rows = parse_sales_rows(table, quiet.diagnostics);
+        benchmark::DoNotOptimize(rows);
+    }
+    set_bytes(state, data);
+}
+BENCHMARK(BM_ParseSalesRows)->Apply(Rows);
+
+static void BM_ParseSalesBatch(benchmark::State& state) {
+    const Dataset& data = dataset(state.range(0));
+    const CsvTable table = parse_csv_content(data.sales, ',');
+    for (auto _ : state) {
+        QuietDiagnostics quiet;
+        SalesBatch batch = parse_sales_batch(table, quiet.diagnostics);
+        benchmark::DoNotOptimize(batch);
+    }
+    set_bytes(state, data);
+}
+BENCHMARK(BM_ParseSalesBatch)->Apply(Rows);
+
+// ---------------------------------------------------------------------------
+// Join, filter, summary
+// ---------------------------------------------------------------------------
+
+static void BM_JoinWithInventory(benchmark::State& state) {
+    const Dataset& data = dataset(state.range(0));
+    const auto sales = sales_records(data);
+    const auto inventory = inventory_records(data);
+    for (auto _ : state) {
+        auto joined = join_with_inventory(sales, inventory);
+        benchmark::DoNotOptimize(joined);
+    }
+    set_bytes(state, data);
+}
+BENCHMARK(BM_JoinWithInventory)->Apply(Rows);
+
+static void BM_JoinWithInventoryBatch(benchmark::State& state) {
+    const Dataset& data = dataset(state.range(0), static_cast<double>(state.range(1)) / 10.0);
+    const SalesBatch sales = sales_batch(data);
+    const InventoryIndex inventory(inventory_records(data));
+    for (auto _ : state) {
+        Selection selection = join_with_inventory(sales, inventory);
+        benchmark::DoNotOptimize(selection);
+    }
+    set_bytes(state, data);
+}
+BENCHMARK(BM_JoinWithInventoryBatch)
+    ->Args({100000, 0})->Args({1000000, 0})->Args({1000000, 11})
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_FilterByAmount(benchmark::State& state) {
+    const Dataset& data = dataset(state.range(0));
+    const auto joined = join_with_inventory(sales_records(data), inventory_records(data));
+    for (auto _ : state) {
+        auto filtered = filter_by_amount(joined, kMinAmount);
+        benchmark::DoNotOptimize(filtered);
+    }
+    set_bytes(state, data);
+}
+BENCHMARK(BM_FilterByAmount)->Apply(Rows);
+
+// Includes copying the join selection, which the filter overwrites.
+static void BM_FilterByAmountBatch(benchmark::State& state) {
+    const Dataset& data = dataset(state.range(0));
+    const SalesBatch sales = sales_batch(data);
+    const Selection joined = join_with_inventory(sales, inventory_records(data));
+    for (auto _ : state) {
+        Selection selection = joined;
+        filter_by_amount(sales, kMinAmount, selection);
+        benchmark::DoNotOptimize(selection);
+    }
+    set_bytes(state, data);
+}
+BENCHMARK(BM_FilterByAmountBatch)->Apply(Rows);
+
+static void BM_ComputeSummary(benchmark::State& state) {
+    const Dataset& data = dataset(state.range(0));
+    const auto joined = join_with_inventory(sales_records(data), inventory_records(data));
+    for (auto _ : state) {
+        Summary summary = compute_summary(joined);
+        benchmark::DoNotOptimize(summary);
+    }
+    set_bytes(state, data);
+}
+BENCHMARK(BM_ComputeSummary)->Apply(Rows);
+
+static void BM_ComputeSummaryBatch(benchmark::State& state) {
+    const Dataset& data = dataset(state.range(0));
+    const SalesBatch sales = sales_batch(data);
+    const Selection joined = join_with_inventory(sales, inventory_records(data));
+    for (auto _ : state) {
+        Summary summary = compute_summary(sales, joined);
+        benchmark::DoNotOptimize(summary);
+    }
+    set_bytes(state, data);
+}
+BENCHMARK(BM_ComputeSummaryBatch)->Apply(Rows);
+
+// ---------------------------------------------------------------------------
+// End to end, from file contents to query results
+// ---------------------------------------------------------------------------
+
+// Second argument: malformed rows in percent.
+static void BM_PipelineBatch(benchmark::State& state) {
+    const Dataset& data =
+        dataset(state.range(0), 0.0, static_cast<double>(state.range(1)) / 100.0);
+    for (auto _ : state) {
+        QuietDiagnostics quiet;
+        const InventoryIndex inventory(
+            parse_inventory_rows(parse_csv_content(data.inventory, ','), quiet.diagnostics));
+        const SalesBatch sales = parse_sales_batch(parse_csv_content(data.sales, ','),
+                                                   quiet.diagnostics, 100.0);
+        auto results = run_queries(sales, join_with_inventory(sales, inventory), two_queries());
+        benchmark::DoNotOptimize(results);
+    }
+    set_bytes(state, data);
+}
+BENCHMARK(BM_PipelineBatch)
+    ->Args({100000, 0})->Args({1000000, 0})->Args({1000000, 5})
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_PipelineStream(benchmark::State& state) {
+    const Dataset& data =
+        dataset(state.range(0), 0.0, static_cast<double>(state.range(1)) / 100.0);
+    for (auto _ : state) {
+        QuietDiagnostics quiet;
+        const InventoryIndex inventory(
+            parse_inventory_rows(parse_csv_content(data.inventory, ','), quiet.diagnostics));
+        auto results = run_queries_stream(data.sales, ',', inventory, two_queries(),
+                                          quiet.diagnostics);
+        benchmark::DoNotOptimize(results);
+    }
+    set_bytes(state, data);
+}
+BENCHMARK(BM_PipelineStream)
+    ->Args({100000, 0})->Args({1000000, 0})->Args({1000000, 5})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,265 @@
+#include "data_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace {
+
+// Output is flushed to the stream in blocks of this size.
+constexpr std::size_t kFlushBytes = std::size_t{1} << 20;
+
+// splitmix64: small, fast, and fully specified, unlike the distributions
+// of <random>, whose output differs between standard libraries.
+class Random {
+public:
+    explicit Random(std::uint64_t seed) : state_(seed) {}
+
+    std::uint64_t next() {
+        std::uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform in [0, 1).
+    double uniform() { return static_cast<double>(next() >> 11) * 0x1.0p-53; }
+
+    // Uniform in [0, n).
+    std::uint64_t below(std::uint64_t n) { return next() % n; }
+
+private:
+    std::uint64_t state_;
+};
+
+std::uint64_t mix(std::uint64_t x) {
+    return Random(x).next();
+}
+
+// Draws ranks 1..n with P(k) proportional to 1 / k^s in constant time, by
+// rejection-inversion (Hormann and Derflinger, "Rejection-inversion to
+// generate variates from monotone discrete distributions", 1996).
+class ZipfSampler {
+public:
+    ZipfSampler(std::uint64_t n, double s)
+        : n_(n),
+          s_(s),
+          h_integral_x1_(h_integral(1.5) - 1.0),
+          h_integral_n_(h_integral(static_cast<double>(n) + 0.5)),
+          threshold_(2.0 - h_integral_inverse(h_integral(2.5) - h(2.0))) {}
+
+    std::uint64_t operator()(Random& random) const {
+        if (s_ == 0.0) {
+            return 1 + random.below(n_);
+        }
+        for (;;) {
+            const double u = h_integral_n_ + random.uniform() * (h_integral_x1_ - h_integral_n_);
+            const double x = h_integral_inverse(u);
+            const double k = std::min(std::max(std::floor(x + 0.5), 1.0),
+                                      static_cast<double>(n_));
+            if (k - x <= threshold_ || u >= h_integral(k + 0.5) - h(k)) {
+                return static_cast<std::uint64_t>(k);
+            }
+        }
+    }
+
+private:
+    double h(double x) const { return std::exp(-s_ * std::log(x)); }
+
+    double h_integral(double x) const {
+        const double log_x = std::log(x);
+        return expm1_over((1.0 - s_) * log_x) * log_x;
+    }
+
+    double h_integral_inverse(double x) const {
+        double t = x * (1.0 - s_);
+        if (t < -1.0) {
+            t = -1.0;   // rounding near the lower end
+        }
+        return std::exp(log1p_over(t) * x);
+    }
+
+    // expm1(x) / x and log1p(x) / x, continuous at 0.
+    static double expm1_over(double x) {
+        return std::abs(x) > 1e-8 ? std::expm1(x) / x : 1.0 + x / 2.0 * (1.0 + x / 3.0);
+    }
+    static double log1p_over(double x) {
+        return std::abs(x) > 1e-8 ? std::log1p(x) / x : 1.0 - x * (0.5 - x / 3.0);
+    }
+
+    std::uint64_t n_;
+    double s_;
+    double h_integral_x1_;
+    double h_integral_n_;
+    double threshold_;
+};
+
+// Product IDs: "P" and the product code, zero-padded to at least five
+// digits.
+class ProductIds {
+public:
+    explicit ProductIds(std::uint32_t products) {
+        int digits = 1;
+        for (std::uint32_t n = products - 1; n >= 10; n /= 10) {
+            ++digits;
+        }
+        width_ = std::max(width_, digits);
+    }
+
+    void append(std::string& out, std::uint32_t code) const {
+        char digits[16];
+        for (int i = width_ - 1; i >= 0; --i) {
+            digits[i] = static_cast<char>('0' + code % 10);
+            code /= 10;
+        }
+        out += 'P';
+        out.append(digits, static_cast<std::size_t>(width_));
+    }
+
+private:
+    int width_ = 5;
+};
+
+// Rank r of the popularity order is product code (r * stride) mod n, so
+// the hot products are spread over the ID range and the inventory.
+std::uint64_t scatter_stride(std::uint64_t n) {
+    std::uint64_t stride = 2654435761ULL % n;
+    while (n > 1 && std::gcd(stride, n) != 1) {
+        ++stride;
+    }
+    return stride == 0 ? 1 : stride;
+}
+
+bool in_inventory(const DataSpec& spec, std::uint32_t code) {
+    return static_cast<double>(mix(spec.seed ^ (std::uint64_t{code} << 20)) >> 11) * 0x1.0p-53 <
+           spec.in_inventory;
+}
+
+void append_number(std::string& out, std::uint64_t value, int width) {
+    char digits[24];
+    int n = 0;
+    do {
+        digits[n++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    for (; n < width; ++n) {
+        digits[n] = '0';
+    }
+    while (n > 0) {
+        out += digits[--n];
+    }
+}
+
+// Writes rows through buffer, handing it to flush, which empties it,
+// whenever it grows past flush_at bytes.
+template <class Flush>
+std::uint64_t sales_rows(const DataSpec& spec, std::string& buffer, std::size_t flush_at,
+                         Flush&& flush) {
+    const std::uint32_t products = std::max<std::uint32_t>(spec.products, 1);
+    const ProductIds ids(products);
+    const ZipfSampler popularity(products, spec.zipf);
+    const std::uint64_t stride = scatter_stride(products);
+    Random random(mix(spec.seed));
+
+    const char d = spec.delimiter;
+    buffer += "order_id";
+    buffer += d;
+    buffer += "product_id";
+    buffer += d;
+    buffer += "amount\n";
+
+    std::uint64_t flushed = 0;
+    std::uint64_t rows = 0;
+    while (spec.sales_bytes != 0 ? flushed + buffer.size() < spec.sales_bytes
+                                 : rows < spec.sales_rows) {
+        const std::uint64_t rank = popularity(random) - 1;
+        const auto code = static_cast<std::uint32_t>(rank * stride % products);
+        buffer += 'O';
+        append_number(buffer, rows, 10);
+        buffer += d;
+        ids.append(buffer, code);
+
+        const std::uint64_t cents = 1 + random.below(999999);
+        if (spec.malformed > 0.0 && random.uniform() < spec.malformed) {
+            if (random.next() & 1) {
+                buffer += d;
+                buffer += "n/a";
+            }
+        } else {
+            buffer += d;
+            append_number(buffer, cents / 100, 1);
+            buffer += '.';
+            append_number(buffer, cents % 100, 2);
+        }
+        buffer += '\n';
+        ++rows;
+
+        if (buffer.size() >= flush_at) {
+            flushed += buffer.size();
+            flush(buffer);
+        }
+    }
+    return rows;
+}
+
+std::uint64_t inventory_rows(const DataSpec& spec, std::string& buffer) {
+    const std::uint32_t products = std::max<std::uint32_t>(spec.products, 1);
+    const ProductIds ids(products);
+    Random random(mix(spec.seed + 1));
+
+    buffer += "product_id";
+    buffer += spec.delimiter;
+    buffer += "stock_qty\n";
+
+    std::uint64_t rows = 0;
+    for (std::uint32_t code = 0; code < products; ++code) {
+        if (!in_inventory(spec, code)) {
+            continue;
+        }
+        ids.append(buffer, code);
+        if (spec.malformed > 0.0 && random.uniform() < spec.malformed) {
+            if (random.next() & 1) {
+                buffer += spec.delimiter;
+                buffer += "n/a";
+            }
+        } else {
+            buffer += spec.delimiter;
+            append_number(buffer, random.below(1000), 1);
+        }
+        buffer += '\n';
+        ++rows;
+    }
+    return rows;
+}
+
+}  // namespace
+
+std::uint64_t write_sales(const DataSpec& spec, std::ostream& out) {
+    std::string buffer;
+    buffer.reserve(kFlushBytes + 256);
+    const std::uint64_t rows = sales_rows(spec, buffer, kFlushBytes, [&](std::string& full) {
+        out.write(full.data(), static_cast<std::streamsize>(full.size()));
+        full.clear();
+    });
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    return rows;
+}
+
+std::uint64_t write_inventory(const DataSpec& spec, std::ostream& out) {
+    std::string buffer;
+    const std::uint64_t rows = inventory_rows(spec, buffer);
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    return rows;
+}
+
+std::string generate_sales(const DataSpec& spec) {
+    std::string content;
+    sales_rows(spec, content, std::string::npos, [](std::string&) {});
+    return content;
+}
+
+std::string generate_inventory(const DataSpec& spec) {
+    std::string content;
+    inventory_rows(spec, content);
+    return content;
+}
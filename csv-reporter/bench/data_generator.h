@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Shape of a synthetic SALES_FILE / INVENTORY_FILE pair.  The same spec
+// always produces the same bytes with the same build, so a benchmark run on
+// generated data can be repeated exactly.  Only with zipf = 0 is that also
+// true across platforms: the skewed sampler goes through exp and log, whose
+// last bits the C library may round differently.
+struct DataSpec {
+    std::uint64_t seed = 1;
+    std::uint64_t sales_rows = 100000;   // data rows, without the header
+    std::uint64_t sales_bytes = 0;       // if set, write rows until the file
+                                         // reaches this size instead
+    std::uint32_t products = 10000;      // distinct product IDs sold
+    double zipf = 0.0;                   // popularity skew; 0 = uniform
+    double in_inventory = 0.9;           // share of the products in the inventory
+    double malformed = 0.0;              // share of malformed rows in each file
+    char delimiter = ',';
+};
+
+// Writes the sales file: an order_id, product_id, amount header, then rows
+// with sequential order IDs, products drawn from a Zipf distribution over
+// spec.products IDs (the most popular ones scattered over the ID range) and
+// amounts between 0.01 and 9999.99.  A spec.malformed share of the rows
+// lacks its amount or has an invalid one.  Returns the number of data rows.
+std::uint64_t write_sales(const DataSpec& spec, std::ostream& out);
+
+// Writes the matching inventory file: a product_id, stock_qty header and a
+// row for about spec.in_inventory of the products, in ID order.  A
+// spec.malformed share of them lacks its stock_qty or has an invalid one.
+// Returns the number of data rows.
+std::uint64_t write_inventory(const DataSpec& spec, std::ostream& out);
+
+// The same files in memory.
+std::string generate_sales(const DataSpec& spec);
+std::string generate_inventory(const DataSpec& spec);
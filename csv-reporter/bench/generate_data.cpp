@@ -0,0 +1,201 @@
+// generate_data.cpp
+//
+// Writes a synthetic SALES_FILE / INVENTORY_FILE pair (data_generator.h),
+// from a few MB to tens of GB.  The same options always produce the same
+// files, so measurements on them can be repeated; with --zipf 0 they are
+// also the same bytes on any platform (see data_generator.h).  Malformed
+// or conflicting options print the usage and exit with status 1.
+//
+// Usage:
+//   csv_reporter_datagen [--sales PATH] [--inventory PATH]
+//                        [--rows N | --size BYTES[K|M|G]] [--products N]
+//                        [--zipf S] [--in-inventory FRACTION]
+//                        [--malformed FRACTION] [--delimiter C|tab]
+//                        [--seed N]
+//
+// For example, 10 GB of sales over a million products with a hot head:
+//   csv_reporter_datagen --sales sales.csv --inventory inventory.csv
+//                        --size 10G --products 1000000 --zipf 1.1
+
+#include "data_generator.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace {
+
+struct Options {
+    std::string sales_path;
+    std::string inventory_path;
+    DataSpec spec;
+};
+
+// The decimal digits at the start of text, at most max; digits_end is set to
+// the first character after them.  No sign, blank or overflow is accepted.
+bool parse_digits(const std::string& text, std::uint64_t max, std::uint64_t& value,
+                  std::size_t& digits_end) {
+    value = 0;
+    digits_end = 0;
+    while (digits_end < text.size() && text[digits_end] >= '0' && text[digits_end] <= '9') {
+        const std::uint64_t digit = static_cast<std::uint64_t>(text[digits_end] - '0');
+        if (value > (max - digit) / 10) {
+            return false;
+        }
+        value = value * 10 + digit;
+        ++digits_end;
+    }
+    return digits_end > 0;
+}
+
+// "0" .. max, nothing else.
+bool parse_count(const std::string& text, std::uint64_t max, std::uint64_t& value) {
+    std::size_t end = 0;
+    return parse_digits(text, max, value, end) && end == text.size();
+}
+
+// "1500", "64K", "500M", "20G": a byte count with an optional binary suffix.
+bool parse_size(const std::string& text, std::uint64_t& bytes) {
+    std::uint64_t value = 0;
+    std::size_t end = 0;
+    if (!parse_digits(text, UINT64_MAX, value, end)) {
+        return false;
+    }
+    const std::string suffix = text.substr(end);
+    int shift = 0;
+    if (suffix == "K" || suffix == "k") {
+        shift = 10;
+    } else if (suffix == "M" || suffix == "m") {
+        shift = 20;
+    } else if (suffix == "G" || suffix == "g") {
+        shift = 30;
+    } else if (!suffix.empty()) {
+        return false;
+    }
+    if (value > (UINT64_MAX >> shift)) {
+        return false;
+    }
+    bytes = value << shift;
+    return bytes > 0;
+}
+
+bool parse_fraction(const std::string& text, double& value) {
+    char* end = nullptr;
+    value = std::strtod(text.c_str(), &end);
+    return end != text.c_str() && *end == '\0' && value >= 0.0 && value <= 1.0;
+}
+
+// A finite, non-negative Zipf exponent.
+bool parse_zipf(const std::string& text, double& value) {
+    char* end = nullptr;
+    value = std::strtod(text.c_str(), &end);
+    return end != text.c_str() && *end == '\0' && std::isfinite(value) && value >= 0.0;
+}
+
+bool parse_options(int argc, char** argv, Options& opts) {
+    bool rows_given = false;
+    bool size_given = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const std::string value = argv[++i];
+        if (arg == "--sales") {
+            opts.sales_path = value;
+        } else if (arg == "--inventory") {
+            opts.inventory_path = value;
+        } else if (arg == "--rows") {
+            if (!parse_count(value, UINT64_MAX, opts.spec.sales_rows)) {
+                return false;
+            }
+            rows_given = true;
+        } else if (arg == "--size") {
+            if (!parse_size(value, opts.spec.sales_bytes)) {
+                return false;
+            }
+            size_given = true;
+        } else if (arg == "--products") {
+            std::uint64_t products = 0;
+            if (!parse_count(value, UINT32_MAX, products) || products == 0) {
+                return false;
+            }
+            opts.spec.products = static_cast<std::uint32_t>(products);
+        } else if (arg == "--zipf") {
+            if (!parse_zipf(value, opts.spec.zipf)) {
+                return false;
+            }
+        } else if (arg == "--in-inventory") {
+            if (!parse_fraction(value, opts.spec.in_inventory)) {
+                return false;
+            }
+        } else if (arg == "--malformed") {
+            if (!parse_fraction(value, opts.spec.malformed)) {
+                return false;
+            }
+        } else if (arg == "--delimiter") {
+            if (value == "tab") {
+                opts.spec.delimiter = '\t';
+            } else if (value.size() == 1 && value != "\n") {
+                opts.spec.delimiter = value[0];
+            } else {
+                return false;
+            }
+        } else if (arg == "--seed") {
+            if (!parse_count(value, UINT64_MAX, opts.spec.seed)) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    // --rows and --size both set the length of the sales file
+    return (!opts.sales_path.empty() || !opts.inventory_path.empty()) &&
+           !(rows_given && size_given);
+}
+
+// Writes one file with write.  Returns false if it cannot be written.
+template <class Write>
+bool write_file(const std::string& path, const char* what, Write&& write) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "[ERROR] Cannot open " << path << "\n";
+        return false;
+    }
+    const std::uint64_t rows = write(out);
+    out.close();
+    if (!out) {
+        std::cerr << "[ERROR] Cannot write " << path << "\n";
+        return false;
+    }
+    std::cout << path << ": " << rows << " " << what << " rows\n";
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options opts;
+    if (!parse_options(argc, argv, opts)) {
+        std::cerr << "usage: " << argv[0]
+                  << " [--sales PATH] [--inventory PATH] [--rows N | --size BYTES[K|M|G]]"
+                     " [--products N] [--zipf S] [--in-inventory FRACTION]"
+                     " [--malformed FRACTION] [--delimiter C|tab] [--seed N]\n";
+        return 1;
+    }
+
+    if (!opts.sales_path.empty() &&
+        !write_file(opts.sales_path, "sales",
+                    [&](std::ostream& out) { return write_sales(opts.spec, out); })) {
+        return 1;
+    }
+    if (!opts.inventory_path.empty() &&
+        !write_file(opts.inventory_path, "inventory",
+                    [&](std::ostream& out) { return write_inventory(opts.spec, out); })) {
+        return 1;
+    }
+    return 0;
+}
@@ -1,7 +1,10 @@
 #include "config.h"
+#include "csv_parser.h"
+#include "mapped_file.h"
 
 #include <dotenv.h>
 #include <fstream>
+#include <utility>
 
 std::variant<Config, std::string> validate_config(
     const std::string& sales_file,
@@ -26,9 +29,7 @@ std::variant<Config, std::string> validate_config(
     config.delimiter = delimiter_str.empty() ? ',' : delimiter_str[0];
 
     // AC-S4: MIN_AMOUNT must be a valid number
-    try {
-        config.min_amount = std::stod(min_amount_str);
-    } catch (...) {
+    if (!parse_double(min_amount_str, config.min_amount)) {
         return "[ERROR] Invalid value for MIN_AMOUNT: '" + min_amount_str +
                "' is not a valid number.";
     }
@@ -43,6 +44,119 @@ std::variant<Config, std::string> validate_config(
     return config;
 }
 
+std::variant<Config, std::string> apply_options(
+    Config config,
+    const ConfigOptions& options) {
+
+    if (options.execution_mode != "batch" && options.execution_mode != "stream") {
+        return "[ERROR] Unsupported EXECUTION_MODE: '" + options.execution_mode +
+               "'. Supported values: batch, stream.";
+    }
+    config.execution_mode = options.execution_mode;
+
+    if (!options.group_by.empty() && options.group_by != "product_id") {
+        return "[ERROR] Unsupported OUTPUT_GROUP_BY: '" + options.group_by +
+               "'. Supported values: product_id.";
+    }
+    config.group_by = options.group_by;
+    config.query_file = options.query_file;
+
+    if (options.inventory_index != "off" && options.inventory_index != "on") {
+        return "[ERROR] Unsupported INVENTORY_INDEX: '" + options.inventory_index +
+               "'. Supported values: off, on.";
+    }
+    config.inventory_index = options.inventory_index == "on";
+    if (options.sales_cache != "off" && options.sales_cache != "on") {
+        return "[ERROR] Unsupported SALES_CACHE: '" + options.sales_cache +
+               "'. Supported values: off, on.";
+    }
+    config.sales_cache = options.sales_cache == "on";
+    config.checkpoint_file = options.checkpoint_file;
+    if (options.sales_append_only != "off" && options.sales_append_only != "on") {
+        return "[ERROR] Unsupported SALES_APPEND_ONLY: '" + options.sales_append_only +
+               "'. Supported values: off, on.";
+    }
+    config.sales_append_only = options.sales_append_only == "on";
+    config.serve_socket = options.serve_socket;
+
+    if (options.warn_samples == "all") {
+        config.warn_limits.max_samples = DiagnosticsLimits{}.max_samples;
+    } else {
+        int samples = 0;
+        if (!parse_int(options.warn_samples, samples) || samples < 0) {
+            return "[ERROR] Invalid value for WARN_SAMPLES: '" + options.warn_samples +
+                   "' is not a non-negative integer or 'all'.";
+        }
+        config.warn_limits.max_samples = static_cast<std::size_t>(samples);
+    }
+    if (!parse_double(options.warn_rate, config.warn_limits.max_per_second) ||
+        !(config.warn_limits.max_per_second >= 0.0)) {
+        return "[ERROR] Invalid value for WARN_RATE: '" + options.warn_rate +
+               "' is not a non-negative number.";
+    }
+    config.warn_summary_file = options.warn_summary_file;
+
+    return config;
+}
+
+std::variant<std::vector<Query>, std::string> load_queries(
+    const std::string& path) {
+
+    MappedFile file;
+    if (!file.open(path)) {
+        return "[ERROR] Cannot open QUERY_FILE: " + path;
+    }
+    const CsvTable table = parse_csv_content(file.view(), ',');
+
+    if (table.size() == 0 || table.field_count(0) < 3 ||
+        table.field(0, 0) != "name" || table.field(0, 1) != "min_amount" ||
+        table.field(0, 2) != "output_format" ||
+        (table.field_count(0) > 3 && table.field(0, 3) != "group_by")) {
+        return "[ERROR] QUERY_FILE must start with the header "
+               "name,min_amount,output_format[,group_by].";
+    }
+
+    std::vector<Query> queries;
+    for (std::size_t r = 1; r < table.size(); ++r) {
+        const std::string where =
+            " at line " + std::to_string(table.line_number(r)) + " of QUERY_FILE";
+        if (table.field_count(r) < 3) {
+            return "[ERROR] Missing columns" + where + ".";
+        }
+        Query q;
+        q.name = std::string(table.field(r, 0));
+        const std::string min_amount_str(table.field(r, 1));
+        if (!parse_double(min_amount_str, q.min_amount)) {
+            return "[ERROR] Invalid min_amount" + where + ": '" + min_amount_str +
+                   "' is not a valid number.";
+        }
+        q.output_format = std::string(table.field(r, 2));
+        if (q.output_format != "json" && q.output_format != "csv") {
+            return "[ERROR] Unsupported output_format" + where + ": '" +
+                   q.output_format + "'. Supported values: json, csv.";
+        }
+        if (table.field_count(r) > 3) {
+            q.group_by = std::string(table.field(r, 3));
+        }
+        if (!q.group_by.empty() && q.group_by != "product_id") {
+            return "[ERROR] Unsupported group_by" + where + ": '" + q.group_by +
+                   "'. Supported values: product_id.";
+        }
+        queries.push_back(std::move(q));
+    }
+    if (queries.empty()) {
+        return "[ERROR] QUERY_FILE contains no queries: " + path;
+    }
+    return queries;
+}
+
+std::vector<Query> report_queries(const Config& config) {
+    if (!config.queries.empty()) {
+        return config.queries;
+    }
+    return {{"", config.min_amount, config.output_format, config.group_by}};
+}
+
 std::variant<Config, std::string> load_config(const std::string& env_file) {
     // AC-S1: .env file must exist
     {
@@ -57,9 +171,35 @@ std::variant<Config, std::string> load_config(const std::string& env_file) {
     const auto sales_file       = dotenv::getenv("SALES_FILE", "");
     const auto inventory_file   = dotenv::getenv("INVENTORY_FILE", "");
     const auto delimiter_str    = dotenv::getenv("DELIMITER", "");
-    const auto min_amount_str   = dotenv::getenv("MIN_AMOUNT", "");
     const auto output_format_str = dotenv::getenv("OUTPUT_FORMAT", "json");
+    const auto query_file       = dotenv::getenv("QUERY_FILE", "");
+    // The queries of a QUERY_FILE carry their own thresholds.
+    const auto min_amount_str   = dotenv::getenv("MIN_AMOUNT", query_file.empty() ? "" : "0");
 
-    return validate_config(sales_file, inventory_file, delimiter_str,
-                           min_amount_str, output_format_str);
+    auto result = validate_config(sales_file, inventory_file, delimiter_str,
+                                  min_amount_str, output_format_str);
+    if (auto* config = std::get_if<Config>(&result)) {
+        ConfigOptions options;
+        options.execution_mode    = dotenv::getenv("EXECUTION_MODE", "batch");
+        options.group_by          = dotenv::getenv("OUTPUT_GROUP_BY", "");
+        options.query_file        = query_file;
+        options.inventory_index   = dotenv::getenv("INVENTORY_INDEX", "off");
+        options.sales_cache       = dotenv::getenv("SALES_CACHE", "off");
+        options.checkpoint_file   = dotenv::getenv("CHECKPOINT_FILE", "");
+        options.sales_append_only = dotenv::getenv("SALES_APPEND_ONLY", "off");
+        options.serve_socket      = dotenv::getenv("SERVE_SOCKET", "csv_reporter.sock");
+        options.warn_samples      = dotenv::getenv("WARN_SAMPLES", "20");
+        options.warn_rate         = dotenv::getenv("WARN_RATE", "0");
+        options.warn_summary_file = dotenv::getenv("WARN_SUMMARY_FILE", "");
+        result = apply_options(std::move(*config), options);
+    }
+    auto* config = std::get_if<Config>(&result);
+    if (config && !config->query_file.empty()) {
+        auto queries = load_queries(config->query_file);
+        if (auto* err = std::get_if<std::string>(&queries)) {
+            return *err;
+        }
+        config->queries = std::move(std::get<std::vector<Query>>(queries));
+    }
+    return result;
 }
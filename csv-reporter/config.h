@@ -1,7 +1,11 @@
 #pragma once
 
+#include "diagnostics.h"
+#include "query.h"
+
 #include <string>
 #include <variant>
+#include <vector>
 
 struct Config {
     std::string sales_file;
@@ -9,8 +13,61 @@ struct Config {
     char delimiter = ',';
     double min_amount = 0.0;
     std::string output_format = "json";
+    std::string execution_mode = "batch";
+    std::string group_by;   // "" (one summary) or "product_id"
+    std::string query_file;
+    std::vector<Query> queries;   // loaded from query_file, if set
+    bool inventory_index = false; // keep a join index next to inventory_file
+    bool sales_cache = false;     // keep parsed sales columns next to sales_file
+    std::string checkpoint_file;  // incremental runs over an appended sales_file
+    bool sales_append_only = false;   // trust sales_file to only ever grow in place
+    std::string serve_socket = "csv_reporter.sock";   // for --serve
+    DiagnosticsLimits warn_limits{20, 0.0};   // malformed-row warnings per input file
+    std::string warn_summary_file;            // JSON counts of skipped rows, if set
+};
+
+// Raw values of the optional .env settings, as returned by dotenv::getenv
+// with their defaults applied.
+struct ConfigOptions {
+    std::string execution_mode = "batch";
+    std::string group_by;
+    std::string query_file;
+    std::string inventory_index = "off";
+    std::string sales_cache = "off";
+    std::string checkpoint_file;
+    std::string sales_append_only = "off";
+    std::string serve_socket = "csv_reporter.sock";
+    std::string warn_samples = "20";
+    std::string warn_rate = "0";
+    std::string warn_summary_file;
 };
 
+// Validates the optional settings and stores them in config.  Returns the
+// updated Config or an "[ERROR] ..." message string.
+// EXECUTION_MODE must be "batch" (materialize every stage) or "stream"
+// (single pass over the sales file with constant memory).
+// OUTPUT_GROUP_BY must be empty or "product_id" (one summary per product).
+// QUERY_FILE is stored as given; load_config reads it with load_queries.
+// INVENTORY_INDEX must be "off" or "on" (reuse the join index saved next to
+// INVENTORY_FILE while that file is unchanged).
+// SALES_CACHE must be "off" or "on" (batch runs reuse the parsed columns
+// saved next to SALES_FILE while that file is unchanged).
+// CHECKPOINT_FILE is stored as given; when set, each run only reads the
+// sales rows appended since the previous one.
+// SALES_APPEND_ONLY must be "off" or "on" (with CHECKPOINT_FILE or --serve,
+// trust SALES_FILE not to be edited in place while it keeps its inode, and
+// check only the bytes just before the checkpoint instead of all of them).
+// SERVE_SOCKET is the Unix domain socket path of csv_reporter --serve.
+// WARN_SAMPLES must be a non-negative integer or "all": how many malformed
+// rows of each input file are reported line by line; the rest are counted.
+// WARN_RATE must be a non-negative number of such warnings per second
+// (0 = no limit).
+// WARN_SUMMARY_FILE is stored as given; when set, the counts of skipped
+// rows are written there as JSON.
+std::variant<Config, std::string> apply_options(
+    Config config,
+    const ConfigOptions& options);
+
 // Validates raw string values obtained from environment variables.
 // Returns a Config on success or an "[ERROR] ..." message string on failure.
 // AC-S4: min_amount_str must be a valid number.
@@ -23,8 +80,21 @@ std::variant<Config, std::string> validate_config(
     const std::string& min_amount_str,
     const std::string& output_format_str);
 
+// Reads a query file: CSV with a name,min_amount,output_format header and an
+// optional fourth group_by column, one query per row.  Each row is validated
+// like the corresponding .env settings.  Returns the queries in file order
+// or an "[ERROR] ..." message string.
+std::variant<std::vector<Query>, std::string> load_queries(
+    const std::string& path);
+
+// The reports a run produces: the queries of the QUERY_FILE, or else one
+// query from the MIN_AMOUNT, OUTPUT_FORMAT and OUTPUT_GROUP_BY settings.
+std::vector<Query> report_queries(const Config& config);
+
 // Loads configuration by reading the given .env file via dotenv, then calls
-// validate_config.  Returns error string on any failure.
+// validate_config and apply_options, and load_queries if QUERY_FILE is set.
+// With a QUERY_FILE, MIN_AMOUNT may be omitted: the queries bring their
+// own.  Returns error string on any failure.
 // AC-S1: returns error if env_file does not exist.
 std::variant<Config, std::string> load_config(
     const std::string& env_file = ".env");
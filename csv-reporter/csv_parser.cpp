@@ -1,30 +1,477 @@
 #include "csv_parser.h"
 
-#include <sstream>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <thread>
 
-std::vector<IndexedRow> parse_csv_content(const std::string& content,
-                                          char delimiter) {
-    std::vector<IndexedRow> result;
-    std::istringstream stream(content);
-    std::string line;
-    int line_num = 0;
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
-    while (std::getline(stream, line)) {
-        ++line_num;
-        // Strip trailing CR (Windows CRLF)
-        if (!line.empty() && line.back() == '\r') {
-            line.pop_back();
+namespace {
+
+constexpr std::size_t kBlockSize = 64;
+
+// Inputs are only split across threads in pieces at least this large.
+constexpr std::size_t kMinChunkBytes = std::size_t{1} << 20;
+
+// LineIndex counts newlines in blocks of this size.
+constexpr std::size_t kLineBlockBytes = std::size_t{1} << 16;
+
+// Bit i of each mask is set when byte i of a 64-byte block is a newline or
+// the delimiter, respectively.
+struct BlockMasks {
+    std::uint64_t newline = 0;
+    std::uint64_t delimiter = 0;
+};
+
+// Scalar fallback, also used for the final partial block.
+BlockMasks scan_bytes(const char* p, std::size_t n, char delimiter) {
+    BlockMasks m;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (p[i] == '\n') {
+            m.newline |= std::uint64_t{1} << i;
+        } else if (p[i] == delimiter) {
+            m.delimiter |= std::uint64_t{1} << i;
+        }
+    }
+    return m;
+}
+
+inline BlockMasks scan_block(const char* p, char delimiter) {
+    BlockMasks m;
+#if defined(__AVX2__)
+    const __m256i nl = _mm256_set1_epi8('\n');
+    const __m256i dl = _mm256_set1_epi8(delimiter);
+    const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+    auto mask = [](__m256i bytes, __m256i needle) {
+        return static_cast<std::uint64_t>(static_cast<std::uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, needle))));
+    };
+    m.newline   = mask(lo, nl) | (mask(hi, nl) << 32);
+    m.delimiter = mask(lo, dl) | (mask(hi, dl) << 32);
+#elif defined(__SSE2__)
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i dl = _mm_set1_epi8(delimiter);
+    for (int k = 0; k < 4; ++k) {
+        const __m128i bytes =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * k));
+        const auto n = static_cast<std::uint64_t>(static_cast<std::uint16_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, nl))));
+        const auto d = static_cast<std::uint64_t>(static_cast<std::uint16_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, dl))));
+        m.newline   |= n << (16 * k);
+        m.delimiter |= d << (16 * k);
+    }
+#else
+    m = scan_bytes(p, kBlockSize, delimiter);
+#endif
+    // A newline delimiter would be meaningless; newlines take precedence.
+    m.delimiter &= ~m.newline;
+    return m;
+}
+
+inline unsigned popcount(std::uint64_t bits) {
+#if defined(_MSC_VER)
+    return static_cast<unsigned>(__popcnt64(bits));
+#else
+    return static_cast<unsigned>(__builtin_popcountll(bits));
+#endif
+}
+
+// Counts newlines and delimiters so the table can be sized exactly up front;
+// this pass runs at memory bandwidth and saves repeated regrowth of the
+// field array, which otherwise dominates for large inputs.
+void reserve_for(CsvTable& table, const char* base, std::size_t size, char delimiter) {
+    std::size_t newlines = 0;
+    std::size_t delimiters = 0;
+    for (std::size_t block = 0; block < size; block += kBlockSize) {
+        const BlockMasks m = (size - block >= kBlockSize)
+            ? scan_block(base + block, delimiter)
+            : scan_bytes(base + block, size - block, delimiter);
+        newlines   += popcount(m.newline);
+        delimiters += popcount(m.delimiter);
+    }
+    table.fields.reserve(newlines + delimiters + 1);
+    table.row_starts.reserve(newlines + 2);
+}
+
+// Newlines among the n bytes at p.
+std::size_t count_newlines(const char* p, std::size_t n) {
+    std::size_t newlines = 0;
+    std::size_t i = 0;
+    for (; n - i >= kBlockSize; i += kBlockSize) {
+        newlines += popcount(scan_block(p + i, '\n').newline);
+    }
+    return newlines + popcount(scan_bytes(p + i, n - i, '\n').newline);
+}
+
+inline unsigned lowest_bit(std::uint64_t bits) {
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanForward64(&index, bits);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(bits));
+#endif
+}
+
+// Closes the line [line_start, line_end) of content at base, whose earlier
+// fields were already appended to fields at each delimiter: strips a
+// trailing CR and appends the last field.  Returns false, appending
+// nothing, for an empty line.  Shared by parse_chunk and CsvRowReader so
+// that the table and the reader split lines identically.
+inline bool close_line(const char* base, std::size_t line_start, std::size_t field_start,
+                       std::size_t line_end, std::vector<std::string_view>& fields) {
+    // Strip trailing CR (Windows CRLF)
+    if (line_end > line_start && base[line_end - 1] == '\r') {
+        --line_end;
+    }
+    if (line_end == line_start) {
+        return false;  // empty line: skipped
+    }
+    // Same splitting as std::getline: a delimiter at the very end of the
+    // line does not start another field.
+    if (field_start < line_end) {
+        fields.emplace_back(base + field_start, line_end - field_start);
+    }
+    return true;
+}
+
+// Parses one newline-aligned chunk into table.
+void parse_chunk(std::string_view content, char delimiter, CsvTable& table) {
+    table.row_starts.push_back(0);
+
+    const char* base = content.data();
+    const std::size_t size = content.size();
+    reserve_for(table, base, size, delimiter);
+
+    std::size_t line_start = 0;
+    std::size_t field_start = 0;
+
+    auto finish_line = [&](std::size_t line_end) {
+        if (close_line(base, line_start, field_start, line_end, table.fields)) {
+            table.row_starts.push_back(table.fields.size());
+        }
+    };
+
+    // Classify 64 bytes at a time, then visit only the structural characters
+    // by peeling set bits off the combined mask.
+    for (std::size_t block = 0; block < size; block += kBlockSize) {
+        const BlockMasks m = (size - block >= kBlockSize)
+            ? scan_block(base + block, delimiter)
+            : scan_bytes(base + block, size - block, delimiter);
+
+        std::uint64_t bits = m.newline | m.delimiter;
+        while (bits != 0) {
+            const unsigned i = lowest_bit(bits);
+            bits &= bits - 1;
+            const std::size_t pos = block + i;
+            if ((m.newline >> i) & 1) {
+                finish_line(pos);
+                line_start = pos + 1;
+            } else {
+                table.fields.emplace_back(base + field_start, pos - field_start);
+            }
+            field_start = pos + 1;
+        }
+    }
+    if (line_start < size) {
+        finish_line(size);
+    }
+}
+
+// Splits content into at most max_chunks pieces of at least kMinChunkBytes,
+// each ending just after a newline (except the last).
+std::vector<std::string_view> split_chunks(std::string_view content,
+                                           std::size_t max_chunks) {
+    const std::size_t count =
+        std::max<std::size_t>(1, std::min(max_chunks, content.size() / kMinChunkBytes));
+
+    std::vector<std::string_view> chunks;
+    std::size_t begin = 0;
+    for (std::size_t k = 1; k <= count && begin < content.size(); ++k) {
+        std::size_t end = content.size();
+        if (k < count) {
+            end = content.find('\n', std::max(begin, content.size() / count * k));
+            end = (end == std::string_view::npos) ? content.size() : end + 1;
+        }
+        chunks.push_back(content.substr(begin, end - begin));
+        begin = end;
+    }
+    return chunks;
+}
+
+// Same set as isspace() in the "C" locale.
+inline bool is_space(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+inline bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// Drops leading whitespace and one sign character.  Returns false if
+// another sign follows, which strtod and strtol reject.
+bool strip_prefix(std::string_view& text, bool& negative) {
+    std::size_t i = 0;
+    while (i < text.size() && is_space(text[i])) {
+        ++i;
+    }
+    negative = false;
+    if (i < text.size() && (text[i] == '+' || text[i] == '-')) {
+        negative = text[i] == '-';
+        ++i;
+    }
+    text.remove_prefix(i);
+    return text.empty() || (text[0] != '+' && text[0] != '-');
+}
+
+// Powers of ten that are exact doubles.
+constexpr double kPow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+                             1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+
+// Parses the whole of text as digits[.digits] with at most 15 digits.  The
+// mantissa and the power of ten are then exact doubles and one division is
+// correctly rounded, so the result equals strtod's.  Returns false if the
+// text has any other shape; the caller falls back to from_chars.
+bool parse_plain_decimal(std::string_view text, double& value) {
+    std::uint64_t mantissa = 0;
+    std::size_t digits = 0;
+    std::size_t fraction_digits = 0;
+    bool seen_point = false;
+    for (char c : text) {
+        if (is_digit(c)) {
+            mantissa = mantissa * 10 + static_cast<unsigned>(c - '0');
+            ++digits;
+            fraction_digits += seen_point ? 1 : 0;
+        } else if (c == '.' && !seen_point) {
+            seen_point = true;
+        } else {
+            return false;
         }
-        if (line.empty()) {
-            continue;
+    }
+    if (digits == 0 || digits > 15) {
+        return false;
+    }
+    value = static_cast<double>(mantissa) / kPow10[fraction_digits];
+    return true;
+}
+
+}  // namespace
+
+// ---------------------------------------------------------------------------
+// Field conversion
+// ---------------------------------------------------------------------------
+
+bool parse_double(std::string_view text, double& value) {
+    bool negative = false;
+    if (!strip_prefix(text, negative)) {
+        return false;
+    }
+    double result = 0.0;
+    if (!parse_plain_decimal(text, result)) {
+        const char* first = text.data();
+        const char* last = text.data() + text.size();
+        auto format = std::chars_format::general;
+        // strtod reads "0x..." as a hexadecimal float
+        if (text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X') &&
+            (std::isxdigit(static_cast<unsigned char>(text[2])) || text[2] == '.')) {
+            first += 2;
+            format = std::chars_format::hex;
         }
-        CsvRow row;
-        std::istringstream ls(line);
-        std::string field;
-        while (std::getline(ls, field, delimiter)) {
-            row.push_back(field);
+        if (std::from_chars(first, last, result, format).ec != std::errc()) {
+            return false;
         }
-        result.emplace_back(line_num, std::move(row));
     }
-    return result;
+    value = negative ? -result : result;
+    return true;
+}
+
+bool parse_int(std::string_view text, int& value) {
+    bool negative = false;
+    if (!strip_prefix(text, negative)) {
+        return false;
+    }
+    // Parse the magnitude as unsigned so INT_MIN is accepted.
+    unsigned long long magnitude = 0;
+    const auto r = std::from_chars(text.data(), text.data() + text.size(), magnitude);
+    if (r.ec != std::errc()) {
+        return false;
+    }
+    const unsigned long long limit =
+        static_cast<unsigned long long>(INT_MAX) + (negative ? 1 : 0);
+    if (magnitude > limit) {
+        return false;
+    }
+    value = negative ? static_cast<int>(-static_cast<long long>(magnitude))
+                     : static_cast<int>(magnitude);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// CsvRowReader
+// ---------------------------------------------------------------------------
+
+CsvRowReader::CsvRowReader(std::string_view content, char delimiter, int lines_before)
+    : content_(content), delimiter_(delimiter), line_num_(lines_before) {}
+
+// Same scan as parse_chunk, but suspended between rows so that each row can
+// be consumed before the next one is read.
+bool CsvRowReader::next() {
+    fields_.clear();
+    const char* base = content_.data();
+    const std::size_t size = content_.size();
+
+    // Classify 64 bytes at a time, then visit only the structural characters
+    // by peeling set bits off the combined mask.
+    for (;;) {
+        while (pending_ == 0) {
+            if (next_block_ >= size) {
+                // Last line without a trailing newline
+                if (line_start_ < size) {
+                    const bool row = finish_line(size);
+                    line_start_ = size;
+                    return row;
+                }
+                return false;
+            }
+            const BlockMasks m = (size - next_block_ >= kBlockSize)
+                ? scan_block(base + next_block_, delimiter_)
+                : scan_bytes(base + next_block_, size - next_block_, delimiter_);
+            block_ = next_block_;
+            next_block_ += kBlockSize;
+            newlines_ = m.newline;
+            pending_ = m.newline | m.delimiter;
+        }
+
+        const unsigned i = lowest_bit(pending_);
+        pending_ &= pending_ - 1;
+        const std::size_t pos = block_ + i;
+        if ((newlines_ >> i) & 1) {
+            const bool row = finish_line(pos);
+            line_start_ = pos + 1;
+            field_start_ = pos + 1;
+            if (row) {
+                return true;
+            }
+        } else {
+            fields_.emplace_back(base + field_start_, pos - field_start_);
+            field_start_ = pos + 1;
+        }
+    }
+}
+
+// Counts the line [line_start_, line_end), even if it is empty, and closes
+// it.  Returns false for empty lines.
+bool CsvRowReader::finish_line(std::size_t line_end) {
+    ++line_num_;
+    return close_line(content_.data(), line_start_, field_start_, line_end, fields_);
+}
+
+// ---------------------------------------------------------------------------
+// Table parsing
+// ---------------------------------------------------------------------------
+
+CsvTable parse_csv_content(std::string_view content, char delimiter,
+                           unsigned threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    const auto chunks = split_chunks(content, threads);
+    if (chunks.size() <= 1) {
+        CsvTable table;
+        table.content = content;
+        parse_chunk(content, delimiter, table);
+        return table;
+    }
+
+    // Parse every chunk on its own thread.
+    std::vector<CsvTable> parts(chunks.size());
+    {
+        std::vector<std::thread> workers;
+        for (std::size_t k = 0; k < chunks.size(); ++k) {
+            workers.emplace_back([&, k] {
+                parse_chunk(chunks[k], delimiter, parts[k]);
+            });
+        }
+        for (auto& w : workers) {
+            w.join();
+        }
+    }
+
+    // Prefix sums give each chunk's first field and row in the result.
+    std::vector<std::size_t> first_field(chunks.size(), 0);
+    std::vector<std::size_t> first_row(chunks.size(), 0);
+    for (std::size_t k = 1; k < chunks.size(); ++k) {
+        first_field[k] = first_field[k - 1] + parts[k - 1].fields.size();
+        first_row[k]   = first_row[k - 1]   + parts[k - 1].size();
+    }
+    const std::size_t last = chunks.size() - 1;
+
+    CsvTable table;
+    table.content = content;
+    table.fields.resize(first_field[last] + parts[last].fields.size());
+    table.row_starts.resize(first_row[last] + parts[last].size() + 1);
+    table.row_starts[0] = 0;
+
+    // Stitch the parts together, again one thread per chunk.
+    std::vector<std::thread> workers;
+    for (std::size_t k = 0; k < chunks.size(); ++k) {
+        workers.emplace_back([&, k] {
+            CsvTable& part = parts[k];
+            std::copy(part.fields.begin(), part.fields.end(),
+                      table.fields.begin() + first_field[k]);
+            for (std::size_t r = 0; r < part.size(); ++r) {
+                table.row_starts[first_row[k] + r + 1] = part.row_starts[r + 1] + first_field[k];
+            }
+            part = CsvTable();
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    return table;
+}
+
+int CsvTable::line_number(std::size_t row) const {
+    return LineIndex(content).line_of(row_offset(row));
+}
+
+// ---------------------------------------------------------------------------
+// LineIndex
+// ---------------------------------------------------------------------------
+
+int LineIndex::line_of(std::size_t offset) {
+    // Rows are looked up in file order, so carry on from the last lookup
+    // when it lies in the same block.
+    if (offset >= last_offset_ && offset / kLineBlockBytes == last_offset_ / kLineBlockBytes &&
+        last_line_ > 0) {
+        last_line_ += static_cast<int>(count_newlines(content_.data() + last_offset_,
+                                                      offset - last_offset_));
+        last_offset_ = offset;
+        return last_line_;
+    }
+    if (block_lines_.empty()) {
+        block_lines_.push_back(0);
+    }
+    const std::size_t block = offset / kLineBlockBytes;
+    while (block_lines_.size() <= block) {
+        const std::size_t begin = (block_lines_.size() - 1) * kLineBlockBytes;
+        block_lines_.push_back(block_lines_.back() +
+                               static_cast<int>(count_newlines(content_.data() + begin,
+                                                               kLineBlockBytes)));
+    }
+    const std::size_t begin = block * kLineBlockBytes;
+    last_offset_ = offset;
+    last_line_ = block_lines_[block] +
+                 static_cast<int>(count_newlines(content_.data() + begin, offset - begin)) + 1;
+    return last_line_;
 }
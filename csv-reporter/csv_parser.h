@@ -1,16 +1,112 @@
 #pragma once
 
-#include <string>
-#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
 #include <vector>
 
-using CsvRow = std::vector<std::string>;
+// Parsed CSV content in compressed-row form: one flat array of fields plus
+// the index of each row's first field.  Fields are views into content, the
+// buffer given to parse_csv_content, which must outlive the table.  Rows do
+// not carry their line numbers; those are worked out from the row's
+// position when a row has to be reported.
+struct CsvTable {
+    std::string_view content;
+    std::vector<std::string_view> fields;   // all fields, row after row
+    std::vector<std::size_t> row_starts;    // row r is fields[row_starts[r], row_starts[r + 1])
 
-// Line number (1-based) paired with its parsed fields
-using IndexedRow = std::pair<int, CsvRow>;
+    std::size_t size() const { return row_starts.empty() ? 0 : row_starts.size() - 1; }
+
+    std::size_t field_count(std::size_t row) const {
+        return row_starts[row + 1] - row_starts[row];
+    }
+
+    std::string_view field(std::size_t row, std::size_t col) const {
+        return fields[row_starts[row] + col];
+    }
+
+    // Byte offset of a row in content.  Every row has a first field, which
+    // starts on the row's line.
+    std::size_t row_offset(std::size_t row) const {
+        return static_cast<std::size_t>(fields[row_starts[row]].data() - content.data());
+    }
+
+    // 1-based source line of a row.  Counts the newlines before it, so use
+    // a LineIndex for more than the odd lookup.
+    int line_number(std::size_t row) const;
+};
+
+// Line numbers of byte offsets in content, for the few rows that get
+// reported.  Newlines are counted a block of 64 KiB at a time and only as
+// far as the furthest offset asked for; each lookup then counts within one
+// block, from the previous lookup if that came earlier in the same block.
+// content must outlive the index.
+class LineIndex {
+public:
+    explicit LineIndex(std::string_view content) : content_(content) {}
+
+    // 1-based line of the byte at offset.
+    int line_of(std::size_t offset);
+
+private:
+    std::string_view content_;
+    std::vector<int> block_lines_;   // newlines before each block counted so far
+    std::size_t last_offset_ = 0;    // the previous lookup and its line,
+    int last_line_ = 0;              // 0 = none yet
+};
 
 // Splits content into rows. The first row is treated as the header and
 // included at index 0. Empty lines are skipped; line numbers reflect the
 // original 1-based position in the content string including skipped lines.
-std::vector<IndexedRow> parse_csv_content(const std::string& content,
-                                          char delimiter);
+// A trailing delimiter does not produce an empty last field.
+//
+// Inputs of several MiB are split into newline-aligned chunks that are parsed
+// in parallel on up to `threads` threads (0 = one per hardware thread); the
+// result is identical to a sequential parse.
+CsvTable parse_csv_content(std::string_view content, char delimiter,
+                           unsigned threads = 0);
+
+// Pull-style reader that yields one row at a time without building a table,
+// so memory use does not grow with the input.  Splitting rules and line
+// numbering are the same as for parse_csv_content; fields are views into
+// content, and the field list is only valid until the next call to next().
+// When content is the tail of a larger input, lines_before is the number of
+// lines that precede it, so that line numbers stay those of the whole input.
+class CsvRowReader {
+public:
+    CsvRowReader(std::string_view content, char delimiter, int lines_before = 0);
+
+    // Advances to the next non-empty row.  Returns false at end of input.
+    bool next();
+
+    // 1-based source line of the current row.  Once next() has returned
+    // false, the number of lines read, including skipped empty ones.
+    int line_number() const { return line_num_; }
+
+    const std::vector<std::string_view>& fields() const { return fields_; }
+    std::size_t field_count() const { return fields_.size(); }
+    std::string_view field(std::size_t col) const { return fields_[col]; }
+
+private:
+    bool finish_line(std::size_t line_end);
+
+    std::string_view content_;
+    char delimiter_;
+    std::size_t next_block_ = 0;
+    std::size_t block_ = 0;
+    std::uint64_t newlines_ = 0;
+    std::uint64_t pending_ = 0;     // structural bits of the block not yet visited
+    std::size_t line_start_ = 0;
+    std::size_t field_start_ = 0;
+    int line_num_ = 0;
+    std::vector<std::string_view> fields_;
+};
+
+// Field conversion without exceptions or temporary strings.  Both accept
+// what std::stod / std::stoi accept -- leading whitespace, an optional sign,
+// and the longest numeric prefix of the field ("12abc" is 12) -- and return
+// false where those would throw.  Plain decimals such as "1234.56" take a
+// fast path; everything else (exponents, hex, inf, nan, long mantissas) goes
+// through std::from_chars, so results are always correctly rounded.
+bool parse_double(std::string_view text, double& value);
+bool parse_int(std::string_view text, int& value);
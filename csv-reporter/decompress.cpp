@@ -0,0 +1,251 @@
+#include "decompress.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#ifdef CSV_REPORTER_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef CSV_REPORTER_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+Compression detect_compression(std::string_view bytes) {
+    if (bytes.size() >= 2 && bytes[0] == '\x1f' && bytes[1] == '\x8b') {
+        return Compression::gzip;
+    }
+    if (bytes.size() >= 4 && std::memcmp(bytes.data(), "\x28\xb5\x2f\xfd", 4) == 0) {
+        return Compression::zstd;
+    }
+    return Compression::none;
+}
+
+const char* compression_name(Compression compression) {
+    switch (compression) {
+    case Compression::gzip: return "gzip";
+    case Compression::zstd: return "zstd";
+    case Compression::none: break;
+    }
+    return "uncompressed";
+}
+
+bool compression_supported(Compression compression) {
+    switch (compression) {
+    case Compression::none:
+        return true;
+    case Compression::gzip:
+#ifdef CSV_REPORTER_HAVE_ZLIB
+        return true;
+#else
+        return false;
+#endif
+    case Compression::zstd:
+#ifdef CSV_REPORTER_HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+// DecompressPipe
+// ---------------------------------------------------------------------------
+
+DecompressPipe::DecompressPipe(std::string_view compressed, Compression compression)
+    : ring_(kRingBlocks, std::string(kBlockSize, '\0')),
+      sizes_(kRingBlocks, 0) {
+    worker_ = std::thread([this, compressed, compression] { run(compressed, compression); });
+}
+
+DecompressPipe::~DecompressPipe() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cancelled_ = true;
+    }
+    free_.notify_all();
+    worker_.join();
+}
+
+bool DecompressPipe::next(std::string_view& block) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (holding_) {
+        ++released_;
+        holding_ = false;
+        free_.notify_one();
+    }
+    ready_.wait(lock, [this] { return published_ > released_ || done_; });
+    if (published_ == released_) {
+        return false;
+    }
+    holding_ = true;
+    const std::size_t slot = released_ % kRingBlocks;
+    block = std::string_view(ring_[slot].data(), sizes_[slot]);
+    return true;
+}
+
+// Blocks released_ ... published_ - 1 are with the consumer, so the slot
+// after them is free once fewer than kRingBlocks are.
+char* DecompressPipe::acquire() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    free_.wait(lock, [this] { return published_ - released_ < kRingBlocks || cancelled_; });
+    return cancelled_ ? nullptr : ring_[published_ % kRingBlocks].data();
+}
+
+void DecompressPipe::publish(std::size_t size) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sizes_[published_ % kRingBlocks] = size;
+        ++published_;
+    }
+    ready_.notify_one();
+}
+
+void DecompressPipe::finish(std::string error) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        error_ = std::move(error);
+        done_ = true;
+    }
+    ready_.notify_all();
+}
+
+void DecompressPipe::run(std::string_view compressed, Compression compression) {
+    std::string error;
+    char* out = nullptr;
+    std::size_t used = 0;
+
+    // Hands out over once it is full and makes sure there is a buffer with
+    // room to write to.  Returns false once the consumer has gone away.
+    auto make_room = [&]() {
+        if (used == kBlockSize) {
+            publish(used);
+            out = nullptr;
+        }
+        if (out == nullptr) {
+            out = acquire();
+            used = 0;
+        }
+        return out != nullptr;
+    };
+
+    switch (compression) {
+    case Compression::none:
+        while (!compressed.empty() && make_room()) {
+            const std::size_t n = std::min(kBlockSize - used, compressed.size());
+            std::memcpy(out + used, compressed.data(), n);
+            used += n;
+            compressed.remove_prefix(n);
+        }
+        break;
+
+    case Compression::gzip: {
+#ifdef CSV_REPORTER_HAVE_ZLIB
+        constexpr std::size_t kMaxInput = std::size_t{1} << 30;   // zlib counts in 32 bits
+        z_stream zs{};
+        if (inflateInit2(&zs, 15 + 16) != Z_OK) {
+            error = "cannot initialize zlib";
+            break;
+        }
+        while (make_room()) {
+            if (zs.avail_in == 0 && !compressed.empty()) {
+                const std::size_t n = std::min(kMaxInput, compressed.size());
+                zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed.data()));
+                zs.avail_in = static_cast<uInt>(n);
+                compressed.remove_prefix(n);
+            }
+            zs.next_out = reinterpret_cast<Bytef*>(out + used);
+            zs.avail_out = static_cast<uInt>(kBlockSize - used);
+            const int rc = inflate(&zs, Z_NO_FLUSH);
+            used = kBlockSize - zs.avail_out;
+            if (rc == Z_STREAM_END) {
+                if (zs.avail_in == 0 && compressed.empty()) {
+                    break;
+                }
+                inflateReset(&zs);   // another member follows
+            } else if (rc == Z_BUF_ERROR && zs.avail_in == 0 && compressed.empty()) {
+                error = "unexpected end of gzip data";
+                break;
+            } else if (rc != Z_OK && rc != Z_BUF_ERROR) {
+                error = zs.msg != nullptr ? zs.msg : "invalid gzip data";
+                break;
+            }
+        }
+        inflateEnd(&zs);
+#else
+        error = "gzip support is not available in this build (zlib was not found)";
+#endif
+        break;
+    }
+
+    case Compression::zstd: {
+#ifdef CSV_REPORTER_HAVE_ZSTD
+        ZSTD_DStream* ds = ZSTD_createDStream();
+        if (ds == nullptr || ZSTD_isError(ZSTD_initDStream(ds))) {
+            ZSTD_freeDStream(ds);
+            error = "cannot initialize zstd";
+            break;
+        }
+        ZSTD_inBuffer input{compressed.data(), compressed.size(), 0};
+        std::size_t pending = 0;   // 0 once every frame read so far is complete
+        while (make_room()) {
+            ZSTD_outBuffer output{out, kBlockSize, used};
+            pending = ZSTD_decompressStream(ds, &output, &input);
+            if (ZSTD_isError(pending)) {
+                error = ZSTD_getErrorName(pending);
+                break;
+            }
+            used = output.pos;
+            // With all input read, the data ends here if the last frame is
+            // complete, or if room is left in out, so that nothing more is
+            // buffered.  Calling again after a complete frame would wait
+            // for the header of another one.
+            if (input.pos == input.size && (pending == 0 || used < kBlockSize)) {
+                break;
+            }
+        }
+        if (error.empty() && out != nullptr && pending != 0) {
+            error = "unexpected end of zstd data";
+        }
+        ZSTD_freeDStream(ds);
+#else
+        error = "zstd support is not available in this build (libzstd was not found)";
+#endif
+        break;
+    }
+    }
+
+    if (out != nullptr && used > 0) {
+        publish(used);
+    }
+    finish(std::move(error));
+}
+
+bool decompress_all(std::string_view compressed, Compression compression,
+                    std::string& out, std::string& error) {
+    out.clear();
+    // A gzip file ends with its size modulo 2^32, a good guess for one
+    // member.
+    if (compression == Compression::gzip && compressed.size() >= 18) {
+        const auto* tail = reinterpret_cast<const unsigned char*>(
+            compressed.data() + compressed.size() - 4);
+        const std::uint32_t size = tail[0] | (tail[1] << 8) | (tail[2] << 16) |
+                                   (std::uint32_t{tail[3]} << 24);
+        if (size > compressed.size()) {
+            out.reserve(size);
+        }
+    }
+
+    DecompressPipe pipe(compressed, compression);
+    std::string_view block;
+    while (pipe.next(block)) {
+        out.append(block);
+    }
+    if (!pipe.error().empty()) {
+        error = pipe.error();
+        return false;
+    }
+    return true;
+}
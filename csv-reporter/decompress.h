@@ -0,0 +1,77 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+enum class Compression { none, gzip, zstd };
+
+// Recognizes gzip and zstd data by their magic bytes, whatever the file is
+// called.
+Compression detect_compression(std::string_view bytes);
+
+// Name of a compression format for messages ("gzip", "zstd").
+const char* compression_name(Compression compression);
+
+// Whether this build can decompress the format (zlib / libzstd were found).
+bool compression_supported(Compression compression);
+
+// Decompresses on a thread of its own.  Output is written in blocks of
+// kBlockSize into a ring of kRingBlocks buffers and handed to the consumer
+// in order, so decompression runs ahead of the consumer by at most the
+// ring and memory use does not depend on the size of the data.  Gzip files
+// of several members (as written by concatenation or pigz) are read whole.
+class DecompressPipe {
+public:
+    static constexpr std::size_t kBlockSize = std::size_t{1} << 20;
+    static constexpr std::size_t kRingBlocks = 4;
+
+    // compressed must outlive the pipe.
+    DecompressPipe(std::string_view compressed, Compression compression);
+    ~DecompressPipe();
+
+    DecompressPipe(const DecompressPipe&) = delete;
+    DecompressPipe& operator=(const DecompressPipe&) = delete;
+
+    // Waits for the next block of output.  The view stays valid until the
+    // next call.  Returns false at the end of the data or after an error.
+    bool next(std::string_view& block);
+
+    // Why decompression stopped early; empty if it did not.  Only
+    // meaningful once next() has returned false.
+    const std::string& error() const { return error_; }
+
+private:
+    void run(std::string_view compressed, Compression compression);
+
+    // Producer side: a buffer to fill, and publishing it with its size.
+    // acquire() returns nullptr once the consumer has gone away.
+    char* acquire();
+    void publish(std::size_t size);
+    void finish(std::string error);
+
+    std::vector<std::string> ring_;
+    std::vector<std::size_t> sizes_;
+
+    std::mutex mutex_;
+    std::condition_variable ready_;   // a block was published, or the end reached
+    std::condition_variable free_;    // a block was released, or the consumer left
+    std::uint64_t published_ = 0;     // blocks handed over so far
+    std::uint64_t released_ = 0;      // blocks the consumer is done with
+    bool holding_ = false;            // the consumer holds block released_
+    bool done_ = false;
+    bool cancelled_ = false;
+    std::string error_;
+
+    std::thread worker_;
+};
+
+// Decompresses all of compressed into out through a DecompressPipe.
+// Returns false with the reason in error on failure.
+bool decompress_all(std::string_view compressed, Compression compression,
+                    std::string& out, std::string& error);
@@ -0,0 +1,123 @@
+#include "diagnostics.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+constexpr RowProblem kProblems[kRowProblemKinds] = {
+    RowProblem::insufficient_columns,
+    RowProblem::invalid_amount,
+    RowProblem::invalid_stock_qty,
+};
+
+// JSON member name of each kind.
+const char* row_problem_key(RowProblem problem) {
+    switch (problem) {
+    case RowProblem::insufficient_columns: return "insufficient_columns";
+    case RowProblem::invalid_amount:       return "invalid_amount";
+    case RowProblem::invalid_stock_qty:    return "invalid_stock_qty";
+    }
+    return "unknown";
+}
+
+std::string json_string(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+        }
+        if (static_cast<unsigned char>(c) >= 0x20) {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+}  // namespace
+
+const char* row_problem_text(RowProblem problem) {
+    switch (problem) {
+    case RowProblem::insufficient_columns: return "insufficient columns";
+    case RowProblem::invalid_amount:       return "invalid amount value";
+    case RowProblem::invalid_stock_qty:    return "invalid stock_qty value";
+    }
+    return "unknown problem";
+}
+
+Diagnostics::Diagnostics(std::ostream& out, DiagnosticsLimits limits, std::string source)
+    : out_(out),
+      limits_(limits),
+      source_(std::move(source)),
+      tokens_(std::max(1.0, limits.max_per_second)),
+      refilled_(std::chrono::steady_clock::now()) {}
+
+std::uint64_t Diagnostics::total() const {
+    std::uint64_t sum = 0;
+    for (const std::uint64_t n : counts_) {
+        sum += n;
+    }
+    return sum;
+}
+
+bool Diagnostics::take_sample() {
+    if (shown_ >= limits_.max_samples) {
+        return false;
+    }
+    if (limits_.max_per_second > 0.0) {
+        const auto now = std::chrono::steady_clock::now();
+        const double elapsed = std::chrono::duration<double>(now - refilled_).count();
+        refilled_ = now;
+        // Never less than one token, or a rate below one a second would
+        // write nothing at all
+        tokens_ = std::min(std::max(1.0, limits_.max_per_second),
+                           tokens_ + elapsed * limits_.max_per_second);
+        if (tokens_ < 1.0) {
+            return false;
+        }
+        tokens_ -= 1.0;
+    }
+    ++shown_;
+    return true;
+}
+
+void Diagnostics::write(RowProblem problem, int line) {
+    // One write per warning: std::cerr is unbuffered.
+    std::string text = "[WARN] Skipping malformed row at line ";
+    text += std::to_string(line);
+    text += ": ";
+    text += row_problem_text(problem);
+    text += '\n';
+    out_.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
+
+void Diagnostics::finish() {
+    const std::uint64_t skipped = total();
+    if (skipped == shown_) {
+        return;
+    }
+    out_ << "[WARN] ";
+    if (!source_.empty()) {
+        out_ << source_ << ": ";
+    }
+    out_ << skipped << " malformed row" << (skipped == 1 ? "" : "s") << " skipped (";
+    const char* separator = "";
+    for (const RowProblem problem : kProblems) {
+        if (count(problem) > 0) {
+            out_ << separator << count(problem) << " " << row_problem_text(problem);
+            separator = ", ";
+        }
+    }
+    out_ << "); " << shown_ << " shown\n";
+}
+
+std::string Diagnostics::json() const {
+    std::string json = "{\"source\": " + json_string(source_) +
+                       ", \"skipped\": " + std::to_string(total()) +
+                       ", \"shown\": " + std::to_string(shown_);
+    for (const RowProblem problem : kProblems) {
+        json += std::string(", \"") + row_problem_key(problem) +
+                "\": " + std::to_string(count(problem));
+    }
+    return json + "}";
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Why a row of an input file was skipped.
+enum class RowProblem : std::uint8_t {
+    insufficient_columns,
+    invalid_amount,
+    invalid_stock_qty,
+};
+
+constexpr std::size_t kRowProblemKinds = 3;
+
+// "insufficient columns", "invalid amount value", ...: the reason as the
+// warning states it.
+const char* row_problem_text(RowProblem problem);
+
+// A skipped row, e.g. as kept in a sales cache.
+struct RowIssue {
+    RowProblem problem = RowProblem::insufficient_columns;
+    int line = 0;
+};
+
+// How many malformed-row warnings a Diagnostics writes.  Rows beyond either
+// limit are still counted.
+struct DiagnosticsLimits {
+    std::size_t max_samples = std::numeric_limits<std::size_t>::max();
+    double max_per_second = 0.0;   // 0 = no rate limit
+};
+
+// Collects the rows skipped while reading one input file.  Every row is
+// counted by kind; "[WARN] Skipping malformed row at line N: reason" is
+// written for the first max_samples of them, and no faster than
+// max_per_second (a token bucket holding one second's worth, but at least
+// one warning, so that a rate below one per second still writes some).  A
+// row's line number is only worked out when its warning is written, so
+// well-formed rows never pay for one.
+//
+// Without limits every row is written, exactly as the std::ostream
+// overloads of the parsers always have.
+class Diagnostics {
+public:
+    explicit Diagnostics(std::ostream& out,
+                         DiagnosticsLimits limits = {},
+                         std::string source = {});
+
+    // Counts a skipped row.  line_of() returns its 1-based line and is only
+    // called if the row's warning is written or the row is recorded.
+    template <class LineOf>
+    void skip_row(RowProblem problem, LineOf&& line_of) {
+        ++counts_[static_cast<std::size_t>(problem)];
+        const bool sample = take_sample();
+        if (sample || record_ != nullptr) {
+            const int line = line_of();
+            if (sample) {
+                write(problem, line);
+            }
+            if (record_ != nullptr) {
+                record_->push_back({problem, line});
+            }
+        }
+    }
+
+    // Also appends every skipped row, with its line, to issues until called
+    // with nullptr.
+    void record(std::vector<RowIssue>* issues) { record_ = issues; }
+
+    // For warnings that are not about a row, such as a cache that cannot
+    // be written.  Not limited.
+    std::ostream& out() { return out_; }
+
+    std::uint64_t count(RowProblem problem) const {
+        return counts_[static_cast<std::size_t>(problem)];
+    }
+    std::uint64_t total() const;
+    std::uint64_t shown() const { return shown_; }
+
+    // If some skipped rows went unshown, writes one line that counts them
+    // all by kind, e.g. "[WARN] SALES_FILE: 1200 malformed rows skipped
+    // (50 insufficient columns, 1150 invalid amount value); 20 shown".
+    void finish();
+
+    // The counts as a single-line JSON object: source, skipped, shown and
+    // one member per kind.
+    std::string json() const;
+
+private:
+    bool take_sample();
+    void write(RowProblem problem, int line);
+
+    std::ostream& out_;
+    DiagnosticsLimits limits_;
+    std::string source_;
+    std::array<std::uint64_t, kRowProblemKinds> counts_{};
+    std::uint64_t shown_ = 0;
+    std::vector<RowIssue>* record_ = nullptr;
+
+    double tokens_ = 0.0;
+    std::chrono::steady_clock::time_point refilled_;
+};
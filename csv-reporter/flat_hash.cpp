@@ -0,0 +1,319 @@
+#include "flat_hash.h"
+
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+
+constexpr std::size_t kGroupSize = 16;
+constexpr std::uint8_t kEmpty = 0x80;   // tags of used slots are 0x00..0x7f
+
+inline std::uint64_t mix(std::uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+inline std::uint8_t tag_of(std::uint64_t hash) {
+    return static_cast<std::uint8_t>(hash & 0x7f);
+}
+
+inline std::size_t group_of(std::uint64_t hash, std::size_t group_mask) {
+    return static_cast<std::size_t>(hash >> 7) & group_mask;
+}
+
+inline unsigned lowest_bit(std::uint32_t bits) {
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanForward(&index, bits);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(bits));
+#endif
+}
+
+// Bit i is set when tags[i] == tag, for the 16 tags of one group.
+inline std::uint32_t match_tags(const std::uint8_t* tags, std::uint8_t tag) {
+#if defined(__SSE2__)
+    const __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tags));
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(
+        _mm_cmpeq_epi8(group, _mm_set1_epi8(static_cast<char>(tag)))));
+#else
+    std::uint32_t bits = 0;
+    for (std::size_t i = 0; i < kGroupSize; ++i) {
+        bits |= static_cast<std::uint32_t>(tags[i] == tag) << i;
+    }
+    return bits;
+#endif
+}
+
+inline void prefetch_line(const void* p) {
+#if defined(__SSE2__)
+    _mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0);
+#else
+    (void)p;
+#endif
+}
+
+// Smallest power-of-two group count that holds n keys at 7/8 load.
+std::size_t groups_for(std::size_t n) {
+    std::size_t groups = 1;
+    while (groups * kGroupSize * 7 / 8 < n) {
+        groups *= 2;
+    }
+    return groups;
+}
+
+}  // namespace
+
+std::uint64_t hash_key(std::string_view key) {
+    const char* p = key.data();
+    std::size_t n = key.size();
+    std::uint64_t h = 0x9e3779b97f4a7c15ULL ^ (n * 0xbf58476d1ce4e5b9ULL);
+    while (n >= 8) {
+        std::uint64_t word;
+        std::memcpy(&word, p, 8);
+        h = (h ^ word) * 0x94d049bb133111ebULL;
+        h ^= h >> 29;
+        p += 8;
+        n -= 8;
+    }
+    std::uint64_t tail = 0;
+    if (n > 0) {
+        std::memcpy(&tail, p, n);
+    }
+    return mix(h ^ tail);
+}
+
+// ---------------------------------------------------------------------------
+// FlatStringMap
+// ---------------------------------------------------------------------------
+
+FlatStringMap::FlatStringMap(std::size_t expected_size) {
+    rehash(groups_for(expected_size));
+}
+
+std::pair<std::uint32_t, bool> FlatStringMap::insert(std::string_view key,
+                                                     std::uint64_t hash,
+                                                     std::uint32_t value) {
+    const std::uint32_t found = find(key, hash);
+    if (found != kNotFound) {
+        return {found, false};
+    }
+    if ((size_ + 1) > (group_mask_ + 1) * kGroupSize * 7 / 8) {
+        rehash((group_mask_ + 1) * 2);
+    }
+
+    // Quadratic (triangular) probing over groups until one has a free slot.
+    std::size_t group = group_of(hash, group_mask_);
+    for (std::size_t step = 1;; ++step) {
+        const std::uint32_t empty = match_tags(&tags_[group * kGroupSize], kEmpty);
+        if (empty != 0) {
+            const std::size_t i = group * kGroupSize + lowest_bit(empty);
+            tags_[i] = tag_of(hash);
+            Slot& slot = slots_[i];
+            slot.hash = hash;
+            slot.size = static_cast<std::uint32_t>(key.size());
+            slot.value = value;
+            if (key.size() <= kInlineKeyBytes) {
+                if (!key.empty()) {
+                    std::memcpy(slot.key.bytes, key.data(), key.size());
+                }
+            } else {
+                slot.key.offset = long_keys_.size();
+                long_keys_.insert(long_keys_.end(), key.begin(), key.end());
+            }
+            ++size_;
+            return {value, true};
+        }
+        group = (group + step) & group_mask_;
+    }
+}
+
+std::uint32_t FlatStringMap::find(std::string_view key, std::uint64_t hash) const {
+    const std::uint8_t tag = tag_of(hash);
+    const std::uint8_t* all_tags = this->tags();
+    const Slot* all_slots = slots();
+    std::size_t group = group_of(hash, group_mask_);
+    for (std::size_t step = 1;; ++step) {
+        const std::uint8_t* tags = all_tags + group * kGroupSize;
+        std::uint32_t candidates = match_tags(tags, tag);
+        while (candidates != 0) {
+            const Slot& slot = all_slots[group * kGroupSize + lowest_bit(candidates)];
+            candidates &= candidates - 1;
+            if (slot.hash != hash || slot.size != key.size()) {
+                continue;
+            }
+            const char* bytes = (slot.size <= kInlineKeyBytes)
+                ? slot.key.bytes
+                : long_keys() + slot.key.offset;
+            if (key.empty() || std::memcmp(bytes, key.data(), key.size()) == 0) {
+                return slot.value;
+            }
+        }
+        // A group with a free slot ends every probe sequence through it.
+        if (match_tags(tags, kEmpty) != 0) {
+            return kNotFound;
+        }
+        group = (group + step) & group_mask_;
+    }
+}
+
+void FlatStringMap::prefetch(std::uint64_t hash) const {
+    prefetch_line(tags() + group_of(hash, group_mask_) * kGroupSize);
+}
+
+namespace {
+
+constexpr std::uint64_t kTableMagic = 0x3150414d54414c46ULL;  // "FLATMAP1"
+
+struct TableHeader {
+    std::uint64_t magic;
+    std::uint64_t groups;
+    std::uint64_t size;
+    std::uint64_t key_bytes;
+};
+
+}  // namespace
+
+// Layout: TableHeader, the tags, the slots, the long-key arena.  The tag
+// array is a multiple of 16 bytes, so the slots stay 8-byte aligned.
+void FlatStringMap::serialize(std::string& out) const {
+    const std::size_t groups = group_mask_ + 1;
+    const TableHeader header{kTableMagic, groups, size_, long_keys_.size()};
+    out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.append(reinterpret_cast<const char*>(tags()), groups * kGroupSize);
+    out.append(reinterpret_cast<const char*>(slots()), groups * kGroupSize * sizeof(Slot));
+    out.append(long_keys(), long_keys_.size());
+}
+
+bool FlatStringMap::attach(std::string_view bytes, std::uint32_t value_limit) {
+    TableHeader header;
+    if (bytes.size() < sizeof(header) ||
+        reinterpret_cast<std::uintptr_t>(bytes.data()) % alignof(Slot) != 0) {
+        return false;
+    }
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    const std::uint64_t groups = header.groups;
+    if (header.magic != kTableMagic || groups == 0 || (groups & (groups - 1)) != 0 ||
+        groups > bytes.size() / kGroupSize ||
+        bytes.size() != sizeof(header) + groups * kGroupSize * (1 + sizeof(Slot)) +
+                            header.key_bytes) {
+        return false;
+    }
+
+    // Every used slot is checked once here, so that lookups can trust the
+    // table: its tag matches its hash, its value is in range and a long key
+    // lies inside the arena.  At least one slot must be free, or a probe for
+    // an absent key would never end.
+    const char* p = bytes.data() + sizeof(header);
+    const auto* tags = reinterpret_cast<const std::uint8_t*>(p);
+    const auto* slots = reinterpret_cast<const Slot*>(p + groups * kGroupSize);
+    const std::size_t slot_count = static_cast<std::size_t>(groups) * kGroupSize;
+    std::uint64_t used = 0;
+    for (std::size_t i = 0; i < slot_count; ++i) {
+        if (tags[i] == kEmpty) {
+            continue;
+        }
+        const Slot& slot = slots[i];
+        if (tags[i] != tag_of(slot.hash) || slot.value >= value_limit ||
+            (slot.size > kInlineKeyBytes &&
+             (slot.key.offset > header.key_bytes ||
+              slot.size > header.key_bytes - slot.key.offset))) {
+            return false;
+        }
+        ++used;
+    }
+    if (used != header.size || used == slot_count) {
+        return false;
+    }
+
+    *this = FlatStringMap();
+    tags_.clear();
+    slots_.clear();
+    attached_ = true;
+    attached_tags_ = reinterpret_cast<const std::uint8_t*>(p);
+    attached_slots_ = reinterpret_cast<const Slot*>(p + groups * kGroupSize);
+    attached_keys_ = p + groups * kGroupSize * (1 + sizeof(Slot));
+    group_mask_ = static_cast<std::size_t>(groups - 1);
+    size_ = static_cast<std::size_t>(header.size);
+    return true;
+}
+
+// Moves every slot into a table of the given number of groups, reusing the
+// stored hashes.
+void FlatStringMap::rehash(std::size_t groups) {
+    std::vector<std::uint8_t> old_tags(groups * kGroupSize, kEmpty);
+    std::vector<Slot> old_slots(groups * kGroupSize);
+    old_tags.swap(tags_);
+    old_slots.swap(slots_);
+    group_mask_ = groups - 1;
+
+    for (std::size_t i = 0; i < old_tags.size(); ++i) {
+        if (old_tags[i] == kEmpty) {
+            continue;
+        }
+        const Slot& slot = old_slots[i];
+        std::size_t group = group_of(slot.hash, group_mask_);
+        for (std::size_t step = 1;; ++step) {
+            const std::uint32_t empty = match_tags(&tags_[group * kGroupSize], kEmpty);
+            if (empty != 0) {
+                const std::size_t j = group * kGroupSize + lowest_bit(empty);
+                tags_[j] = old_tags[i];
+                slots_[j] = slot;
+                break;
+            }
+            group = (group + step) & group_mask_;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// BlockedBloomFilter
+// ---------------------------------------------------------------------------
+
+namespace {
+
+constexpr std::size_t kBloomBitsPerKey = 16;
+
+// The block comes from the high hash bits; eight 6-bit fields of a second
+// mix of the hash pick one bit in each of the block's eight words.
+inline std::uint64_t bloom_bits(std::uint64_t hash) {
+    return mix(hash ^ 0x5851f42d4c957f2dULL);
+}
+
+}  // namespace
+
+BlockedBloomFilter::BlockedBloomFilter(std::size_t expected_size)
+    : blocks_((expected_size * kBloomBitsPerKey + 511) / 512 + 1, Block{}) {}
+
+void BlockedBloomFilter::insert(std::uint64_t hash) {
+    Block& block = blocks_[(hash >> 32) % blocks_.size()];
+    const std::uint64_t bits = bloom_bits(hash);
+    for (int w = 0; w < 8; ++w) {
+        block.words[w] |= std::uint64_t{1} << ((bits >> (6 * w)) & 63);
+    }
+}
+
+bool BlockedBloomFilter::maybe_contains(std::uint64_t hash) const {
+    const Block& block = blocks_[(hash >> 32) % blocks_.size()];
+    const std::uint64_t bits = bloom_bits(hash);
+    bool present = true;
+    for (int w = 0; w < 8; ++w) {
+        present &= ((block.words[w] >> ((bits >> (6 * w)) & 63)) & 1) != 0;
+    }
+    return present;
+}
+
+void BlockedBloomFilter::prefetch(std::uint64_t hash) const {
+    prefetch_line(&blocks_[(hash >> 32) % blocks_.size()]);
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// 64-bit hash of a byte string, reading eight bytes per step.  Not
+// cryptographic; the low 7 bits and the high bits are both well mixed so
+// they can be used independently as tag and bucket.
+std::uint64_t hash_key(std::string_view key);
+
+// Open-addressing map from string keys to 32-bit values, laid out like a
+// Swiss table: slots come in groups of 16, each slot has a one-byte tag
+// holding 7 bits of its key's hash, and a probe compares the 16 tags of a
+// group with one SSE2 instruction.  Key bytes are only compared when the
+// tag and the full hash, which is stored inline in the slot, both match.
+// Keys of up to 16 bytes are copied into the slot, so a hit costs no
+// further cache miss; longer keys go to a separate byte arena.  No erase.
+//
+// The arrays hold no pointers, so a table can be written out with
+// serialize() and used again, read-only, straight from the bytes -- for
+// example a memory-mapped file -- with attach().  Move-only.
+class FlatStringMap {
+public:
+    static constexpr std::uint32_t kNotFound = UINT32_MAX;
+
+    explicit FlatStringMap(std::size_t expected_size = 0);
+
+    FlatStringMap(FlatStringMap&&) noexcept = default;
+    FlatStringMap& operator=(FlatStringMap&&) noexcept = default;
+
+    FlatStringMap(const FlatStringMap&) = delete;
+    FlatStringMap& operator=(const FlatStringMap&) = delete;
+
+    // Inserts key -> value unless key is already present.  Returns the
+    // value stored for key and whether it was inserted.
+    std::pair<std::uint32_t, bool> insert(std::string_view key, std::uint32_t value) {
+        return insert(key, hash_key(key), value);
+    }
+    std::pair<std::uint32_t, bool> insert(std::string_view key, std::uint64_t hash,
+                                          std::uint32_t value);
+
+    // Returns the value stored for key, or kNotFound.
+    std::uint32_t find(std::string_view key) const { return find(key, hash_key(key)); }
+    std::uint32_t find(std::string_view key, std::uint64_t hash) const;
+
+    // Starts loading the tag group that a lookup of hash reads first.
+    // Issuing this a few keys ahead lets probes into tables much larger
+    // than the cache overlap their memory accesses.
+    void prefetch(std::uint64_t hash) const;
+
+    std::size_t size() const { return size_; }
+
+    // Appends the table to out in the form attach() reads.
+    void serialize(std::string& out) const;
+
+    // Makes this a read-only view of a table written by serialize().  bytes
+    // must be 8-byte aligned and outlive the map; insert() must not be
+    // called afterwards.  Returns false, leaving the map unchanged, if bytes
+    // do not hold a well-formed table or a value is value_limit or more.
+    bool attach(std::string_view bytes, std::uint32_t value_limit = kNotFound);
+
+private:
+    static constexpr std::size_t kInlineKeyBytes = 16;
+
+    // 32 bytes: two slots per cache line.
+    struct Slot {
+        std::uint64_t hash;
+        std::uint32_t size;
+        std::uint32_t value;
+        union {
+            char bytes[kInlineKeyBytes];   // size <= kInlineKeyBytes
+            std::uint64_t offset;          // longer keys: offset in the key arena
+        } key;
+    };
+
+    // Either the owned vectors below or the attached bytes.
+    const std::uint8_t* tags() const { return attached_ ? attached_tags_ : tags_.data(); }
+    const Slot* slots() const { return attached_ ? attached_slots_ : slots_.data(); }
+    const char* long_keys() const { return attached_ ? attached_keys_ : long_keys_.data(); }
+
+    void rehash(std::size_t groups);
+
+    std::vector<std::uint8_t> tags_;   // one per slot; kEmpty or 7 hash bits
+    std::vector<Slot> slots_;
+    std::vector<char> long_keys_;
+    std::size_t group_mask_ = 0;       // number of groups - 1 (a power of two)
+    std::size_t size_ = 0;
+
+    bool attached_ = false;
+    const std::uint8_t* attached_tags_ = nullptr;
+    const Slot* attached_slots_ = nullptr;
+    const char* attached_keys_ = nullptr;
+};
+
+// Blocked Bloom filter: every key sets 8 bits within a single 64-byte block,
+// so a query touches one cache line.  With 16 bits per key the false
+// positive rate is about 0.1%.  Used in front of a hash table whose probes
+// would mostly miss caches, to reject absent keys cheaply.
+class BlockedBloomFilter {
+public:
+    explicit BlockedBloomFilter(std::size_t expected_size = 0);
+
+    void insert(std::uint64_t hash);
+    bool maybe_contains(std::uint64_t hash) const;
+    void prefetch(std::uint64_t hash) const;
+
+private:
+    struct alignas(64) Block {
+        std::uint64_t words[8];
+    };
+
+    std::vector<Block> blocks_;
+};
@@ -0,0 +1,92 @@
+#include "inventory_index.h"
+
+#include <cstring>
+
+namespace {
+
+// About where the table (32 bytes per slot) outgrows a typical L2.
+constexpr std::size_t kBloomMinKeys = std::size_t{1} << 15;
+
+constexpr std::uint64_t kIndexMagic = 0x31584449564e49ULL;  // "INVIDX1"
+
+// Start of an index file; the FlatStringMap follows.  Its size is a
+// multiple of 8, so the map stays aligned in the mapping.
+struct IndexHeader {
+    std::uint64_t magic;
+    std::uint64_t size;
+    std::int64_t mtime;
+    std::uint64_t hash;
+    std::uint64_t delimiter;
+};
+
+IndexHeader header_for(const FileStamp& stamp) {
+    return {kIndexMagic, stamp.size, stamp.mtime, stamp.hash,
+            static_cast<unsigned char>(stamp.delimiter)};
+}
+
+}  // namespace
+
+InventoryIndex::InventoryIndex(const std::vector<InventoryRecord>& inventory)
+    : ids_(inventory.size()),
+      use_bloom_(inventory.size() >= kBloomMinKeys),
+      bloom_(use_bloom_ ? inventory.size() : 0) {
+    for (const auto& inv : inventory) {
+        const std::uint64_t hash = hash_key(inv.product_id);
+        ids_.insert(inv.product_id, hash, 0);
+        if (use_bloom_) {
+            bloom_.insert(hash);
+        }
+    }
+}
+
+bool InventoryIndex::save(const std::string& path, const FileStamp& stamp) const {
+    const IndexHeader header = header_for(stamp);
+    std::string bytes(reinterpret_cast<const char*>(&header), sizeof(header));
+    ids_.serialize(bytes);
+    return replace_file(path, bytes);
+}
+
+bool InventoryIndex::load(const std::string& path, const FileStamp& stamp) {
+    MappedFile file;
+    if (!file.open(path)) {
+        return false;
+    }
+    const std::string_view bytes = file.view();
+    const IndexHeader expected = header_for(stamp);
+    if (bytes.size() < sizeof(expected) ||
+        std::memcmp(bytes.data(), &expected, sizeof(expected)) != 0) {
+        return false;
+    }
+    FlatStringMap ids;
+    if (!ids.attach(bytes.substr(sizeof(expected)))) {
+        return false;
+    }
+    ids_ = std::move(ids);
+    use_bloom_ = false;
+    bloom_ = BlockedBloomFilter();
+    file_ = std::move(file);
+    return true;
+}
+
+InventoryIndex index_inventory(const std::string& path,
+                               std::string_view content,
+                               char delimiter,
+                               bool use_sidecar,
+                               Diagnostics& diagnostics) {
+    const std::string sidecar = path + ".idx";
+    FileStamp stamp;
+    if (use_sidecar) {
+        stamp = stamp_file(path, content, delimiter);
+        InventoryIndex index;
+        if (index.load(sidecar, stamp)) {
+            return index;
+        }
+    }
+
+    const auto rows = parse_csv_content(content, delimiter);
+    InventoryIndex index(parse_inventory_rows(rows, diagnostics));
+    if (use_sidecar && !index.save(sidecar, stamp)) {
+        diagnostics.out() << "[WARN] Could not write inventory index " << sidecar << "\n";
+    }
+    return index;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "flat_hash.h"
+#include "mapped_file.h"
+#include "reporter.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Inventory product IDs for probing by string.  Single probes into a set
+// too large to stay in cache go through a Bloom filter first, so sales of
+// products that are not in the inventory are usually rejected with one
+// cache-line read.  Callers that know the next keys in advance do better by
+// prefetching the table's tag groups and skipping the filter.
+//
+// An index can be saved next to the inventory file and mapped back in by a
+// later run, which then skips parsing the inventory and building the table.
+// Move-only.
+class InventoryIndex {
+public:
+    InventoryIndex() = default;
+    explicit InventoryIndex(const std::vector<InventoryRecord>& inventory);
+
+    InventoryIndex(InventoryIndex&&) noexcept = default;
+    InventoryIndex& operator=(InventoryIndex&&) noexcept = default;
+
+    InventoryIndex(const InventoryIndex&) = delete;
+    InventoryIndex& operator=(const InventoryIndex&) = delete;
+
+    bool contains(std::string_view id) const {
+        const std::uint64_t hash = hash_key(id);
+        if (use_bloom_ && !bloom_.maybe_contains(hash)) {
+            return false;
+        }
+        return ids_.find(id, hash) != FlatStringMap::kNotFound;
+    }
+
+    void prefetch(std::uint64_t hash) const { ids_.prefetch(hash); }
+
+    bool contains_prefetched(std::string_view id, std::uint64_t hash) const {
+        return ids_.find(id, hash) != FlatStringMap::kNotFound;
+    }
+
+    // Number of distinct product IDs.
+    std::size_t size() const { return ids_.size(); }
+
+    // Writes the index and stamp to path with replace_file, so concurrent
+    // runs never map a partial file.  Returns false if it cannot be written.
+    bool save(const std::string& path, const FileStamp& stamp) const;
+
+    // Maps an index written by save().  Returns false, leaving the index
+    // unchanged, if the file is missing, malformed or was saved with a
+    // different stamp.  A loaded index has no Bloom filter.
+    bool load(const std::string& path, const FileStamp& stamp);
+
+private:
+    FlatStringMap ids_;
+    bool use_bloom_ = false;
+    BlockedBloomFilter bloom_;
+    MappedFile file_;   // backs ids_ after load()
+};
+
+// Parses the inventory file at path, whose contents are content, into an
+// index.  With use_sidecar the index saved in path + ".idx" by an earlier
+// run is mapped instead while the file is unchanged, and a rebuilt index is
+// saved there for the next run.  Malformed rows (only seen when the index
+// is rebuilt) are counted in diagnostics, and a failure to save is written
+// to its out().
+InventoryIndex index_inventory(const std::string& path,
+                               std::string_view content,
+                               char delimiter,
+                               bool use_sidecar,
+                               Diagnostics& diagnostics);
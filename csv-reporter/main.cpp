@@ -1,19 +1,71 @@
 #include "config.h"
 #include "csv_parser.h"
+#include "diagnostics.h"
+#include "inventory_index.h"
+#include "report_server.h"
 #include "reporter.h"
+#include "sales_cache.h"
 
+#include <csignal>
 #include <iostream>
+#include <limits>
+#include <string>
 #include <variant>
 
-int main() {
+namespace {
+
+ReportServer* g_server = nullptr;
+
+extern "C" void stop_server(int) {
+    if (g_server != nullptr) {
+        g_server->stop();
+    }
+}
+
+// --serve: answers report requests on SERVE_SOCKET until SIGINT or SIGTERM.
+int serve(const Config& config) {
+    ReportServer server(config);
+    if (!server.refresh(std::cerr)) {
+        return 1;
+    }
+    g_server = &server;
+    std::signal(SIGINT, stop_server);
+    std::signal(SIGTERM, stop_server);
+    const bool ok = server.serve(config.serve_socket, std::cerr);
+    g_server = nullptr;
+    return ok ? 0 : 1;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    bool serve_mode = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--serve") {
+            serve_mode = true;
+        } else {
+            std::cerr << "[ERROR] Unknown option: '" << arg << "'. Usage: "
+                      << argv[0] << " [--serve]\n";
+            return 1;
+        }
+    }
+
     auto config_result = load_config();
     if (auto* err = std::get_if<std::string>(&config_result)) {
         std::cerr << *err << "\n";
         return 1;
     }
     const auto& config = std::get<Config>(config_result);
+    if (serve_mode) {
+        return serve(config);
+    }
 
-    auto sales_result = read_csv_file(config.sales_file, "SALES_FILE");
+    // A compressed sales file is decompressed while it is streamed, and in
+    // batch runs only when its sales cache cannot be used.
+    const bool incremental = !config.checkpoint_file.empty();
+    const bool stream_sales = !incremental && config.execution_mode == "stream";
+    auto sales_result = read_csv_file(config.sales_file, "SALES_FILE", incremental);
     if (!sales_result.success) {
         std::cerr << sales_result.value << "\n";
         return 1;
@@ -25,20 +77,94 @@ int main() {
         return 1;
     }
 
-    auto sales_rows     = parse_csv_content(sales_result.value,     config.delimiter);
-    auto inventory_rows = parse_csv_content(inventory_result.value, config.delimiter);
+    const std::vector<Query> queries = report_queries(config);
+    double lowest = std::numeric_limits<double>::infinity();
+    for (const auto& q : queries) {
+        if (q.min_amount < lowest) {
+            lowest = q.min_amount;
+        }
+    }
+
+    // Malformed rows are counted per input file; only the first
+    // WARN_SAMPLES of each are reported line by line.
+    Diagnostics sales_warnings(std::cerr, config.warn_limits, "SALES_FILE");
+    Diagnostics inventory_warnings(std::cerr, config.warn_limits, "INVENTORY_FILE");
 
-    auto sales     = parse_sales_rows(sales_rows,     std::cerr);
-    auto inventory = parse_inventory_rows(inventory_rows, std::cerr);
+    const std::string_view inventory_content = inventory_result.file.view();
+    std::vector<QueryResult> results;
+    if (incremental) {
+        // Incremental runs stream the appended rows whatever EXECUTION_MODE
+        // says: the tail is usually small.
+        const auto inventory = index_inventory(config.inventory_file, inventory_content,
+                                               config.delimiter, config.inventory_index,
+                                               inventory_warnings);
 
-    auto joined   = join_with_inventory(sales, inventory);
-    auto filtered = filter_by_amount(joined, config.min_amount);
-    auto summary  = compute_summary(filtered);
+        results = run_queries_incremental(sales_result.file.view(), config.delimiter,
+                                          inventory, hash_key(inventory_content),
+                                          queries, config.checkpoint_file, sales_warnings,
+                                          config.sales_append_only
+                                              ? identify_file(config.sales_file)
+                                              : FileIdentity{});
+    } else if (stream_sales) {
+        // Only the inventory is materialized; sales rows flow straight
+        // through join, filter and accumulation.
+        const auto inventory = index_inventory(config.inventory_file, inventory_content,
+                                               config.delimiter, config.inventory_index,
+                                               inventory_warnings);
 
-    if (config.output_format == "json") {
-        std::cout << format_json(summary) << "\n";
+        if (sales_result.compression == Compression::none) {
+            results = run_queries_stream(sales_result.file.view(), config.delimiter,
+                                         inventory, queries, sales_warnings);
+        } else {
+            DecompressPipe sales(sales_result.file.view(), sales_result.compression);
+            results = run_queries_stream(sales, config.delimiter, inventory, queries,
+                                         sales_warnings);
+            if (!sales.error().empty()) {
+                std::cerr << "[ERROR] Cannot decompress SALES_FILE: " << config.sales_file
+                          << ": " << sales.error() << "\n";
+                return 1;
+            }
+        }
     } else {
-        std::cout << format_csv_output(summary);
+        // The lowest MIN_AMOUNT is applied while parsing, so rows below it
+        // are never interned or joined.
+        auto sales = read_sales_batch(config.sales_file, sales_result.file.view(),
+                                      sales_result.compression, config.delimiter, lowest,
+                                      config.sales_cache, sales_warnings);
+        if (auto* err = std::get_if<std::string>(&sales)) {
+            std::cerr << *err << "\n";
+            return 1;
+        }
+        const auto& batch = std::get<SalesBatch>(sales);
+
+        Selection selection;
+        if (config.inventory_index) {
+            const auto inventory = index_inventory(config.inventory_file, inventory_content,
+                                                   config.delimiter, config.inventory_index,
+                                                   inventory_warnings);
+            selection = join_with_inventory(batch, inventory);
+        } else {
+            auto inventory_rows = parse_csv_content(inventory_content, config.delimiter);
+            auto inventory      = parse_inventory_rows(inventory_rows, inventory_warnings);
+            selection = join_with_inventory(batch, inventory);
+        }
+        results = run_queries(batch, selection, queries);
+    }
+
+    sales_warnings.finish();
+    inventory_warnings.finish();
+    if (!config.warn_summary_file.empty() &&
+        !replace_file(config.warn_summary_file,
+                      "[" + sales_warnings.json() + ", " + inventory_warnings.json() + "]\n")) {
+        std::cerr << "[WARN] Could not write WARN_SUMMARY_FILE " << config.warn_summary_file
+                  << "\n";
+    }
+
+    for (std::size_t q = 0; q < queries.size(); ++q) {
+        if (!config.queries.empty()) {
+            std::cout << "# " << queries[q].name << "\n";
+        }
+        std::cout << format_result(queries[q], results[q]);
     }
 
     return 0;
@@ -0,0 +1,158 @@
+#include "mapped_file.h"
+
+#include "flat_hash.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <system_error>
+#include <utility>
+
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    reset();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        reset();
+        owned_ = other.owned_;
+        if (owned_) {
+            contents_ = std::move(other.contents_);
+            data_ = contents_.data();
+        } else {
+            data_ = other.data_;
+        }
+        size_ = other.size_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.owned_ = false;
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string& path) {
+    reset();
+#ifdef _WIN32
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    assign(std::string(std::istreambuf_iterator<char>(file),
+                       std::istreambuf_iterator<char>()));
+    return true;
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return false;
+    }
+    const auto size = static_cast<std::size_t>(st.st_size);
+    if (size == 0) {
+        // mmap rejects empty mappings; an empty file is simply an empty view
+        close(fd);
+        return true;
+    }
+    void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+    madvise(addr, size, MADV_SEQUENTIAL);
+    data_ = static_cast<const char*>(addr);
+    size_ = size;
+    return true;
+#endif
+}
+
+void MappedFile::assign(std::string contents) {
+    reset();
+    contents_ = std::move(contents);
+    data_ = contents_.data();
+    size_ = contents_.size();
+    owned_ = true;
+}
+
+void MappedFile::reset() {
+#ifndef _WIN32
+    if (!owned_ && data_ != nullptr && size_ > 0) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+    contents_ = std::string();
+    data_ = nullptr;
+    size_ = 0;
+    owned_ = false;
+}
+
+bool replace_file(const std::string& path, std::string_view bytes) {
+    // A name of its own per writer: two runs replacing path at once must
+    // not write into the same temporary file.
+    const std::string temp = path + ".tmp" + std::to_string(std::random_device{}());
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out.write(bytes.data(), static_cast<std::streamsize>(bytes.size())) ||
+            !out.flush()) {
+            out.close();
+            std::remove(temp.c_str());
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp, path, ec);
+    if (ec) {
+        std::remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+FileStamp stamp_file(const std::string& path,
+                     std::string_view content,
+                     char delimiter) {
+    FileStamp stamp;
+    stamp.size = content.size();
+    std::error_code ec;
+    const auto mtime = std::filesystem::last_write_time(path, ec);
+    if (!ec) {
+        stamp.mtime = static_cast<std::int64_t>(mtime.time_since_epoch().count());
+    }
+    stamp.hash = hash_key(content);
+    stamp.delimiter = delimiter;
+    return stamp;
+}
+
+FileIdentity identify_file(const std::string& path) {
+    FileIdentity identity;
+#ifndef _WIN32
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) {
+        return identity;
+    }
+    identity.device = static_cast<std::uint64_t>(st.st_dev);
+    identity.inode = static_cast<std::uint64_t>(st.st_ino);
+#endif
+    std::error_code ec;
+    const auto mtime = std::filesystem::last_write_time(path, ec);
+    if (!ec) {
+        identity.mtime = static_cast<std::int64_t>(mtime.time_since_epoch().count());
+    }
+    return identity;
+}
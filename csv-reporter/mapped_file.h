@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Read-only view of a whole file, backed by mmap(2) so that large inputs are
+// paged in on demand instead of being copied into a std::string.  Move-only;
+// the mapping is released when the object is destroyed.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Maps the regular file at path, hinting sequential access.  Returns false
+    // (leaving the object empty) if it cannot be opened or mapped.
+    bool open(const std::string& path);
+
+    // Replaces the mapping with contents held in memory, e.g. a file's
+    // decompressed bytes.
+    void assign(std::string contents);
+
+    std::string_view view() const { return {data_, size_}; }
+
+private:
+    void reset();
+
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+    bool owned_ = false;     // data_ points into contents_, not a mapping
+    std::string contents_;   // assign()ed bytes, or the file itself where there is no mmap
+};
+
+// Replaces the file at path with bytes by writing a temporary file next to
+// it and renaming it over path, so readers see either the old or the new
+// contents, never a partial file.  Returns false if either step fails.
+bool replace_file(const std::string& path, std::string_view bytes);
+
+// Identifies the contents of a file that something derived from it (an
+// index, a cache) was built from.  A saved derivative is only reused while
+// all fields still match.
+struct FileStamp {
+    std::uint64_t size = 0;
+    std::int64_t mtime = 0;     // file_time_type ticks
+    std::uint64_t hash = 0;     // hash_key of the whole file
+    char delimiter = ',';
+};
+
+// Stamps the file at path, whose contents are content.
+FileStamp stamp_file(const std::string& path,
+                     std::string_view content,
+                     char delimiter);
+
+// Which file a path names, and when it was last written.  A file replaced
+// under the same path gets another inode.  All zero where unknown.
+struct FileIdentity {
+    std::uint64_t device = 0;
+    std::uint64_t inode = 0;
+    std::int64_t mtime = 0;     // file_time_type ticks
+};
+
+FileIdentity identify_file(const std::string& path);
@@ -0,0 +1,122 @@
+#include "product_dictionary.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr std::size_t kBlockBytes = 64 * 1024;
+
+constexpr std::uint64_t kDictionaryMagic = 0x3154434944444f52ULL;  // "RODDICT1"
+
+// Start of a serialized dictionary.  size + 1 name offsets follow, then the
+// name bytes padded to a multiple of 8, then the FlatStringMap of codes.
+struct DictionaryHeader {
+    std::uint64_t magic;
+    std::uint64_t size;
+    std::uint64_t name_bytes;
+};
+
+std::size_t padded(std::size_t n) {
+    return (n + 7) & ~std::size_t{7};
+}
+
+}  // namespace
+
+std::uint32_t ProductDictionary::intern(std::string_view id) {
+    const std::uint64_t hash = hash_key(id);
+    const std::uint32_t found = codes_.find(id, hash);
+    if (found != FlatStringMap::kNotFound) {
+        return found;
+    }
+    const auto code = static_cast<std::uint32_t>(names_.size());
+    const std::string_view stored = store(id);
+    names_.push_back(stored);
+    codes_.insert(stored, hash, code);
+    return code;
+}
+
+std::uint32_t ProductDictionary::find(std::string_view id) const {
+    const std::uint32_t found = codes_.find(id);
+    return (found != FlatStringMap::kNotFound) ? found : kNotFound;
+}
+
+// Copies id into the arena.  IDs longer than a block get a block of their own.
+std::string_view ProductDictionary::store(std::string_view id) {
+    if (id.size() > block_free_) {
+        const std::size_t bytes = std::max(kBlockBytes, id.size());
+        blocks_.push_back(std::make_unique<char[]>(bytes));
+        block_next_ = blocks_.back().get();
+        block_free_ = bytes;
+    }
+    if (!id.empty()) {
+        std::memcpy(block_next_, id.data(), id.size());
+    }
+    const std::string_view stored(block_next_, id.size());
+    block_next_ += id.size();
+    block_free_ -= id.size();
+    return stored;
+}
+
+void ProductDictionary::serialize(std::string& out) const {
+    std::vector<std::uint64_t> offsets;
+    offsets.reserve(names_.size() + 1);
+    offsets.push_back(0);
+    for (const std::string_view name : names_) {
+        offsets.push_back(offsets.back() + name.size());
+    }
+    const DictionaryHeader header{kDictionaryMagic, names_.size(), offsets.back()};
+    out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.append(reinterpret_cast<const char*>(offsets.data()),
+               offsets.size() * sizeof(std::uint64_t));
+    for (const std::string_view name : names_) {
+        out.append(name);
+    }
+    out.append(padded(offsets.back()) - offsets.back(), '\0');
+    codes_.serialize(out);
+}
+
+bool ProductDictionary::attach(std::string_view bytes) {
+    DictionaryHeader header;
+    if (bytes.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    bytes.remove_prefix(sizeof(header));
+    if (header.magic != kDictionaryMagic ||
+        header.size >= bytes.size() / sizeof(std::uint64_t)) {
+        return false;
+    }
+    const auto* offsets = reinterpret_cast<const std::uint64_t*>(bytes.data());
+    const std::size_t offset_bytes = (header.size + 1) * sizeof(std::uint64_t);
+    if (offsets[0] != 0 || offsets[header.size] != header.name_bytes ||
+        header.name_bytes > bytes.size() - offset_bytes) {
+        return false;
+    }
+    const char* name_bytes = bytes.data() + offset_bytes;
+    const std::size_t table_start = offset_bytes + padded(header.name_bytes);
+    if (table_start > bytes.size()) {
+        return false;
+    }
+
+    std::vector<std::string_view> names;
+    names.reserve(header.size);
+    for (std::uint64_t i = 0; i < header.size; ++i) {
+        if (offsets[i + 1] < offsets[i] || offsets[i + 1] > header.name_bytes) {
+            return false;
+        }
+        names.emplace_back(name_bytes + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+    FlatStringMap codes;
+    if (!codes.attach(bytes.substr(table_start), static_cast<std::uint32_t>(names.size())) ||
+        codes.size() != names.size()) {
+        return false;
+    }
+
+    blocks_.clear();
+    block_next_ = nullptr;
+    block_free_ = 0;
+    names_ = std::move(names);
+    codes_ = std::move(codes);
+    return true;
+}
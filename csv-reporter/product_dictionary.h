@@ -0,0 +1,56 @@
+#pragma once
+
+#include "flat_hash.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Interns product IDs into dense codes 0, 1, 2, ... in first-seen order, so
+// that joins and grouping can work on integers and each distinct ID is
+// stored once.  The ID bytes live in an arena of fixed blocks that never
+// move; views returned by name() stay valid for the dictionary's lifetime.
+// Like FlatStringMap, a dictionary can be serialized and attached again,
+// read-only, to the bytes.  Move-only.
+class ProductDictionary {
+public:
+    static constexpr std::uint32_t kNotFound = UINT32_MAX;
+
+    ProductDictionary() = default;
+    ProductDictionary(ProductDictionary&&) noexcept = default;
+    ProductDictionary& operator=(ProductDictionary&&) noexcept = default;
+
+    ProductDictionary(const ProductDictionary&) = delete;
+    ProductDictionary& operator=(const ProductDictionary&) = delete;
+
+    // Returns the code of id, assigning the next free code if it is new.
+    std::uint32_t intern(std::string_view id);
+
+    // Returns the code of id, or kNotFound.
+    std::uint32_t find(std::string_view id) const;
+
+    std::string_view name(std::uint32_t code) const { return names_[code]; }
+    std::size_t size() const { return names_.size(); }
+
+    // Appends the dictionary to out in the form attach() reads.
+    void serialize(std::string& out) const;
+
+    // Makes this a read-only view of a dictionary written by serialize():
+    // names are viewed in bytes and codes found through the serialized
+    // table.  bytes must be 8-byte aligned and outlive the dictionary;
+    // intern() must not be called afterwards.  Returns false, leaving the
+    // dictionary unchanged, if bytes are malformed.
+    bool attach(std::string_view bytes);
+
+private:
+    std::string_view store(std::string_view id);
+
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char* block_next_ = nullptr;   // first unused byte of blocks_.back()
+    std::size_t block_free_ = 0;
+    std::vector<std::string_view> names_;
+    FlatStringMap codes_;
+};
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <string>
+
+// One report of a QUERY_FILE: the MIN_AMOUNT, OUTPUT_FORMAT and
+// OUTPUT_GROUP_BY settings of a single run, under a name.
+struct Query {
+    std::string name;
+    double min_amount = 0.0;
+    std::string output_format = "json";
+    std::string group_by;
+};
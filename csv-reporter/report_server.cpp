@@ -0,0 +1,514 @@
+#include "report_server.h"
+
+#include "decompress.h"
+#include "diagnostics.h"
+#include "flat_hash.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <sstream>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#if !defined(_WIN32) && !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace {
+
+// How often serve() looks for changes where inotify is not available.
+constexpr int kRescanMillis = 1000;
+
+// Longest request line read from a client.
+constexpr std::size_t kMaxRequestBytes = 4096;
+
+// How long serve() lets a burst of file change events settle before it
+// refreshes.
+constexpr int kCoalesceMillis = 50;
+
+// Connections served at once; more wait in the listen backlog.
+constexpr std::size_t kMaxClients = 256;
+
+// A client that neither sends nor takes any bytes for this long is dropped.
+constexpr int kClientMillis = 1000;
+
+std::int64_t mtime_of(const std::string& path) {
+    std::error_code ec;
+    const auto mtime = std::filesystem::last_write_time(path, ec);
+    return ec ? 0 : static_cast<std::int64_t>(mtime.time_since_epoch().count());
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+}  // namespace
+
+ReportServer::ReportServer(Config config)
+    : config_(std::move(config)), queries_(report_queries(config_)) {}
+
+bool ReportServer::refresh(std::ostream& log) {
+    auto inventory_file = read_csv_file(config_.inventory_file, "INVENTORY_FILE");
+    if (!inventory_file.success) {
+        log << inventory_file.value << "\n";
+        return false;
+    }
+    // Only the appended lines are read at each refresh, which a compressed
+    // file would have to be decompressed from its start for.
+    auto sales_file = read_csv_file(config_.sales_file, "SALES_FILE", false);
+    if (!sales_file.success) {
+        log << sales_file.value << "\n";
+        return false;
+    }
+    if (sales_file.compression != Compression::none) {
+        log << "[ERROR] --serve needs an uncompressed SALES_FILE: " << config_.sales_file
+            << " is " << compression_name(sales_file.compression) << "-compressed\n";
+        return false;
+    }
+
+    // The inventory is only hashed when its size or mtime moved, and only
+    // re-indexed when its contents changed.
+    const std::string_view inventory_content = inventory_file.file.view();
+    const std::int64_t mtime = mtime_of(config_.inventory_file);
+    if (!inventory_ || inventory_content.size() != inventory_size_ || mtime != inventory_mtime_) {
+        const std::uint64_t hash = hash_key(inventory_content);
+        if (!inventory_ || hash != inventory_hash_) {
+            Diagnostics warnings(log, config_.warn_limits, "INVENTORY_FILE");
+            inventory_ = index_inventory(config_.inventory_file, inventory_content,
+                                         config_.delimiter, config_.inventory_index, warnings);
+            warnings.finish();
+            inventory_hash_ = hash;
+            sales_.reset();
+        }
+        inventory_size_ = inventory_content.size();
+        inventory_mtime_ = mtime;
+    }
+
+    if (!sales_) {
+        sales_.emplace(queries_, config_.delimiter, inventory_hash_);
+        MappedFile checkpoint;
+        if (!config_.checkpoint_file.empty() && checkpoint.open(config_.checkpoint_file)) {
+            sales_->load(checkpoint.view());
+        }
+    }
+    // WARN_SAMPLES applies to the rows each refresh reads.
+    Diagnostics warnings(log, config_.warn_limits, "SALES_FILE");
+    sales_->update(sales_file.file.view(), *inventory_, warnings,
+                   config_.sales_append_only ? identify_file(config_.sales_file)
+                                             : FileIdentity{});
+    warnings.finish();
+    if (!config_.checkpoint_file.empty() &&
+        !replace_file(config_.checkpoint_file, sales_->save())) {
+        log << "[WARN] Could not write checkpoint " << config_.checkpoint_file << "\n";
+    }
+
+    const auto results = sales_->results();
+    auto reports = std::make_shared<std::vector<std::string>>();
+    for (std::size_t q = 0; q < queries_.size(); ++q) {
+        reports->push_back(format_result(queries_[q], results[q]));
+    }
+    std::atomic_store(&reports_, std::shared_ptr<const std::vector<std::string>>(reports));
+    return true;
+}
+
+std::string ReportServer::handle_request(std::string_view request) const {
+    request = trim(request);
+    const auto reports = std::atomic_load(&reports_);
+    if (!reports) {
+        return "[ERROR] No report is available yet\n";
+    }
+
+    std::string reply;
+    for (std::size_t q = 0; q < queries_.size(); ++q) {
+        if (request.empty()) {
+            if (!config_.queries.empty()) {
+                reply += "# " + queries_[q].name + "\n";
+            }
+            reply += (*reports)[q];
+        } else if (request == queries_[q].name) {
+            return (*reports)[q];
+        }
+    }
+    if (reply.empty()) {
+        return "[ERROR] Unknown query: '" + std::string(request) + "'\n";
+    }
+    return reply;
+}
+
+void ReportServer::stop() {
+    stopping_ = true;
+#ifndef _WIN32
+    const int fd = wake_fd_;
+    if (fd >= 0) {
+        const char byte = 0;
+        (void)!::write(fd, &byte, 1);
+    }
+#endif
+}
+
+#ifdef _WIN32
+
+bool ReportServer::serve(const std::string&, std::ostream& log) {
+    log << "[ERROR] --serve is not supported on this platform\n";
+    return false;
+}
+
+#else
+
+namespace {
+
+// One connection, served without blocking: the request line is read as
+// it arrives, then the reply is sent as the socket takes it.
+struct Client {
+    int fd = -1;
+    std::string request;
+    std::string reply;
+    std::size_t sent = 0;
+    bool replying = false;
+    std::chrono::steady_clock::time_point deadline;
+
+    // Reads what has arrived; once the request line is complete, takes its
+    // reply from server.  Returns false when the connection is done with.
+    bool receive(const ReportServer& server) {
+        char buf[512];
+        for (;;) {
+            const ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                return true;
+            }
+            if (n > 0) {
+                request.append(buf, static_cast<std::size_t>(n));
+            }
+            if (n <= 0 || request.size() >= kMaxRequestBytes ||
+                request.find('\n') != std::string::npos) {
+                if (n < 0) {
+                    return false;
+                }
+                reply = server.handle_request(request.substr(0, request.find('\n')));
+                replying = true;
+                return send_reply();
+            }
+        }
+    }
+
+    // Sends what the socket takes.  Returns false once the reply is sent
+    // or the connection failed.
+    bool send_reply() {
+        while (sent < reply.size()) {
+            const ssize_t n = ::send(fd, reply.data() + sent, reply.size() - sent,
+                                     MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                return true;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            sent += static_cast<std::size_t>(n);
+        }
+        return false;
+    }
+};
+
+// Removes a socket that an earlier server left at path.  Returns false,
+// touching nothing, if something other than a socket is there or a server
+// still accepts connections on it.
+bool remove_stale_socket(const std::string& path, const sockaddr_un& addr, std::ostream& log) {
+    struct stat st;
+    if (::lstat(path.c_str(), &st) != 0) {
+        if (errno == ENOENT) {
+            return true;
+        }
+        log << "[ERROR] Cannot inspect SERVE_SOCKET '" << path << "': "
+            << std::strerror(errno) << "\n";
+        return false;
+    }
+    if (!S_ISSOCK(st.st_mode)) {
+        log << "[ERROR] SERVE_SOCKET '" << path << "' exists and is not a socket\n";
+        return false;
+    }
+    const int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    const bool refused =
+        probe >= 0 &&
+        ::connect(probe, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 &&
+        errno == ECONNREFUSED;
+    if (probe >= 0) {
+        ::close(probe);
+    }
+    if (!refused) {
+        log << "[ERROR] SERVE_SOCKET '" << path << "' is in use by another server\n";
+        return false;
+    }
+    ::unlink(path.c_str());
+    return true;
+}
+
+#ifdef __linux__
+// Reads every pending event; returns true if one concerns a file in names
+// (or events were lost).
+bool drain_events(int watch, const std::vector<std::string>& names) {
+    bool changed = false;
+    alignas(inotify_event) char buf[4096];
+    for (;;) {
+        const ssize_t n = ::read(watch, buf, sizeof(buf));
+        if (n <= 0) {
+            return changed;
+        }
+        for (ssize_t i = 0; i < n;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(buf + i);
+            if (event->mask & IN_Q_OVERFLOW) {
+                changed = true;
+            } else if (event->len > 0) {
+                const std::string name(event->name);
+                for (const auto& watched : names) {
+                    changed = changed || name == watched;
+                }
+            }
+            i += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        }
+    }
+}
+#endif
+
+}  // namespace
+
+bool ReportServer::serve(const std::string& socket_path, std::ostream& log) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (socket_path.empty() || socket_path.size() >= sizeof(addr.sun_path)) {
+        log << "[ERROR] SERVE_SOCKET must be a path of 1 to "
+            << sizeof(addr.sun_path) - 1 << " bytes: '" << socket_path << "'\n";
+        return false;
+    }
+    std::memcpy(addr.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    if (!remove_stale_socket(socket_path, addr, log)) {
+        return false;
+    }
+    const int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        log << "[ERROR] Cannot create socket: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    if (::bind(listener, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(listener, 64) != 0) {
+        log << "[ERROR] Cannot listen on SERVE_SOCKET '" << socket_path
+            << "': " << std::strerror(errno) << "\n";
+        ::close(listener);
+        return false;
+    }
+    ::fcntl(listener, F_SETFL, O_NONBLOCK);
+    // Only this socket is removed at the end, not one that replaced it.
+    struct stat bound;
+    const bool have_bound = ::lstat(socket_path.c_str(), &bound) == 0;
+    auto remove_socket = [&] {
+        struct stat st;
+        if (have_bound && ::lstat(socket_path.c_str(), &st) == 0 &&
+            st.st_dev == bound.st_dev && st.st_ino == bound.st_ino) {
+            ::unlink(socket_path.c_str());
+        }
+    };
+
+    // stop() writes to this pipe to interrupt poll().
+    int wake[2];
+    if (::pipe(wake) != 0) {
+        log << "[ERROR] Cannot create pipe: " << std::strerror(errno) << "\n";
+        ::close(listener);
+        remove_socket();
+        return false;
+    }
+    ::fcntl(wake[0], F_SETFL, O_NONBLOCK);
+    ::fcntl(wake[1], F_SETFL, O_NONBLOCK);
+    wake_fd_ = wake[1];
+
+    int watch = -1;
+    std::vector<std::string> names;
+#ifdef __linux__
+    // Directories are watched rather than the files themselves, so that a
+    // file replaced by a rename is still seen.
+    watch = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    for (const std::string& file : {config_.sales_file, config_.inventory_file}) {
+        const std::filesystem::path path(file);
+        const std::string dir = path.has_parent_path() ? path.parent_path().string() : ".";
+        names.push_back(path.filename().string());
+        if (watch >= 0 &&
+            ::inotify_add_watch(watch, dir.c_str(),
+                                IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE |
+                                    IN_ATTRIB) < 0) {
+            ::close(watch);
+            watch = -1;
+        }
+    }
+#endif
+
+    // Both threads write to log, one message at a time.
+    std::mutex log_mutex;
+    auto write_log = [&](const std::string& text) {
+        if (!text.empty()) {
+            std::lock_guard<std::mutex> lock(log_mutex);
+            log << text << std::flush;
+        }
+    };
+    if (watch < 0) {
+        write_log("[WARN] File change notification unavailable; checking every " +
+                  std::to_string(kRescanMillis) + " ms\n");
+    }
+
+    // The refresh thread waits for a change, lets the rest of its burst of
+    // events arrive for kCoalesceMillis, and refreshes once.  Events during
+    // a refresh cause one more.  Without inotify it refreshes every
+    // kRescanMillis.
+    std::mutex refresh_mutex;
+    std::condition_variable refresh_wanted;
+    bool dirty = false;
+    bool finished = false;
+    std::thread refresher([&] {
+        std::unique_lock<std::mutex> lock(refresh_mutex);
+        for (;;) {
+            if (watch >= 0) {
+                refresh_wanted.wait(lock, [&] { return dirty || finished; });
+                refresh_wanted.wait_for(lock, std::chrono::milliseconds(kCoalesceMillis),
+                                        [&] { return finished; });
+            } else {
+                refresh_wanted.wait_for(lock, std::chrono::milliseconds(kRescanMillis),
+                                        [&] { return finished; });
+            }
+            if (finished) {
+                return;
+            }
+            dirty = false;
+            lock.unlock();
+            std::ostringstream messages;
+            refresh(messages);
+            write_log(messages.str());
+            lock.lock();
+        }
+    });
+
+    std::vector<Client> clients;
+    std::vector<pollfd> fds;
+    while (!stopping_) {
+        // listener, wake, watch (ignored when negative), then the clients.
+        fds.assign({{clients.size() < kMaxClients ? listener : -1, POLLIN, 0},
+                    {wake[0], POLLIN, 0},
+                    {watch, POLLIN, 0}});
+        const auto now = std::chrono::steady_clock::now();
+        int timeout = -1;
+        for (const Client& c : clients) {
+            fds.push_back({c.fd, static_cast<short>(c.replying ? POLLOUT : POLLIN), 0});
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                c.deadline - now).count();
+            const int wait = static_cast<int>(std::max<decltype(left)>(0, left) + 1);
+            timeout = (timeout < 0) ? wait : std::min(timeout, wait);
+        }
+        const int ready = ::poll(fds.data(), fds.size(), timeout);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            write_log(std::string("[ERROR] poll failed: ") + std::strerror(errno) + "\n");
+            break;
+        }
+
+#ifdef __linux__
+        if (watch >= 0 && (fds[2].revents & POLLIN) && drain_events(watch, names)) {
+            std::lock_guard<std::mutex> lock(refresh_mutex);
+            dirty = true;
+            refresh_wanted.notify_one();
+        }
+#endif
+        if (fds[1].revents & POLLIN) {
+            char drained[64];
+            while (::read(wake[0], drained, sizeof(drained)) > 0) {
+            }
+        }
+
+        // Clients, then new connections; a client that makes no progress
+        // for kClientMillis is dropped.
+        const auto deadline = std::chrono::steady_clock::now() +
+                              std::chrono::milliseconds(kClientMillis);
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < clients.size(); ++i) {
+            Client& c = clients[i];
+            const short revents = fds[3 + i].revents;
+            bool open = true;
+            if (revents & (POLLIN | POLLOUT | POLLHUP | POLLERR)) {
+                open = c.replying ? c.send_reply() : c.receive(*this);
+                c.deadline = deadline;
+            } else if (std::chrono::steady_clock::now() >= c.deadline) {
+                open = false;
+            }
+            if (open) {
+                clients[kept++] = std::move(c);
+            } else {
+                ::close(c.fd);
+            }
+        }
+        clients.resize(kept);
+        if (fds[0].revents & POLLIN) {
+            while (clients.size() < kMaxClients) {
+                const int fd = ::accept(listener, nullptr, nullptr);
+                if (fd < 0) {
+                    break;
+                }
+                ::fcntl(fd, F_SETFL, O_NONBLOCK);
+                Client c;
+                c.fd = fd;
+                c.deadline = deadline;
+                clients.push_back(std::move(c));
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(refresh_mutex);
+        finished = true;
+        refresh_wanted.notify_one();
+    }
+    refresher.join();
+    for (const Client& c : clients) {
+        ::close(c.fd);
+    }
+    wake_fd_ = -1;
+    ::close(wake[0]);
+    ::close(wake[1]);
+    if (watch >= 0) {
+        ::close(watch);
+    }
+    ::close(listener);
+    remove_socket();
+    return true;
+}
+
+#endif
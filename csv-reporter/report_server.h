@@ -0,0 +1,73 @@
+#pragma once
+
+#include "config.h"
+#include "inventory_index.h"
+#include "reporter.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Resident csv_reporter (--serve).  Keeps the inventory index and every
+// query's aggregates in memory, brings them up to date when SALES_FILE or
+// INVENTORY_FILE changes, and answers report requests over a Unix domain
+// socket from reports formatted at the last refresh.  Refreshes run on a
+// thread of their own and publish the new reports all at once, so requests
+// never wait for one.
+//
+// Protocol: the client sends one line -- empty for every report, or the
+// name of a QUERY_FILE query for that one -- and reads the reply, exactly
+// what csv_reporter would print, until the server closes the connection.
+class ReportServer {
+public:
+    explicit ReportServer(Config config);
+
+    // Brings the reports up to date.  A changed INVENTORY_FILE rebuilds the
+    // index and rescans the sales; otherwise only the complete lines
+    // appended to SALES_FILE are read (a rewritten file is rescanned).  A
+    // last line without its newline waits for the next refresh.  With a
+    // CHECKPOINT_FILE, the first refresh resumes from it and every refresh
+    // saves it.  Returns false, keeping the previous reports, if a file
+    // cannot be read or SALES_FILE is compressed; messages and warnings go
+    // to log.  Must not run
+    // during serve(), which refreshes on its own thread.
+    bool refresh(std::ostream& log);
+
+    // The reply to one request line (without its newline).  Safe to call
+    // from any thread, also during a refresh.
+    std::string handle_request(std::string_view request) const;
+
+    // Listens on socket_path and answers requests until stop(), refreshing
+    // on a worker thread whenever the watched files change (inotify where
+    // available, with a burst of events coalesced into one refresh; else
+    // once a second).  Clients are served without blocking, so a slow one
+    // holds up no other.  A socket left behind at socket_path by a server
+    // that is gone is replaced; anything else there is an error.  Returns
+    // false if the socket cannot be set up.
+    bool serve(const std::string& socket_path, std::ostream& log);
+
+    // Makes serve() return.  Safe to call from a signal handler or another
+    // thread.
+    void stop();
+
+private:
+    Config config_;
+    std::vector<Query> queries_;
+
+    std::optional<InventoryIndex> inventory_;
+    std::uint64_t inventory_size_ = 0;
+    std::int64_t inventory_mtime_ = 0;
+    std::uint64_t inventory_hash_ = 0;
+    std::optional<IncrementalQueries> sales_;
+
+    // Per query, formatted at the last refresh; swapped atomically.
+    std::shared_ptr<const std::vector<std::string>> reports_;
+
+    std::atomic<bool> stopping_{false};
+    std::atomic<int> wake_fd_{-1};       // write end of serve()'s self-pipe
+};
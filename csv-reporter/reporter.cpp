@@ -1,24 +1,216 @@
 #include "reporter.h"
 
-#include <fstream>
+#include "flat_hash.h"
+#include "inventory_index.h"
+#include "stable_sum.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <iomanip>
+#include <limits>
+#include <memory>
 #include <sstream>
-#include <unordered_set>
+#include <thread>
+#include <utility>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+
+inline unsigned popcount(std::uint64_t bits) {
+#if defined(_MSC_VER)
+    return static_cast<unsigned>(__popcnt64(bits));
+#else
+    return static_cast<unsigned>(__builtin_popcountll(bits));
+#endif
+}
+
+// Bit j is set when amounts[j] >= min_amount, for the n <= 64 amounts.
+inline std::uint64_t amount_mask(const double* amounts, std::size_t n, double min_amount) {
+    std::uint64_t bits = 0;
+    std::size_t j = 0;
+#if defined(__AVX2__)
+    const __m256d threshold = _mm256_set1_pd(min_amount);
+    for (; j + 4 <= n; j += 4) {
+        const __m256d ge = _mm256_cmp_pd(_mm256_loadu_pd(amounts + j), threshold, _CMP_GE_OQ);
+        bits |= static_cast<std::uint64_t>(_mm256_movemask_pd(ge)) << j;
+    }
+#elif defined(__SSE2__)
+    const __m128d threshold = _mm_set1_pd(min_amount);
+    for (; j + 2 <= n; j += 2) {
+        const __m128d ge = _mm_cmpge_pd(_mm_loadu_pd(amounts + j), threshold);
+        bits |= static_cast<std::uint64_t>(_mm_movemask_pd(ge)) << j;
+    }
+#endif
+    for (; j < n; ++j) {
+        if (amounts[j] >= min_amount) {
+            bits |= std::uint64_t{1} << j;
+        }
+    }
+    return bits;
+}
+
+inline unsigned lowest_bit(std::uint64_t bits) {
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanForward64(&index, bits);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(bits));
+#endif
+}
+
+// Summaries are split across threads only above this many selected rows.
+constexpr std::size_t kMinParallelRows = std::size_t{1} << 20;
+
+// Selection words per block when compute_product_summaries hands rows to
+// the threads that own their chunks.
+constexpr std::size_t kGroupBlockWords = 1024;
+
+// A product's amounts are summed in chunks of this many of its own rows.
+constexpr std::uint64_t kGroupChunkRows = 1024;
+
+// Accumulates the selected amounts that fall into StableSum blocks
+// [first_block, last_block) of the selected-row sequence.  first_selected[w]
+// is the number of selected rows before selection word w.
+void sum_blocks(const SalesBatch& sales, const Selection& selection,
+                const std::vector<std::size_t>& first_selected,
+                std::size_t first_block, std::size_t last_block,
+                std::vector<StableSum::Block>& blocks) {
+    const std::size_t total = first_selected.back();
+    std::size_t next = first_block * StableSum::kBlockSize;
+    const std::size_t end = std::min(total, last_block * StableSum::kBlockSize);
+    if (next >= end) {
+        return;
+    }
+
+    // Find the word holding selected row number `next`, and drop the
+    // selected rows before it.
+    std::size_t w = static_cast<std::size_t>(
+        std::upper_bound(first_selected.begin(), first_selected.end(), next) -
+        first_selected.begin()) - 1;
+    std::uint64_t bits = selection[w];
+    for (std::size_t skip = next - first_selected[w]; skip > 0; --skip) {
+        bits &= bits - 1;
+    }
+
+    std::size_t b = first_block;
+    for (; next < end; ++next) {
+        while (bits == 0) {
+            bits = selection[++w];
+        }
+        blocks[b].add(sales.amounts[w * 64 + lowest_bit(bits)]);
+        bits &= bits - 1;
+        if (blocks[b].full()) {
+            ++b;
+        }
+    }
+}
+
+// Runs work(0) ... work(threads - 1) on threads of their own and waits for
+// all of them.
+template <class Work>
+void run_on_threads(unsigned threads, Work& work) {
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&work, t] { work(t); });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+}
+
+// Running count and compensated total of one product.  Each chunk of
+// kGroupChunkRows amounts is summed from zero and then merged into the
+// total, chunk after chunk, so that threads can sum the chunks of one hot
+// product separately and still give the same bits.
+struct GroupPartial {
+    std::uint64_t count = 0;
+    StableSum::Partial total;   // the complete chunks
+    StableSum::Partial chunk;   // the current one
+
+    void add(double amount) {
+        chunk = StableSum::accumulate(chunk, amount);
+        if (++count % kGroupChunkRows == 0) {
+            total = StableSum::merge(total, chunk);
+            chunk = StableSum::Partial();
+        }
+    }
+
+    StableSum::Partial sum() const {
+        return count % kGroupChunkRows == 0 ? total : StableSum::merge(total, chunk);
+    }
+};
+
+// Turns the partials of the products that have rows into summaries, ordered
+// by product_id.
+std::vector<ProductSummary> to_product_summaries(
+    const ProductDictionary& products, const std::vector<GroupPartial>& groups) {
+
+    std::vector<ProductSummary> result;
+    for (std::uint32_t code = 0; code < groups.size(); ++code) {
+        const GroupPartial& g = groups[code];
+        if (g.count == 0) {
+            continue;
+        }
+        ProductSummary p;
+        p.product_id = std::string(products.name(code));
+        p.summary.count = static_cast<int>(g.count);
+        p.summary.total = StableSum::to_double(g.sum());
+        p.summary.average = p.summary.total / p.summary.count;
+        result.push_back(std::move(p));
+    }
+    std::sort(result.begin(), result.end(),
+              [](const ProductSummary& a, const ProductSummary& b) {
+                  return a.product_id < b.product_id;
+              });
+    return result;
+}
+
+// Number of keys hashed and prefetched ahead of the one being probed.
+constexpr std::size_t kProbeLookahead = 8;
+
+}  // namespace
 
 // ---------------------------------------------------------------------------
 // File I/O
 // ---------------------------------------------------------------------------
 
 ReadResult read_csv_file(const std::string& path,
-                         const std::string& var_name) {
-    std::ifstream file(path);
-    if (!file.is_open()) {
-        return {false,
-                "[ERROR] Cannot open " + var_name + ": " + path};
+                         const std::string& var_name,
+                         bool decompress) {
+    ReadResult result;
+    if (!result.file.open(path)) {
+        result.value = "[ERROR] Cannot open " + var_name + ": " + path;
+        return result;
     }
-    std::ostringstream ss;
-    ss << file.rdbuf();
-    return {true, ss.str()};
+    result.compression = detect_compression(result.file.view());
+    if (result.compression != Compression::none) {
+        if (!compression_supported(result.compression)) {
+            result.value = "[ERROR] Cannot read " + var_name + ": " + path + " is " +
+                           compression_name(result.compression) +
+                           "-compressed, which this build does not support";
+            return result;
+        }
+        if (decompress) {
+            std::string content;
+            std::string error;
+            if (!decompress_all(result.file.view(), result.compression, content, error)) {
+                result.value = "[ERROR] Cannot decompress " + var_name + ": " + path +
+                               ": " + error;
+                return result;
+            }
+            result.file.assign(std::move(content));
+        }
+    }
+    result.success = true;
+    return result;
 }
 
 // ---------------------------------------------------------------------------
@@ -26,70 +218,114 @@ ReadResult read_csv_file(const std::string& path,
 // ---------------------------------------------------------------------------
 
 std::vector<SalesRecord> parse_sales_rows(
-    const std::vector<IndexedRow>& all_rows,
-    std::ostream& warnings_out) {
+    const CsvTable& table,
+    Diagnostics& diagnostics) {
 
     std::vector<SalesRecord> result;
-    bool skip_header = true;
+    result.reserve(table.size());
+    LineIndex lines(table.content);
 
-    for (const auto& [line_num, row] : all_rows) {
-        if (skip_header) {
-            skip_header = false;
+    // Row 0 is the header
+    for (std::size_t r = 1; r < table.size(); ++r) {
+        auto line_of = [&] { return lines.line_of(table.row_offset(r)); };
+        if (table.field_count(r) < 3) {
+            diagnostics.skip_row(RowProblem::insufficient_columns, line_of);
             continue;
         }
-        if (row.size() < 3) {
-            warnings_out << "[WARN] Skipping malformed row at line "
-                         << line_num
-                         << ": insufficient columns\n";
+        SalesRecord rec;
+        rec.order_id   = std::string(table.field(r, 0));
+        rec.product_id = std::string(table.field(r, 1));
+        if (!parse_double(table.field(r, 2), rec.amount)) {
+            diagnostics.skip_row(RowProblem::invalid_amount, line_of);
             continue;
         }
-        SalesRecord rec;
-        rec.order_id   = row[0];
-        rec.product_id = row[1];
-        try {
-            rec.amount = std::stod(row[2]);
-        } catch (...) {
-            warnings_out << "[WARN] Skipping malformed row at line "
-                         << line_num
-                         << ": invalid amount value\n";
+        result.push_back(std::move(rec));
+    }
+    return result;
+}
+
+std::vector<SalesRecord> parse_sales_rows(
+    const CsvTable& table,
+    std::ostream& warnings_out) {
+    Diagnostics diagnostics(warnings_out);
+    return parse_sales_rows(table, diagnostics);
+}
+
+std::vector<InventoryRecord> parse_inventory_rows(
+    const CsvTable& table,
+    Diagnostics& diagnostics) {
+
+    std::vector<InventoryRecord> result;
+    result.reserve(table.size());
+    LineIndex lines(table.content);
+
+    // Row 0 is the header
+    for (std::size_t r = 1; r < table.size(); ++r) {
+        auto line_of = [&] { return lines.line_of(table.row_offset(r)); };
+        if (table.field_count(r) < 2) {
+            diagnostics.skip_row(RowProblem::insufficient_columns, line_of);
             continue;
         }
-        result.push_back(rec);
+        InventoryRecord rec;
+        rec.product_id = std::string(table.field(r, 0));
+        if (!parse_int(table.field(r, 1), rec.stock_qty)) {
+            diagnostics.skip_row(RowProblem::invalid_stock_qty, line_of);
+            continue;
+        }
+        result.push_back(std::move(rec));
     }
     return result;
 }
 
 std::vector<InventoryRecord> parse_inventory_rows(
-    const std::vector<IndexedRow>& all_rows,
+    const CsvTable& table,
     std::ostream& warnings_out) {
+    Diagnostics diagnostics(warnings_out);
+    return parse_inventory_rows(table, diagnostics);
+}
 
-    std::vector<InventoryRecord> result;
-    bool skip_header = true;
+SalesBatch parse_sales_batch(
+    const CsvTable& table,
+    Diagnostics& diagnostics,
+    std::optional<double> min_amount) {
+
+    SalesBatch batch;
+    batch.amounts.reserve(table.size());
+    batch.product_codes.reserve(table.size());
+    batch.order_id_offsets.reserve(table.size() + 1);
+    batch.order_id_offsets.push_back(0);
+    LineIndex lines(table.content);
 
-    for (const auto& [line_num, row] : all_rows) {
-        if (skip_header) {
-            skip_header = false;
+    // Row 0 is the header
+    for (std::size_t r = 1; r < table.size(); ++r) {
+        auto line_of = [&] { return lines.line_of(table.row_offset(r)); };
+        if (table.field_count(r) < 3) {
+            diagnostics.skip_row(RowProblem::insufficient_columns, line_of);
             continue;
         }
-        if (row.size() < 2) {
-            warnings_out << "[WARN] Skipping malformed row at line "
-                         << line_num
-                         << ": insufficient columns\n";
+        double amount = 0.0;
+        if (!parse_double(table.field(r, 2), amount)) {
+            diagnostics.skip_row(RowProblem::invalid_amount, line_of);
             continue;
         }
-        InventoryRecord rec;
-        rec.product_id = row[0];
-        try {
-            rec.stock_qty = std::stoi(row[1]);
-        } catch (...) {
-            warnings_out << "[WARN] Skipping malformed row at line "
-                         << line_num
-                         << ": invalid stock_qty value\n";
+        if (min_amount && !(amount >= *min_amount)) {
             continue;
         }
-        result.push_back(rec);
+        batch.amounts.push_back(amount);
+        batch.product_codes.push_back(batch.products.intern(table.field(r, 1)));
+        const std::string_view order_id = table.field(r, 0);
+        batch.order_id_bytes.append(order_id.data(), order_id.size());
+        batch.order_id_offsets.push_back(batch.order_id_bytes.size());
     }
-    return result;
+    return batch;
+}
+
+SalesBatch parse_sales_batch(
+    const CsvTable& table,
+    std::ostream& warnings_out,
+    std::optional<double> min_amount) {
+    Diagnostics diagnostics(warnings_out);
+    return parse_sales_batch(table, diagnostics, min_amount);
 }
 
 // ---------------------------------------------------------------------------
@@ -100,15 +336,27 @@ std::vector<SalesRecord> join_with_inventory(
     const std::vector<SalesRecord>& sales,
     const std::vector<InventoryRecord>& inventory) {
 
-    std::unordered_set<std::string> product_set;
-    for (const auto& inv : inventory) {
-        product_set.insert(inv.product_id);
+    const InventoryIndex index(inventory);
+
+    // Hashes of the next kProbeLookahead sales, whose tag groups are already
+    // on their way into the cache.
+    std::uint64_t hashes[kProbeLookahead];
+    const std::size_t n = sales.size();
+    for (std::size_t i = 0; i < n && i < kProbeLookahead; ++i) {
+        hashes[i] = hash_key(sales[i].product_id);
+        index.prefetch(hashes[i]);
     }
 
     std::vector<SalesRecord> result;
-    for (const auto& sale : sales) {
-        if (product_set.count(sale.product_id)) {
-            result.push_back(sale);
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::uint64_t hash = hashes[i % kProbeLookahead];
+        if (i + kProbeLookahead < n) {
+            const std::uint64_t ahead = hash_key(sales[i + kProbeLookahead].product_id);
+            hashes[i % kProbeLookahead] = ahead;
+            index.prefetch(ahead);
+        }
+        if (index.contains_prefetched(sales[i].product_id, hash)) {
+            result.push_back(sales[i]);
         }
     }
     return result;
@@ -134,13 +382,905 @@ std::vector<SalesRecord> filter_by_amount(
 Summary compute_summary(const std::vector<SalesRecord>& rows) {
     Summary s;
     s.count = static_cast<int>(rows.size());
+    StableSum total;
     for (const auto& row : rows) {
-        s.total += row.amount;
+        total.add(row.amount);
     }
+    s.total = total.value();
     s.average = (s.count > 0) ? (s.total / s.count) : 0.0;
     return s;
 }
 
+// ---------------------------------------------------------------------------
+// Columnar join, filter & aggregation
+// ---------------------------------------------------------------------------
+
+namespace {
+
+// Selects the rows whose product code has its bit set in in_inventory.
+Selection select_codes(const SalesBatch& sales,
+                       const std::vector<std::uint64_t>& in_inventory) {
+    Selection selection((sales.size() + 63) / 64, 0);
+    const std::uint32_t* codes = sales.product_codes.data();
+    for (std::size_t w = 0; w < selection.size(); ++w) {
+        const std::size_t begin = w * 64;
+        const std::size_t n = std::min<std::size_t>(64, sales.size() - begin);
+        std::uint64_t bits = 0;
+        for (std::size_t j = 0; j < n; ++j) {
+            const std::uint32_t code = codes[begin + j];
+            bits |= ((in_inventory[code / 64] >> (code % 64)) & 1) << j;
+        }
+        selection[w] = bits;
+    }
+    return selection;
+}
+
+}  // namespace
+
+Selection join_with_inventory(
+    const SalesBatch& sales,
+    const std::vector<InventoryRecord>& inventory) {
+
+    // Bit c is set when product code c is in the inventory.
+    std::vector<std::uint64_t> in_inventory((sales.products.size() + 63) / 64, 0);
+    for (const auto& inv : inventory) {
+        const std::uint32_t code = sales.products.find(inv.product_id);
+        if (code != ProductDictionary::kNotFound) {
+            in_inventory[code / 64] |= std::uint64_t{1} << (code % 64);
+        }
+    }
+    return select_codes(sales, in_inventory);
+}
+
+Selection join_with_inventory(
+    const SalesBatch& sales,
+    const InventoryIndex& inventory) {
+
+    // Each distinct sales product is probed once, kProbeLookahead ahead.
+    const std::size_t n = sales.products.size();
+    std::uint64_t hashes[kProbeLookahead];
+    for (std::size_t c = 0; c < n && c < kProbeLookahead; ++c) {
+        hashes[c] = hash_key(sales.products.name(static_cast<std::uint32_t>(c)));
+        inventory.prefetch(hashes[c]);
+    }
+
+    std::vector<std::uint64_t> in_inventory((n + 63) / 64, 0);
+    for (std::size_t c = 0; c < n; ++c) {
+        const std::uint64_t hash = hashes[c % kProbeLookahead];
+        if (c + kProbeLookahead < n) {
+            const std::uint64_t ahead = hash_key(
+                sales.products.name(static_cast<std::uint32_t>(c + kProbeLookahead)));
+            hashes[c % kProbeLookahead] = ahead;
+            inventory.prefetch(ahead);
+        }
+        if (inventory.contains_prefetched(
+                sales.products.name(static_cast<std::uint32_t>(c)), hash)) {
+            in_inventory[c / 64] |= std::uint64_t{1} << (c % 64);
+        }
+    }
+    return select_codes(sales, in_inventory);
+}
+
+void filter_by_amount(
+    const SalesBatch& sales,
+    double min_amount,
+    Selection& selection) {
+
+    const double* amounts = sales.amounts.data();
+    for (std::size_t w = 0; w < selection.size(); ++w) {
+        if (selection[w] == 0) {
+            continue;
+        }
+        const std::size_t begin = w * 64;
+        const std::size_t n = std::min<std::size_t>(64, sales.size() - begin);
+        selection[w] &= amount_mask(amounts + begin, n, min_amount);
+    }
+}
+
+Summary compute_summary(
+    const SalesBatch& sales,
+    const Selection& selection,
+    unsigned threads) {
+
+    std::vector<std::size_t> first_selected(selection.size() + 1, 0);
+    for (std::size_t w = 0; w < selection.size(); ++w) {
+        first_selected[w + 1] = first_selected[w] + popcount(selection[w]);
+    }
+    const std::size_t count = first_selected.back();
+    const std::size_t block_count =
+        (count + StableSum::kBlockSize - 1) / StableSum::kBlockSize;
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (count < kMinParallelRows) {
+        threads = 1;
+    }
+
+    // Each thread fills a contiguous range of blocks; the blocks are then
+    // combined in order, so the result does not depend on the split.
+    std::vector<StableSum::Block> blocks(block_count);
+    const std::size_t per_thread = (block_count + threads - 1) / threads;
+    if (threads == 1) {
+        sum_blocks(sales, selection, first_selected, 0, block_count, blocks);
+    } else {
+        std::vector<std::thread> workers;
+        for (std::size_t b = 0; b < block_count; b += per_thread) {
+            workers.emplace_back([&, b] {
+                sum_blocks(sales, selection, first_selected, b,
+                           std::min(block_count, b + per_thread), blocks);
+            });
+        }
+        for (auto& w : workers) {
+            w.join();
+        }
+    }
+
+    StableSum total;
+    for (const auto& block : blocks) {
+        total.append(block);
+    }
+
+    Summary s;
+    s.count = static_cast<int>(count);
+    s.total = total.value();
+    s.average = (s.count > 0) ? (s.total / s.count) : 0.0;
+    return s;
+}
+
+std::vector<ProductSummary> compute_product_summaries(
+    const SalesBatch& sales,
+    const Selection& selection,
+    unsigned threads) {
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    // Row offsets and chunk numbers below are 32 bits wide
+    if (sales.size() < kMinParallelRows || sales.size() > UINT32_MAX) {
+        threads = 1;
+    }
+    const std::size_t group_count = sales.products.size();
+    const std::uint32_t* codes = sales.product_codes.data();
+    const double* amounts = sales.amounts.data();
+    std::vector<GroupPartial> groups(group_count);
+
+    if (threads == 1) {
+        for (std::size_t w = 0; w < selection.size(); ++w) {
+            for (std::uint64_t bits = selection[w]; bits != 0; bits &= bits - 1) {
+                const std::size_t row = w * 64 + lowest_bit(bits);
+                groups[codes[row]].add(amounts[row]);
+            }
+        }
+        return to_product_summaries(sales.products, groups);
+    }
+
+    // Every product's rows are cut into chunks of kGroupChunkRows, in row
+    // order, and chunk c of product code k is summed by thread
+    // (k / codes_per_thread + c) % threads: a product with few rows stays
+    // with one thread, while the chunks of a hot one go round all of them.
+    //   1. Each thread counts the rows of every product in its blocks.
+    //   2. With the rows of each product before its blocks known, each thread
+    //      lists its rows by the thread summing their chunk, block by block.
+    //   3. Each thread sums the rows of its chunks, block after block, so
+    //      every chunk in row order, as GroupPartial::add would.
+    //   4. Each product's chunks are merged in order by the thread that owns
+    //      its code, giving the GroupPartial of one thread, to the bit.
+    const std::size_t codes_per_thread = (group_count + threads - 1) / threads;
+    const std::size_t block_count = (selection.size() + kGroupBlockWords - 1) / kGroupBlockWords;
+    const std::size_t blocks_per_thread = (block_count + threads - 1) / threads;
+
+    auto for_each_row = [&](unsigned t, auto visit) {
+        const std::size_t last = std::min(block_count, (t + 1) * blocks_per_thread);
+        for (std::size_t b = t * blocks_per_thread; b < last; ++b) {
+            const std::size_t end = std::min(selection.size(), (b + 1) * kGroupBlockWords);
+            for (std::size_t w = b * kGroupBlockWords; w < end; ++w) {
+                for (std::uint64_t bits = selection[w]; bits != 0; bits &= bits - 1) {
+                    visit(b, w * 64 + lowest_bit(bits));
+                }
+            }
+        }
+    };
+
+    // seen[t * group_count + k]: rows of product k in the blocks of thread
+    // t, then the rows of k before them.
+    std::vector<std::uint32_t> seen(threads * group_count, 0);
+    auto count_rows = [&](unsigned t) {
+        std::uint32_t* counts = seen.data() + t * group_count;
+        for_each_row(t, [&](std::size_t, std::size_t row) { ++counts[codes[row]]; });
+    };
+    run_on_threads(threads, count_rows);
+
+    // first_chunk[k]: index in chunks of the first chunk of product k.
+    std::vector<std::uint32_t> first_chunk(group_count + 1, 0);
+    auto count_chunks = [&](unsigned t) {
+        const std::size_t last = std::min(group_count, (t + 1) * codes_per_thread);
+        for (std::size_t k = t * codes_per_thread; k < last; ++k) {
+            std::uint32_t rows = 0;
+            for (unsigned u = 0; u < threads; ++u) {
+                const std::uint32_t n = seen[u * group_count + k];
+                seen[u * group_count + k] = rows;
+                rows += n;
+            }
+            groups[k].count = rows;
+            first_chunk[k + 1] =
+                static_cast<std::uint32_t>((rows + kGroupChunkRows - 1) / kGroupChunkRows);
+        }
+    };
+    run_on_threads(threads, count_chunks);
+    for (std::size_t k = 0; k < group_count; ++k) {
+        first_chunk[k + 1] += first_chunk[k];
+    }
+
+    // owned[b * threads + t]: rows of block b that thread t sums, relative to
+    // the first row of the block, with the index of their chunk.
+    struct ChunkRow {
+        std::uint32_t offset;
+        std::uint32_t chunk;
+    };
+    std::vector<std::vector<ChunkRow>> owned(block_count * threads);
+    auto list_rows = [&](unsigned t) {
+        std::uint32_t* before = seen.data() + t * group_count;
+        for_each_row(t, [&](std::size_t b, std::size_t row) {
+            const std::uint32_t code = codes[row];
+            const auto chunk = static_cast<std::uint32_t>(before[code]++ / kGroupChunkRows);
+            const std::size_t summer = (code / codes_per_thread + chunk) % threads;
+            owned[b * threads + summer].push_back(
+                {static_cast<std::uint32_t>(row - b * kGroupBlockWords * 64),
+                 first_chunk[code] + chunk});
+        });
+    };
+    run_on_threads(threads, list_rows);
+
+    std::vector<StableSum::Partial> chunks(first_chunk.back());
+    auto add_rows = [&](unsigned t) {
+        for (std::size_t b = 0; b < block_count; ++b) {
+            const double* block_amounts = amounts + b * kGroupBlockWords * 64;
+            for (const ChunkRow& r : owned[b * threads + t]) {
+                chunks[r.chunk] = StableSum::accumulate(chunks[r.chunk], block_amounts[r.offset]);
+            }
+        }
+    };
+    run_on_threads(threads, add_rows);
+
+    auto merge_chunks = [&](unsigned t) {
+        const std::size_t last = std::min(group_count, (t + 1) * codes_per_thread);
+        for (std::size_t k = t * codes_per_thread; k < last; ++k) {
+            GroupPartial& g = groups[k];
+            const std::uint32_t complete =
+                first_chunk[k] + static_cast<std::uint32_t>(g.count / kGroupChunkRows);
+            for (std::uint32_t c = first_chunk[k]; c < complete; ++c) {
+                g.total = StableSum::merge(g.total, chunks[c]);
+            }
+            if (complete < first_chunk[k + 1]) {
+                g.chunk = chunks[complete];
+            }
+        }
+    };
+    run_on_threads(threads, merge_chunks);
+    return to_product_summaries(sales.products, groups);
+}
+
+// ---------------------------------------------------------------------------
+// Streaming pipeline
+// ---------------------------------------------------------------------------
+
+namespace {
+
+// Reads sales rows from reader one at a time and calls
+// visit(product_id, amount) for each well-formed row that passes the join
+// and the MIN_AMOUNT filter.
+template <class Visit>
+void stream_sales(CsvRowReader& reader, const InventoryIndex& index,
+                  double min_amount, Diagnostics& diagnostics, Visit visit) {
+    auto line_of = [&] { return reader.line_number(); };
+    while (reader.next()) {
+        if (reader.field_count() < 3) {
+            diagnostics.skip_row(RowProblem::insufficient_columns, line_of);
+            continue;
+        }
+        double amount = 0.0;
+        if (!parse_double(reader.field(2), amount)) {
+            diagnostics.skip_row(RowProblem::invalid_amount, line_of);
+            continue;
+        }
+        if (amount >= min_amount && index.contains(reader.field(1))) {
+            visit(reader.field(1), amount);
+        }
+    }
+}
+
+// Running aggregate of one query of run_queries_stream.
+struct StreamAggregate {
+    double min_amount = 0.0;
+    bool by_product = false;
+    std::uint64_t count = 0;
+    StableSum total;
+    std::vector<GroupPartial> groups;   // indexed by code in StreamState::products
+};
+
+// Everything run_queries_stream accumulates, one aggregate per query.
+struct StreamState {
+    ProductDictionary products;
+    std::vector<StreamAggregate> aggregates;
+
+    explicit StreamState(const std::vector<Query>& queries) : aggregates(queries.size()) {
+        for (std::size_t q = 0; q < queries.size(); ++q) {
+            aggregates[q].min_amount = queries[q].min_amount;
+            aggregates[q].by_product = queries[q].group_by == "product_id";
+        }
+    }
+
+    // Adds the rows of reader to every aggregate they pass.
+    void add(CsvRowReader& reader, const InventoryIndex& inventory,
+             Diagnostics& diagnostics) {
+        double lowest = std::numeric_limits<double>::infinity();
+        for (const auto& a : aggregates) {
+            if (a.min_amount < lowest) {
+                lowest = a.min_amount;
+            }
+        }
+        stream_sales(reader, inventory, lowest, diagnostics,
+                     [&](std::string_view product_id, double amount) {
+                         std::uint32_t code = ProductDictionary::kNotFound;
+                         for (auto& a : aggregates) {
+                             if (!(amount >= a.min_amount)) {
+                                 continue;
+                             }
+                             if (!a.by_product) {
+                                 ++a.count;
+                                 a.total.add(amount);
+                                 continue;
+                             }
+                             if (code == ProductDictionary::kNotFound) {
+                                 code = products.intern(product_id);
+                             }
+                             if (a.groups.size() <= code) {
+                                 a.groups.resize(code + 1);
+                             }
+                             a.groups[code].add(amount);
+                         }
+                     });
+    }
+
+    std::vector<QueryResult> results() const {
+        std::vector<QueryResult> results(aggregates.size());
+        for (std::size_t q = 0; q < aggregates.size(); ++q) {
+            const StreamAggregate& a = aggregates[q];
+            if (a.by_product) {
+                results[q].groups = to_product_summaries(products, a.groups);
+            } else {
+                Summary& s = results[q].summary;
+                s.count = static_cast<int>(a.count);
+                s.total = a.total.value();
+                s.average = (s.count > 0) ? (s.total / s.count) : 0.0;
+            }
+        }
+        return results;
+    }
+};
+
+}  // namespace
+
+Summary summarize_sales_stream(
+    std::string_view sales_content,
+    char delimiter,
+    const std::vector<InventoryRecord>& inventory,
+    double min_amount,
+    std::ostream& warnings_out) {
+
+    Summary s;
+    StableSum total;
+    const InventoryIndex index(inventory);
+    CsvRowReader reader(sales_content, delimiter);
+    reader.next();  // header
+    Diagnostics diagnostics(warnings_out);
+    stream_sales(reader, index, min_amount, diagnostics,
+                 [&](std::string_view, double amount) {
+                     ++s.count;
+                     total.add(amount);
+                 });
+    s.total = total.value();
+    s.average = (s.count > 0) ? (s.total / s.count) : 0.0;
+    return s;
+}
+
+std::vector<ProductSummary> summarize_sales_stream_by_product(
+    std::string_view sales_content,
+    char delimiter,
+    const std::vector<InventoryRecord>& inventory,
+    double min_amount,
+    std::ostream& warnings_out) {
+
+    ProductDictionary products;
+    std::vector<GroupPartial> groups;
+    const InventoryIndex index(inventory);
+    CsvRowReader reader(sales_content, delimiter);
+    reader.next();  // header
+    Diagnostics diagnostics(warnings_out);
+    stream_sales(reader, index, min_amount, diagnostics,
+                 [&](std::string_view product_id, double amount) {
+                     const std::uint32_t code = products.intern(product_id);
+                     if (code == groups.size()) {
+                         groups.emplace_back();
+                     }
+                     groups[code].add(amount);
+                 });
+    return to_product_summaries(products, groups);
+}
+
+// ---------------------------------------------------------------------------
+// Query files
+// ---------------------------------------------------------------------------
+
+std::vector<QueryResult> run_queries(
+    const SalesBatch& sales,
+    const Selection& joined,
+    const std::vector<Query>& queries) {
+
+    std::vector<QueryResult> results(queries.size());
+    Selection selection;
+    for (std::size_t q = 0; q < queries.size(); ++q) {
+        selection = joined;
+        filter_by_amount(sales, queries[q].min_amount, selection);
+        if (queries[q].group_by == "product_id") {
+            results[q].groups = compute_product_summaries(sales, selection);
+        } else {
+            results[q].summary = compute_summary(sales, selection);
+        }
+    }
+    return results;
+}
+
+std::vector<QueryResult> run_queries_stream(
+    std::string_view sales_content,
+    char delimiter,
+    const InventoryIndex& inventory,
+    const std::vector<Query>& queries,
+    Diagnostics& diagnostics) {
+
+    StreamState state(queries);
+    CsvRowReader reader(sales_content, delimiter);
+    reader.next();  // header
+    state.add(reader, inventory, diagnostics);
+    return state.results();
+}
+
+std::vector<QueryResult> run_queries_stream(
+    std::string_view sales_content,
+    char delimiter,
+    const InventoryIndex& inventory,
+    const std::vector<Query>& queries,
+    std::ostream& warnings_out) {
+    Diagnostics diagnostics(warnings_out);
+    return run_queries_stream(sales_content, delimiter, inventory, queries, diagnostics);
+}
+
+std::vector<QueryResult> run_queries_stream(
+    DecompressPipe& sales_blocks,
+    char delimiter,
+    const InventoryIndex& inventory,
+    const std::vector<Query>& queries,
+    Diagnostics& diagnostics) {
+
+    StreamState state(queries);
+    int lines = 0;
+    bool header = true;   // the header line is still to come
+    auto add_lines = [&](std::string_view text) {
+        CsvRowReader reader(text, delimiter, lines);
+        if (header) {
+            header = !reader.next();
+        }
+        state.add(reader, inventory, diagnostics);
+        lines = reader.line_number();
+    };
+
+    // Complete lines are read straight from the block; only a line split
+    // between blocks is copied.
+    std::string pending;
+    std::string_view block;
+    while (sales_blocks.next(block)) {
+        const std::size_t last = block.rfind('\n');
+        if (last == std::string_view::npos) {
+            pending.append(block);
+            continue;
+        }
+        std::size_t start = 0;
+        if (!pending.empty()) {
+            start = block.find('\n') + 1;
+            pending.append(block.substr(0, start));
+            add_lines(pending);
+            pending.clear();
+        }
+        add_lines(block.substr(start, last + 1 - start));
+        pending.assign(block.substr(last + 1));
+    }
+    if (!pending.empty()) {
+        add_lines(pending);
+    }
+    return state.results();
+}
+
+std::vector<QueryResult> run_queries_stream(
+    DecompressPipe& sales_blocks,
+    char delimiter,
+    const InventoryIndex& inventory,
+    const std::vector<Query>& queries,
+    std::ostream& warnings_out) {
+    Diagnostics diagnostics(warnings_out);
+    return run_queries_stream(sales_blocks, delimiter, inventory, queries, diagnostics);
+}
+
+// ---------------------------------------------------------------------------
+// Incremental runs
+// ---------------------------------------------------------------------------
+
+namespace {
+
+constexpr std::uint64_t kCheckpointMagic = 0x3350434553454c41ULL;  // "ALESECP3"
+
+// The prefix hash is chained over blocks of this size at fixed offsets, so
+// that an update rehashes only the new bytes and the start of the last
+// block, and a full rehash gives the same value.
+constexpr std::size_t kHashBlockBytes = std::size_t{1} << 16;
+
+// Bytes before the offset that are hashed first, to turn a changed sales
+// file away without rehashing all of it.
+constexpr std::size_t kCheckWindowBytes = 4096;
+
+// Where a checkpoint stops and what it was computed against.
+struct CheckpointHeader {
+    std::uint64_t magic = kCheckpointMagic;
+    std::uint64_t delimiter = 0;
+    std::uint64_t inventory_hash = 0;
+    std::uint64_t offset = 0;        // bytes of sales content consumed
+    std::uint64_t lines = 0;         // lines in those bytes
+    std::uint64_t prefix_hash = 0;   // hash_prefix of those bytes
+    std::uint64_t block_hash = 0;    // chain over their whole kHashBlockBytes blocks
+    std::uint64_t window_hash = 0;   // hash_key of up to kCheckWindowBytes before offset
+    FileIdentity file;               // the append-only sales file, if trusted
+};
+
+std::uint64_t chain_hash(std::uint64_t chain, std::string_view block) {
+    const std::uint64_t words[2] = {chain, hash_key(block)};
+    return hash_key(std::string_view(reinterpret_cast<const char*>(words), sizeof(words)));
+}
+
+// Hash of content[0, end), continuing from from, a multiple of
+// kHashBlockBytes, with chain the hash of the blocks before it.  Leaves
+// in chain the hash of the whole blocks before end.
+std::uint64_t hash_prefix(std::string_view content, std::size_t from, std::size_t end,
+                          std::uint64_t& chain) {
+    for (; end - from >= kHashBlockBytes; from += kHashBlockBytes) {
+        chain = chain_hash(chain, content.substr(from, kHashBlockBytes));
+    }
+    return chain_hash(chain, content.substr(from, end - from));
+}
+
+std::uint64_t window_hash(std::string_view content, std::size_t end) {
+    const std::size_t size = std::min(end, kCheckWindowBytes);
+    return hash_key(content.substr(end - size, size));
+}
+
+template <class T>
+void put(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Reads back what put() wrote; every get fails once the bytes run out.
+class ByteReader {
+public:
+    explicit ByteReader(std::string_view bytes) : bytes_(bytes) {}
+
+    template <class T>
+    bool get(T& value) {
+        if (bytes_.size() < sizeof(value)) {
+            return false;
+        }
+        std::memcpy(&value, bytes_.data(), sizeof(value));
+        bytes_.remove_prefix(sizeof(value));
+        return true;
+    }
+
+    bool get_bytes(std::size_t n, std::string_view& value) {
+        if (bytes_.size() < n) {
+            return false;
+        }
+        value = bytes_.substr(0, n);
+        bytes_.remove_prefix(n);
+        return true;
+    }
+
+    bool at_end() const { return bytes_.empty(); }
+
+private:
+    std::string_view bytes_;
+};
+
+void put_sum(std::string& out, const StableSum& sum) {
+    const StableSum::State s = sum.state();
+    for (const auto& lane : s.lanes) {
+        put(out, lane);
+    }
+    put(out, s.block_count);
+    put(out, s.blocks);
+    put(out, static_cast<std::uint64_t>(s.levels.size()));
+    for (const auto& level : s.levels) {
+        put(out, level);
+    }
+}
+
+bool get_sum(ByteReader& in, StableSum& sum) {
+    StableSum::State s;
+    std::uint64_t levels = 0;
+    for (auto& lane : s.lanes) {
+        if (!in.get(lane)) {
+            return false;
+        }
+    }
+    if (!in.get(s.block_count) || !in.get(s.blocks) || !in.get(levels) || levels > 64) {
+        return false;
+    }
+    s.levels.resize(levels);
+    for (auto& level : s.levels) {
+        if (!in.get(level)) {
+            return false;
+        }
+    }
+    return sum.restore(s);
+}
+
+// Layout: CheckpointHeader, the product dictionary (count, then a length
+// and the bytes of each ID in code order), then the aggregates (count,
+// then for each its MIN_AMOUNT, grouping, row count, total and groups).
+std::string save_checkpoint(const CheckpointHeader& header, const StreamState& state) {
+    std::string out;
+    put(out, header);
+    put(out, static_cast<std::uint64_t>(state.products.size()));
+    for (std::uint32_t code = 0; code < state.products.size(); ++code) {
+        const std::string_view name = state.products.name(code);
+        put(out, static_cast<std::uint64_t>(name.size()));
+        out.append(name.data(), name.size());
+    }
+    put(out, static_cast<std::uint64_t>(state.aggregates.size()));
+    for (const auto& a : state.aggregates) {
+        put(out, a.min_amount);
+        put(out, static_cast<std::uint8_t>(a.by_product));
+        put(out, a.count);
+        put_sum(out, a.total);
+        put(out, static_cast<std::uint64_t>(a.groups.size()));
+        for (const auto& g : a.groups) {
+            put(out, g.count);
+            put(out, g.total);
+            put(out, g.chunk);
+        }
+    }
+    return out;
+}
+
+bool same_bits(double a, double b) {
+    return std::memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+// Restores state from a checkpoint written by save_checkpoint.  Every query
+// of state needs a saved aggregate with the same MIN_AMOUNT and grouping;
+// saved aggregates no query asks for are dropped.  Returns false if the
+// bytes are malformed or an aggregate is missing.
+bool load_checkpoint(std::string_view bytes, CheckpointHeader& header, StreamState& state) {
+    ByteReader in(bytes);
+    std::uint64_t products = 0;
+    if (!in.get(header) || header.magic != kCheckpointMagic || !in.get(products)) {
+        return false;
+    }
+    ProductDictionary dictionary;
+    for (std::uint64_t code = 0; code < products; ++code) {
+        std::uint64_t size = 0;
+        std::string_view name;
+        if (!in.get(size) || !in.get_bytes(size, name) || dictionary.intern(name) != code) {
+            return false;
+        }
+    }
+
+    std::uint64_t saved = 0;
+    if (!in.get(saved)) {
+        return false;
+    }
+    std::vector<StreamAggregate> aggregates;
+    for (std::uint64_t i = 0; i < saved; ++i) {
+        StreamAggregate a;
+        std::uint8_t by_product = 0;
+        std::uint64_t groups = 0;
+        if (!in.get(a.min_amount) || !in.get(by_product) || !in.get(a.count) ||
+            !get_sum(in, a.total) || !in.get(groups) || groups > products) {
+            return false;
+        }
+        a.by_product = by_product != 0;
+        a.groups.resize(groups);
+        for (auto& g : a.groups) {
+            if (!in.get(g.count) || !in.get(g.total) || !in.get(g.chunk)) {
+                return false;
+            }
+        }
+        aggregates.push_back(std::move(a));
+    }
+    if (!in.at_end()) {
+        return false;
+    }
+
+    for (auto& wanted : state.aggregates) {
+        const auto found = std::find_if(
+            aggregates.begin(), aggregates.end(), [&](const StreamAggregate& a) {
+                return same_bits(a.min_amount, wanted.min_amount) &&
+                       a.by_product == wanted.by_product;
+            });
+        if (found == aggregates.end()) {
+            return false;
+        }
+        wanted = *found;
+    }
+    state.products = std::move(dictionary);
+    return true;
+}
+
+}  // namespace
+
+struct IncrementalQueries::State {
+    std::vector<Query> queries;
+    CheckpointHeader header;
+    StreamState stream;
+
+    explicit State(const std::vector<Query>& q) : queries(q), stream(q) {}
+};
+
+IncrementalQueries::IncrementalQueries(const std::vector<Query>& queries,
+                                       char delimiter,
+                                       std::uint64_t inventory_hash)
+    : state_(std::make_unique<State>(queries)) {
+    state_->header.delimiter = static_cast<unsigned char>(delimiter);
+    state_->header.inventory_hash = inventory_hash;
+}
+
+IncrementalQueries::~IncrementalQueries() = default;
+IncrementalQueries::IncrementalQueries(IncrementalQueries&&) noexcept = default;
+IncrementalQueries& IncrementalQueries::operator=(IncrementalQueries&&) noexcept = default;
+
+bool IncrementalQueries::load(std::string_view checkpoint) {
+    StreamState stream(state_->queries);
+    CheckpointHeader header;
+    if (!load_checkpoint(checkpoint, header, stream) ||
+        header.delimiter != state_->header.delimiter ||
+        header.inventory_hash != state_->header.inventory_hash ||
+        header.lines > static_cast<std::uint64_t>(std::numeric_limits<int>::max())) {
+        return false;
+    }
+    state_->header = header;
+    state_->stream = std::move(stream);
+    return true;
+}
+
+std::string IncrementalQueries::save() const {
+    return save_checkpoint(state_->header, state_->stream);
+}
+
+bool IncrementalQueries::update(std::string_view sales_content,
+                                const InventoryIndex& inventory,
+                                Diagnostics& diagnostics,
+                                const FileIdentity& append_only_file) {
+    CheckpointHeader& header = state_->header;
+    bool resumed = header.offset <= sales_content.size();
+    if (resumed) {
+        // The bytes just before the offset rule most changes out cheaply.
+        // Past that, only a file trusted to be append-only that is still the
+        // same one, grown or unchanged, skips rehashing the whole prefix.
+        const auto offset = static_cast<std::size_t>(header.offset);
+        resumed = window_hash(sales_content, offset) == header.window_hash;
+        const FileIdentity& file = append_only_file;
+        const bool same_file = file.inode != 0 && file.inode == header.file.inode &&
+                               file.device == header.file.device &&
+                               file.mtime >= header.file.mtime;
+        if (resumed && !same_file) {
+            std::uint64_t chain = 0;
+            resumed = hash_prefix(sales_content, 0, offset, chain) == header.prefix_hash;
+        }
+    }
+    if (!resumed) {
+        state_->stream = StreamState(state_->queries);
+        header.offset = 0;
+        header.lines = 0;
+        header.block_hash = 0;
+        header.prefix_hash = hash_prefix({}, 0, 0, header.block_hash);
+        header.window_hash = window_hash({}, 0);
+    }
+    header.file = append_only_file;
+
+    const std::size_t complete = sales_content.rfind('\n') + 1;
+    const auto offset = static_cast<std::size_t>(header.offset);
+    if (complete > offset) {
+        CsvRowReader reader(sales_content.substr(offset, complete - offset),
+                            static_cast<char>(header.delimiter),
+                            static_cast<int>(header.lines));
+        // Nothing is read before the header line is complete.
+        if (offset > 0 || reader.next()) {
+            state_->stream.add(reader, inventory, diagnostics);
+            header.offset = complete;
+            header.lines = static_cast<std::uint64_t>(reader.line_number());
+            header.prefix_hash = hash_prefix(sales_content,
+                                             offset - offset % kHashBlockBytes, complete,
+                                             header.block_hash);
+            header.window_hash = window_hash(sales_content, complete);
+        }
+    }
+    return resumed;
+}
+
+void IncrementalQueries::add_unfinished_line(std::string_view sales_content,
+                                             const InventoryIndex& inventory,
+                                             Diagnostics& diagnostics) {
+    const CheckpointHeader& header = state_->header;
+    if (sales_content.size() <= header.offset) {
+        return;
+    }
+    CsvRowReader reader(sales_content.substr(static_cast<std::size_t>(header.offset)),
+                        static_cast<char>(header.delimiter),
+                        static_cast<int>(header.lines));
+    if (header.offset == 0) {
+        reader.next();  // header
+    }
+    state_->stream.add(reader, inventory, diagnostics);
+}
+
+std::uint64_t IncrementalQueries::offset() const {
+    return state_->header.offset;
+}
+
+std::vector<QueryResult> IncrementalQueries::results() const {
+    return state_->stream.results();
+}
+
+std::vector<QueryResult> run_queries_incremental(
+    std::string_view sales_content,
+    char delimiter,
+    const InventoryIndex& inventory,
+    std::uint64_t inventory_hash,
+    const std::vector<Query>& queries,
+    const std::string& checkpoint_path,
+    Diagnostics& diagnostics,
+    const FileIdentity& append_only_file) {
+
+    IncrementalQueries incremental(queries, delimiter, inventory_hash);
+    {
+        MappedFile file;
+        if (file.open(checkpoint_path)) {
+            incremental.load(file.view());
+        }
+    }
+    incremental.update(sales_content, inventory, diagnostics, append_only_file);
+    const std::string checkpoint = incremental.save();
+
+    // A last line without its newline may still be being written, so it
+    // counts in this run's results only and is read again next time.
+    incremental.add_unfinished_line(sales_content, inventory, diagnostics);
+
+    if (!replace_file(checkpoint_path, checkpoint)) {
+        diagnostics.out() << "[WARN] Could not write checkpoint " << checkpoint_path << "\n";
+    }
+    return incremental.results();
+}
+
+std::vector<QueryResult> run_queries_incremental(
+    std::string_view sales_content,
+    char delimiter,
+    const InventoryIndex& inventory,
+    std::uint64_t inventory_hash,
+    const std::vector<Query>& queries,
+    const std::string& checkpoint_path,
+    std::ostream& warnings_out,
+    const FileIdentity& append_only_file) {
+    Diagnostics diagnostics(warnings_out);
+    return run_queries_incremental(sales_content, delimiter, inventory, inventory_hash,
+                                   queries, checkpoint_path, diagnostics, append_only_file);
+}
+
 // ---------------------------------------------------------------------------
 // Formatting
 // ---------------------------------------------------------------------------
@@ -163,3 +1303,84 @@ std::string format_csv_output(const Summary& summary) {
        << summary.average << "\n";
     return ss.str();
 }
+
+namespace {
+
+// Escapes a product ID for use inside a JSON string.
+std::string json_escape(std::string_view text) {
+    std::string out;
+    for (char c : text) {
+        switch (c) {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(c));
+                out += buf;
+            } else {
+                out += c;
+            }
+        }
+    }
+    return out;
+}
+
+// Quotes a product ID for a CSV field if it contains a comma, quote or
+// line break.
+std::string csv_escape(std::string_view text) {
+    if (text.find_first_of(",\"\r\n") == std::string_view::npos) {
+        return std::string(text);
+    }
+    std::string out = "\"";
+    for (char c : text) {
+        out += c;
+        if (c == '"') {
+            out += '"';
+        }
+    }
+    out += '"';
+    return out;
+}
+
+}  // namespace
+
+std::string format_json(const std::vector<ProductSummary>& groups) {
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    ss << "[";
+    for (std::size_t i = 0; i < groups.size(); ++i) {
+        const Summary& s = groups[i].summary;
+        ss << (i > 0 ? ", " : "")
+           << "{\"product_id\": \"" << json_escape(groups[i].product_id) << "\""
+           << ", \"count\": " << s.count
+           << ", \"total\": " << s.total
+           << ", \"average\": " << s.average << "}";
+    }
+    ss << "]";
+    return ss.str();
+}
+
+std::string format_csv_output(const std::vector<ProductSummary>& groups) {
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    ss << "product_id,count,total,average\n";
+    for (const auto& g : groups) {
+        ss << csv_escape(g.product_id) << ","
+           << g.summary.count << ","
+           << g.summary.total << ","
+           << g.summary.average << "\n";
+    }
+    return ss.str();
+}
+
+std::string format_result(const Query& query, const QueryResult& result) {
+    const bool by_product = query.group_by == "product_id";
+    if (query.output_format == "json") {
+        return (by_product ? format_json(result.groups) : format_json(result.summary)) + "\n";
+    }
+    return by_product ? format_csv_output(result.groups) : format_csv_output(result.summary);
+}
@@ -1,11 +1,24 @@
 #pragma once
 
 #include "csv_parser.h"
+#include "decompress.h"
+#include "diagnostics.h"
+#include "mapped_file.h"
+#include "product_dictionary.h"
+#include "query.h"
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
 #include <ostream>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+class InventoryIndex;   // inventory_index.h
+
 struct SalesRecord {
     std::string order_id;
     std::string product_id;
@@ -17,37 +30,154 @@ struct InventoryRecord {
     int stock_qty = 0;
 };
 
+// One column of a SalesBatch: values owned in a vector while the batch is
+// parsed, or a read-only array inside a mapped sales cache (sales_cache.h).
+template <typename T>
+class Column {
+public:
+    Column() = default;
+    Column(std::vector<T> values)
+        : values_(std::move(values)), data_(values_.data()), size_(values_.size()) {}
+
+    Column(Column&& other) noexcept { *this = std::move(other); }
+    Column& operator=(Column&& other) noexcept {
+        values_ = std::move(other.values_);
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        return *this;
+    }
+
+    Column(const Column&) = delete;
+    Column& operator=(const Column&) = delete;
+
+    void reserve(std::size_t n) { values_.reserve(n); }
+    void push_back(const T& value) {
+        values_.push_back(value);
+        data_ = values_.data();
+        size_ = values_.size();
+    }
+    void append(const T* values, std::size_t n) {
+        values_.insert(values_.end(), values, values + n);
+        data_ = values_.data();
+        size_ = values_.size();
+    }
+
+    // Makes the column a view of the n values at data, which must outlive
+    // it.  Nothing may be added afterwards.
+    void attach(const T* data, std::size_t n) {
+        values_ = std::vector<T>();
+        data_ = data;
+        size_ = n;
+    }
+
+    const T* data() const { return data_; }
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const T& operator[](std::size_t i) const { return data_[i]; }
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + size_; }
+
+private:
+    std::vector<T> values_;
+    const T* data_ = nullptr;   // values_.data(), or the attached array
+    std::size_t size_ = 0;
+};
+
+// Column-oriented sales records: row i is (order_id(i), product_id(i),
+// amounts[i]).  Product IDs are interned into the batch's dictionary and
+// referenced by a dense code, so the filter and summary kernels only stream
+// the 8-byte amount column and the join only tests a bit per row.  A batch
+// loaded from a sales cache views the columns in the mapped file.
+// Move-only.
+struct SalesBatch {
+    Column<double> amounts;
+    Column<std::uint32_t> product_codes;    // codes in products
+    ProductDictionary products;
+    Column<std::uint64_t> order_id_offsets;  // size()+1 offsets into order_id_bytes
+    Column<char> order_id_bytes;
+    MappedFile cache;                        // backs the columns after load_sales_cache()
+
+    std::size_t size() const { return amounts.size(); }
+    std::string_view order_id(std::size_t row) const {
+        return std::string_view(order_id_bytes.data() + order_id_offsets[row],
+                                order_id_offsets[row + 1] - order_id_offsets[row]);
+    }
+    std::string_view product_id(std::size_t row) const {
+        return products.name(product_codes[row]);
+    }
+};
+
+// Row selection over a SalesBatch: bit (i % 64) of word (i / 64) is set when
+// row i is selected.  Bits past the last row are always clear.
+using Selection = std::vector<std::uint64_t>;
+
 struct Summary {
     int count = 0;
     double total = 0.0;
     double average = 0.0;
 };
 
+// Summary of the sales of one product (OUTPUT_GROUP_BY=product_id).
+struct ProductSummary {
+    std::string product_id;
+    Summary summary;
+};
+
 // Holds the result of attempting to read a file.
 struct ReadResult {
     bool success = false;
-    std::string value;  // file content on success; "[ERROR] ..." on failure
+    std::string value;  // "[ERROR] ..." on failure
+    MappedFile file;    // read-only view of the file content on success
+    Compression compression = Compression::none;   // of the file on disk
 };
 
-// AC-S2: tries to open and read the file at path.
+// AC-S2: tries to open and map the file at path.
 // var_name is the .env variable name (used in the error message).
+// gzip and zstd files are recognized by their magic bytes and decompressed
+// on a separate thread (DecompressPipe) into memory; with decompress false
+// they are left as they are, for the caller to stream through a pipe.
 ReadResult read_csv_file(const std::string& path,
-                         const std::string& var_name);
+                         const std::string& var_name,
+                         bool decompress = true);
+
+// AC-S3: Converts parsed rows (including header as the first row) to
+// SalesRecord list.  Rows with fewer than 3 fields are skipped and counted
+// in diagnostics, which may write a
+// "[WARN] Skipping malformed row at line N: insufficient columns" message.
+std::vector<SalesRecord> parse_sales_rows(
+    const CsvTable& table,
+    Diagnostics& diagnostics);
 
-// AC-S3: Converts indexed rows (including header as the first element) to
-// SalesRecord list.  Rows with fewer than 3 fields are skipped; a
-// "[WARN] Skipping malformed row at line N: insufficient columns" message is
-// written to warnings_out for each such row.
+// As above, writing a warning to warnings_out for every skipped row.  The
+// same holds for the other std::ostream overloads below.
 std::vector<SalesRecord> parse_sales_rows(
-    const std::vector<IndexedRow>& all_rows,
+    const CsvTable& table,
     std::ostream& warnings_out);
 
-// Converts indexed rows (including header) to InventoryRecord list.
-// Malformed rows are skipped with a warning.
+// Converts parsed rows (including header) to InventoryRecord list.
+// Malformed rows are skipped and counted in diagnostics.
 std::vector<InventoryRecord> parse_inventory_rows(
-    const std::vector<IndexedRow>& all_rows,
+    const CsvTable& table,
+    Diagnostics& diagnostics);
+
+std::vector<InventoryRecord> parse_inventory_rows(
+    const CsvTable& table,
     std::ostream& warnings_out);
 
+// Columnar variant of parse_sales_rows; skips malformed rows with the same
+// warnings.  With min_amount set, the amount is checked as soon as it is
+// parsed and rows below it are dropped before their order and product IDs
+// are copied or interned -- the same rows filter_by_amount would drop.
+SalesBatch parse_sales_batch(
+    const CsvTable& table,
+    Diagnostics& diagnostics,
+    std::optional<double> min_amount = std::nullopt);
+
+SalesBatch parse_sales_batch(
+    const CsvTable& table,
+    std::ostream& warnings_out,
+    std::optional<double> min_amount = std::nullopt);
+
 // AC-H1 / AC-H2: Inner join — returns only those sales records whose
 // product_id exists in the inventory list.
 std::vector<SalesRecord> join_with_inventory(
@@ -60,10 +190,226 @@ std::vector<SalesRecord> filter_by_amount(
     double min_amount);
 
 // Computes aggregate summary (count, total, average) from a list of records.
+// The total is a StableSum: it depends only on the sequence of amounts, so
+// every compute_summary overload and the streaming pipeline agree to the bit.
 Summary compute_summary(const std::vector<SalesRecord>& rows);
 
+// Columnar join: selects the rows of sales whose product_id exists in the
+// inventory list.  Each inventory product is looked up once in the sales
+// dictionary to build a bitmap over product codes; rows are then selected by
+// testing their code's bit, without touching any string.
+Selection join_with_inventory(
+    const SalesBatch& sales,
+    const std::vector<InventoryRecord>& inventory);
+
+// Same selection from a prebuilt (or loaded) inventory index: each distinct
+// product of the sales dictionary is probed once.
+Selection join_with_inventory(
+    const SalesBatch& sales,
+    const InventoryIndex& inventory);
+
+// Columnar filter: clears the selected rows whose amount is below
+// min_amount.  Compares a whole SIMD register of amounts per instruction.
+void filter_by_amount(
+    const SalesBatch& sales,
+    double min_amount,
+    Selection& selection);
+
+// Columnar summary over the selected rows.  Large selections are summed on
+// up to `threads` threads (0 = one per hardware thread); the result is
+// bit-identical for any thread count and to the record-based overload.
+Summary compute_summary(
+    const SalesBatch& sales,
+    const Selection& selection,
+    unsigned threads = 0);
+
+// Per-product summaries of the selected rows, ordered by product_id.
+// A product's total is a compensated sum over fixed chunks of its own rows,
+// each summed in row order and merged in order.  Large selections use up to
+// `threads` threads (0 = one per hardware thread): the chunks of one
+// product are spread over the threads, so a hot product does not fall to
+// a single one, and the totals are still bit-identical for any thread count
+// and to the streaming pipeline.
+std::vector<ProductSummary> compute_product_summaries(
+    const SalesBatch& sales,
+    const Selection& selection,
+    unsigned threads = 0);
+
+// Streaming equivalent of parse_sales_rows -> join_with_inventory ->
+// filter_by_amount -> compute_summary: sales rows are read, joined, filtered
+// and accumulated one at a time, so memory use does not depend on the size
+// of sales_content.  The Summary and the warnings are identical to the batch
+// pipeline's.
+Summary summarize_sales_stream(
+    std::string_view sales_content,
+    char delimiter,
+    const std::vector<InventoryRecord>& inventory,
+    double min_amount,
+    std::ostream& warnings_out);
+
+// Result of one query of a QUERY_FILE.
+struct QueryResult {
+    Summary summary;                      // if the query has no group_by
+    std::vector<ProductSummary> groups;   // if group_by is "product_id"
+};
+
+// Evaluates every query over one parsed and joined batch: each query only
+// filters and sums the amount column under the shared join selection, so
+// N reports cost one read, parse and join of the input files.  To apply the
+// lowest threshold while parsing, pass it to parse_sales_batch.  Results
+// are in query order and equal those of separate runs, bit for bit, also
+// for group_by queries and for run_queries_stream.
+std::vector<QueryResult> run_queries(
+    const SalesBatch& sales,
+    const Selection& joined,
+    const std::vector<Query>& queries);
+
+// Streaming variant of run_queries: one pass over sales_content feeds every
+// query's accumulator.
+std::vector<QueryResult> run_queries_stream(
+    std::string_view sales_content,
+    char delimiter,
+    const InventoryIndex& inventory,
+    const std::vector<Query>& queries,
+    Diagnostics& diagnostics);
+
+std::vector<QueryResult> run_queries_stream(
+    std::string_view sales_content,
+    char delimiter,
+    const InventoryIndex& inventory,
+    const std::vector<Query>& queries,
+    std::ostream& warnings_out);
+
+// Streaming variant over sales content that arrives in blocks, e.g. a
+// compressed SALES_FILE from a DecompressPipe: each block is read while the
+// next ones are being decompressed, and memory use stays that of the ring.
+// Results and warnings equal those over the whole content; the caller
+// checks sales_blocks.error() afterwards.
+std::vector<QueryResult> run_queries_stream(
+    DecompressPipe& sales_blocks,
+    char delimiter,
+    const InventoryIndex& inventory,
+    const std::vector<Query>& queries,
+    Diagnostics& diagnostics);
+
+std::vector<QueryResult> run_queries_stream(
+    DecompressPipe& sales_blocks,
+    char delimiter,
+    const InventoryIndex& inventory,
+    const std::vector<Query>& queries,
+    std::ostream& warnings_out);
+
+// Running results of a set of queries over a sales file that is only ever
+// appended to.  Besides the aggregates it keeps how much of the file has
+// been read -- byte offset, line count and a hash of those bytes, chained
+// over fixed blocks so that it grows with the file -- so that each update()
+// reads only the rows added since.  The whole state can be
+// saved as a checkpoint and loaded by a later process.  Results equal those
+// of run_queries_stream over the lines read.  Move-only.
+class IncrementalQueries {
+public:
+    // inventory_hash identifies the inventory the rows are joined with; a
+    // checkpoint saved for another one (or another delimiter) is not loaded.
+    IncrementalQueries(const std::vector<Query>& queries,
+                       char delimiter,
+                       std::uint64_t inventory_hash);
+    ~IncrementalQueries();
+
+    IncrementalQueries(IncrementalQueries&&) noexcept;
+    IncrementalQueries& operator=(IncrementalQueries&&) noexcept;
+
+    IncrementalQueries(const IncrementalQueries&) = delete;
+    IncrementalQueries& operator=(const IncrementalQueries&) = delete;
+
+    // Continues from bytes written by save().  Returns false, leaving the
+    // state unchanged, if they are malformed, were saved for another
+    // delimiter or inventory, or lack an aggregate for one of the queries
+    // (same MIN_AMOUNT and grouping).
+    bool load(std::string_view checkpoint);
+
+    std::string save() const;
+
+    // Adds the complete lines of sales_content after those already read.
+    // If sales_content no longer starts with the bytes already read, starts
+    // over from its beginning and returns false.  Only the rows read in
+    // this call are counted in diagnostics.  The 4 KiB before the offset
+    // are compared first, so most changed files are rejected without
+    // hashing the rest; otherwise the whole prefix is rehashed.  Only
+    // append_only_file, the identity of a sales file the caller trusts to be
+    // appended to and never edited in place (SALES_APPEND_ONLY), skips that:
+    // while it keeps its device, inode and a no older mtime, the 4 KiB
+    // suffice, and an in-place edit of earlier bytes goes unnoticed.
+    bool update(std::string_view sales_content,
+                const InventoryIndex& inventory,
+                Diagnostics& diagnostics,
+                const FileIdentity& append_only_file = {});
+
+    // Adds the last line of sales_content if it has no newline yet.  Only
+    // results() is meaningful afterwards.
+    void add_unfinished_line(std::string_view sales_content,
+                             const InventoryIndex& inventory,
+                             Diagnostics& diagnostics);
+
+    // Bytes of sales content read so far.
+    std::uint64_t offset() const;
+
+    std::vector<QueryResult> results() const;
+
+private:
+    struct State;
+    std::unique_ptr<State> state_;
+};
+
+// run_queries_stream over an appended sales file with IncrementalQueries,
+// kept in the checkpoint file between runs.  A missing or unusable
+// checkpoint means a full scan.  Only complete lines are checkpointed: a
+// last line without its newline counts in this run's results and is read
+// again next time.  Results equal those of run_queries_stream over the
+// whole of sales_content.  append_only_file is passed on to update().
+std::vector<QueryResult> run_queries_incremental(
+    std::string_view sales_content,
+    char delimiter,
+    const InventoryIndex& inventory,
+    std::uint64_t inventory_hash,
+    const std::vector<Query>& queries,
+    const std::string& checkpoint_path,
+    Diagnostics& diagnostics,
+    const FileIdentity& append_only_file = {});
+
+std::vector<QueryResult> run_queries_incremental(
+    std::string_view sales_content,
+    char delimiter,
+    const InventoryIndex& inventory,
+    std::uint64_t inventory_hash,
+    const std::vector<Query>& queries,
+    const std::string& checkpoint_path,
+    std::ostream& warnings_out,
+    const FileIdentity& append_only_file = {});
+
+// Per-product variant of summarize_sales_stream.  Memory use grows with the
+// number of distinct products, not with the number of rows; the result
+// equals compute_product_summaries.
+std::vector<ProductSummary> summarize_sales_stream_by_product(
+    std::string_view sales_content,
+    char delimiter,
+    const std::vector<InventoryRecord>& inventory,
+    double min_amount,
+    std::ostream& warnings_out);
+
 // AC-H1: Formats summary as a single-line JSON object.
 std::string format_json(const Summary& summary);
 
+// Formats per-product summaries as a single-line JSON array of objects with
+// product_id, count, total and average.
+std::string format_json(const std::vector<ProductSummary>& groups);
+
 // AC-H5: Formats summary as a two-line CSV (header + data row).
 std::string format_csv_output(const Summary& summary);
+
+// Formats per-product summaries as CSV: a product_id,count,total,average
+// header and one row per product.
+std::string format_csv_output(const std::vector<ProductSummary>& groups);
+
+// Formats the result of one query as csv_reporter prints it, in the
+// query's OUTPUT_FORMAT and grouping, ending with a newline.
+std::string format_result(const Query& query, const QueryResult& result);
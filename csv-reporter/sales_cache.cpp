@@ -0,0 +1,200 @@
+#include "sales_cache.h"
+
+#include "csv_parser.h"
+
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+constexpr std::uint64_t kCacheMagic = 0x3245484341434c53ULL;  // "SLCACHE2"
+
+// Start of a cache file.  The columns follow in this order, each padded to
+// a multiple of 8 bytes so that every one is aligned in the mapping:
+// amounts, product_codes, order_id_offsets, order_id_bytes, the skipped
+// rows, and the serialized ProductDictionary up to the end of the file.
+struct CacheHeader {
+    std::uint64_t magic;
+    std::uint64_t size;
+    std::int64_t mtime;
+    std::uint64_t hash;
+    std::uint64_t delimiter;
+    double min_amount;
+    std::uint64_t rows;
+    std::uint64_t order_id_bytes;
+    std::uint64_t skipped_rows;
+};
+
+// A skipped row as stored.
+struct StoredIssue {
+    std::uint32_t problem;
+    std::int32_t line;
+};
+
+std::size_t padded(std::size_t n) {
+    return (n + 7) & ~std::size_t{7};
+}
+
+void append_padded(std::string& out, const void* data, std::size_t n) {
+    out.append(static_cast<const char*>(data), n);
+    out.append(padded(n) - n, '\0');
+}
+
+}  // namespace
+
+bool save_sales_cache(const std::string& path,
+                      const FileStamp& stamp,
+                      double min_amount,
+                      const SalesBatch& batch,
+                      const std::vector<RowIssue>& skipped) {
+    const std::size_t rows = batch.size();
+    const CacheHeader header{kCacheMagic, stamp.size, stamp.mtime, stamp.hash,
+                             static_cast<unsigned char>(stamp.delimiter), min_amount,
+                             rows, batch.order_id_bytes.size(), skipped.size()};
+    std::vector<StoredIssue> issues;
+    issues.reserve(skipped.size());
+    for (const RowIssue& issue : skipped) {
+        issues.push_back({static_cast<std::uint32_t>(issue.problem), issue.line});
+    }
+    std::string bytes;
+    bytes.reserve(sizeof(header) + rows * (sizeof(double) + sizeof(std::uint32_t) + 8) +
+                  padded(batch.order_id_bytes.size()) + issues.size() * sizeof(StoredIssue));
+    bytes.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    append_padded(bytes, batch.amounts.data(), rows * sizeof(double));
+    append_padded(bytes, batch.product_codes.data(), rows * sizeof(std::uint32_t));
+    append_padded(bytes, batch.order_id_offsets.data(), (rows + 1) * sizeof(std::uint64_t));
+    append_padded(bytes, batch.order_id_bytes.data(), batch.order_id_bytes.size());
+    append_padded(bytes, issues.data(), issues.size() * sizeof(StoredIssue));
+    batch.products.serialize(bytes);
+    return replace_file(path, bytes);
+}
+
+bool load_sales_cache(const std::string& path,
+                      const FileStamp& stamp,
+                      double min_amount,
+                      SalesBatch& batch,
+                      std::vector<RowIssue>& skipped) {
+    MappedFile file;
+    if (!file.open(path)) {
+        return false;
+    }
+    std::string_view bytes = file.view();
+    CacheHeader header;
+    if (bytes.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (header.magic != kCacheMagic || header.size != stamp.size ||
+        header.mtime != stamp.mtime || header.hash != stamp.hash ||
+        header.delimiter != static_cast<unsigned char>(stamp.delimiter) ||
+        !(header.min_amount <= min_amount)) {
+        return false;
+    }
+    bytes.remove_prefix(sizeof(header));
+
+    // Every row takes at least 20 bytes.  Bounding the counts by the file
+    // size first keeps the sums below from overflowing.
+    if (header.rows > bytes.size() / 20 || header.order_id_bytes > bytes.size() ||
+        header.skipped_rows > bytes.size() / sizeof(StoredIssue)) {
+        return false;
+    }
+    const std::size_t rows = static_cast<std::size_t>(header.rows);
+    const std::size_t order_id_bytes = static_cast<std::size_t>(header.order_id_bytes);
+    const std::size_t issue_bytes =
+        static_cast<std::size_t>(header.skipped_rows) * sizeof(StoredIssue);
+    const std::size_t amount_bytes = rows * sizeof(double);
+    const std::size_t code_bytes = padded(rows * sizeof(std::uint32_t));
+    const std::size_t columns = amount_bytes + code_bytes + (rows + 1) * sizeof(std::uint64_t);
+    const std::size_t dictionary_start = columns + padded(order_id_bytes) + issue_bytes;
+    if (dictionary_start > bytes.size()) {
+        return false;
+    }
+
+    const char* p = bytes.data();
+    const auto* offsets = reinterpret_cast<const std::uint64_t*>(p + amount_bytes + code_bytes);
+    if (offsets[0] != 0 || offsets[rows] != order_id_bytes) {
+        return false;
+    }
+    std::vector<RowIssue> issues(static_cast<std::size_t>(header.skipped_rows));
+    const char* stored = p + columns + padded(order_id_bytes);
+    for (RowIssue& issue : issues) {
+        StoredIssue s;
+        std::memcpy(&s, stored, sizeof(s));
+        stored += sizeof(s);
+        if (s.problem >= kRowProblemKinds) {
+            return false;
+        }
+        issue = {static_cast<RowProblem>(s.problem), s.line};
+    }
+    ProductDictionary products;
+    if (!products.attach(bytes.substr(dictionary_start))) {
+        return false;
+    }
+    // The columns are trusted from here on: every product code must name a
+    // product and the order ID offsets must not decrease, which with the
+    // first and last checked above keeps every order ID inside its bytes.
+    const auto* codes = reinterpret_cast<const std::uint32_t*>(p + amount_bytes);
+    for (std::size_t i = 0; i < rows; ++i) {
+        if (codes[i] >= products.size() || offsets[i + 1] < offsets[i]) {
+            return false;
+        }
+    }
+
+    batch = SalesBatch();
+    batch.amounts.attach(reinterpret_cast<const double*>(p), rows);
+    batch.product_codes.attach(codes, rows);
+    batch.order_id_offsets.attach(offsets, rows + 1);
+    batch.order_id_bytes.attach(p + columns, order_id_bytes);
+    batch.products = std::move(products);
+    batch.cache = std::move(file);
+    skipped = std::move(issues);
+    return true;
+}
+
+std::variant<SalesBatch, std::string> read_sales_batch(
+    const std::string& path,
+    std::string_view file_bytes,
+    Compression compression,
+    char delimiter,
+    double min_amount,
+    bool use_cache,
+    Diagnostics& diagnostics) {
+
+    const std::string sidecar = path + ".cache";
+    FileStamp stamp;
+    if (use_cache) {
+        stamp = stamp_file(path, file_bytes, delimiter);
+        SalesBatch batch;
+        std::vector<RowIssue> skipped;
+        if (load_sales_cache(sidecar, stamp, min_amount, batch, skipped)) {
+            for (const RowIssue& issue : skipped) {
+                diagnostics.skip_row(issue.problem, [&] { return issue.line; });
+            }
+            return batch;
+        }
+    }
+
+    std::string decompressed;
+    if (compression != Compression::none) {
+        std::string error;
+        if (!decompress_all(file_bytes, compression, decompressed, error)) {
+            return "[ERROR] Cannot decompress SALES_FILE: " + path + ": " + error;
+        }
+        file_bytes = decompressed;
+    }
+
+    const auto rows = parse_csv_content(file_bytes, delimiter);
+    if (!use_cache) {
+        return parse_sales_batch(rows, diagnostics, min_amount);
+    }
+    // Every skipped row is kept for the cache, not just those shown.
+    std::vector<RowIssue> skipped;
+    diagnostics.record(&skipped);
+    SalesBatch batch = parse_sales_batch(rows, diagnostics, min_amount);
+    diagnostics.record(nullptr);
+    if (!save_sales_cache(sidecar, stamp, min_amount, batch, skipped)) {
+        diagnostics.out() << "[WARN] Could not write sales cache " << sidecar << "\n";
+    }
+    return batch;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "decompress.h"
+#include "diagnostics.h"
+#include "mapped_file.h"
+#include "reporter.h"
+
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+// A sales cache is the columnar image of a parsed sales file: the amount
+// column, product codes, order ID offsets and bytes, the product dictionary
+// and the rows the parse skipped, stamped with the file they came from.
+// A later run maps it and goes straight to join, filter and aggregation;
+// the amount column comes first, so a report pages in little else.
+
+// Writes batch, parsed from the sales file stamped stamp with rows below
+// min_amount dropped, and the rows its parse skipped, to path with
+// replace_file.  Returns false if it cannot be written.
+bool save_sales_cache(const std::string& path,
+                      const FileStamp& stamp,
+                      double min_amount,
+                      const SalesBatch& batch,
+                      const std::vector<RowIssue>& skipped);
+
+// Maps a cache written by save_sales_cache into batch, whose columns then
+// view the file.  Returns false, leaving batch and skipped unchanged, if
+// the file is missing or malformed, was saved with a different stamp, or
+// dropped rows that min_amount keeps.
+bool load_sales_cache(const std::string& path,
+                      const FileStamp& stamp,
+                      double min_amount,
+                      SalesBatch& batch,
+                      std::vector<RowIssue>& skipped);
+
+// parse_sales_batch over the sales file at path, whose bytes on disk are
+// file_bytes, decompressing them first if need be.  With use_cache the
+// batch saved in path + ".cache" by an earlier run is mapped instead while
+// the file is unchanged and that run's MIN_AMOUNT was no higher, and a
+// freshly parsed batch is saved there for the next run.  Malformed rows
+// are counted in diagnostics, from the cache if it is used, and a failure
+// to save is written to its out().  Returns an "[ERROR] ..." message if
+// the file cannot be decompressed.
+std::variant<SalesBatch, std::string> read_sales_batch(
+    const std::string& path,
+    std::string_view file_bytes,
+    Compression compression,
+    char delimiter,
+    double min_amount,
+    bool use_cache,
+    Diagnostics& diagnostics);
@@ -0,0 +1,90 @@
+#include "stable_sum.h"
+
+#include <cmath>
+
+// Neumaier's variant of Kahan summation: the error term is taken from
+// whichever operand is larger in magnitude, so it also holds when the new
+// value dominates the running sum.
+StableSum::Partial StableSum::accumulate(Partial p, double value) {
+    const double t = p.sum + value;
+    p.compensation += (std::fabs(p.sum) >= std::fabs(value))
+        ? (p.sum - t) + value
+        : (value - t) + p.sum;
+    p.sum = t;
+    return p;
+}
+
+StableSum::Partial StableSum::merge(const Partial& left, const Partial& right) {
+    Partial p = accumulate(left, right.sum);
+    p.compensation += right.compensation;
+    return p;
+}
+
+StableSum::Partial StableSum::Block::finish() const {
+    return merge(merge(lanes_[0], lanes_[1]), merge(lanes_[2], lanes_[3]));
+}
+
+// Binary-counter carry: two pending sums of 2^i blocks each become one of
+// 2^(i+1) blocks, always with the older one on the left.
+void StableSum::push(Partial block) {
+    std::size_t level = 0;
+    for (std::uint64_t n = blocks_; n & 1; n >>= 1, ++level) {
+        block = merge(levels_[level], block);
+    }
+    if (level == levels_.size()) {
+        levels_.push_back(block);
+    } else {
+        levels_[level] = block;
+    }
+    ++blocks_;
+}
+
+void StableSum::append(const Block& block) {
+    if (block.full()) {
+        push(block.finish());
+    } else {
+        block_ = block;
+    }
+}
+
+double StableSum::value() const {
+    // Fold the pending levels from the most recent (smallest) upwards,
+    // keeping older sums on the left.
+    Partial p = block_.finish();
+    for (std::size_t level = 0; level < levels_.size(); ++level) {
+        if ((blocks_ >> level) & 1) {
+            p = merge(levels_[level], p);
+        }
+    }
+    return to_double(p);
+}
+
+StableSum::State StableSum::state() const {
+    State s;
+    for (int lane = 0; lane < 4; ++lane) {
+        s.lanes[lane] = block_.lanes_[lane];
+    }
+    s.block_count = block_.count_;
+    s.blocks = blocks_;
+    s.levels = levels_;
+    return s;
+}
+
+bool StableSum::restore(const State& state) {
+    if (state.block_count >= kBlockSize ||
+        (state.levels.size() < 64 && (state.blocks >> state.levels.size()) != 0)) {
+        return false;
+    }
+    for (int lane = 0; lane < 4; ++lane) {
+        block_.lanes_[lane] = state.lanes[lane];
+    }
+    block_.count_ = static_cast<std::size_t>(state.block_count);
+    blocks_ = state.blocks;
+    levels_ = state.levels;
+    return true;
+}
+
+double StableSum::to_double(const Partial& p) {
+    // Inf and NaN make the compensation meaningless.
+    return std::isfinite(p.sum) ? p.sum + p.compensation : p.sum;
+}
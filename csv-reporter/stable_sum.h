@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Compensated sum whose result depends only on the sequence of values
+// added, not on how the work was split up.  Values are grouped into blocks
+// of kBlockSize in sequence order; inside a block, four interleaved lanes
+// keep Neumaier-compensated sums, and full blocks are combined by a fixed
+// pairwise tree (a binary counter over block numbers).  Blocks may be
+// accumulated on different threads and appended in order afterwards with an
+// identical, bit-for-bit result.  State is O(log n) in the number of values.
+class StableSum {
+public:
+    static constexpr std::size_t kBlockSize = 1024;
+
+    // Running sum plus the rounding error it has lost so far.
+    struct Partial {
+        double sum = 0.0;
+        double compensation = 0.0;
+    };
+
+    // Values of one block, or of the leading part of one.
+    class Block {
+    public:
+        void add(double value) {
+            lanes_[count_ % 4] = accumulate(lanes_[count_ % 4], value);
+            ++count_;
+        }
+        std::size_t size() const { return count_; }
+        bool full() const { return count_ == kBlockSize; }
+        Partial finish() const;
+
+    private:
+        friend class StableSum;
+
+        Partial lanes_[4];
+        std::size_t count_ = 0;
+    };
+
+    // Everything the result depends on, so that a sum can be saved and
+    // resumed later with the result it would have had without stopping.
+    struct State {
+        Partial lanes[4];
+        std::uint64_t block_count = 0;   // values in the current block
+        std::uint64_t blocks = 0;
+        std::vector<Partial> levels;
+    };
+
+    void add(double value) {
+        block_.add(value);
+        if (block_.full()) {
+            push(block_.finish());
+            block_ = Block();
+        }
+    }
+
+    // Appends a block accumulated elsewhere.  Every appended block except
+    // the last one must be full, and nothing may be added in between.
+    void append(const Block& block);
+
+    std::uint64_t count() const { return blocks_ * kBlockSize + block_.size(); }
+
+    // The compensated total so far.
+    double value() const;
+
+    State state() const;
+
+    // Continues from a saved state.  Returns false, leaving the sum
+    // unchanged, if state could not have come from state().
+    bool restore(const State& state);
+
+    static Partial accumulate(Partial p, double value);
+    static Partial merge(const Partial& left, const Partial& right);
+
+    // The compensated value of p.
+    static double to_double(const Partial& p);
+
+private:
+    void push(Partial block);
+
+    Block block_;                   // the current, incomplete block
+    std::uint64_t blocks_ = 0;      // full blocks so far
+    std::vector<Partial> levels_;   // levels_[i] is pending iff bit i of blocks_ is set
+};
@@ -12,11 +12,20 @@
 //  AC-S4 – validate_config with non-numeric MIN_AMOUNT returns "[ERROR]"
 //  AC-S5 – validate_config with unsupported OUTPUT_FORMAT returns "[ERROR]"
 //  AC-S6 – validate_config with empty SALES_FILE or INVENTORY_FILE returns "[ERROR]"
+//  apply_options accepts EXECUTION_MODE batch / stream and rejects anything else
+//  load_queries reads a QUERY_FILE and reports malformed rows by line
+//  apply_options accepts OUTPUT_GROUP_BY empty / product_id and rejects anything else
+//  apply_options accepts INVENTORY_INDEX off / on and rejects anything else
+//  apply_options accepts SALES_CACHE off / on and rejects anything else
+//  apply_options accepts SALES_APPEND_ONLY off / on and rejects anything else
+//  apply_options reads WARN_SAMPLES (a count or "all") and WARN_RATE
 
 #include <gtest/gtest.h>
 
 #include "config.h"
 
+#include <cstdio>
+#include <fstream>
 #include <variant>
 
 // ---------------------------------------------------------------------------
@@ -175,3 +184,246 @@ TEST(ValidateConfig, AC_S6_MissingInventoryFileKeyReturnsError) {
     EXPECT_NE(err.find("[ERROR]"),        std::string::npos);
     EXPECT_NE(err.find("INVENTORY_FILE"), std::string::npos);
 }
+
+// ---------------------------------------------------------------------------
+// EXECUTION_MODE selects the batch or the streaming pipeline
+// ---------------------------------------------------------------------------
+
+TEST(ApplyOptions, DefaultExecutionModeIsBatch) {
+    auto result = apply_options(Config{}, ConfigOptions{});
+
+    ASSERT_TRUE(std::holds_alternative<Config>(result));
+    EXPECT_EQ(std::get<Config>(result).execution_mode, "batch");
+}
+
+TEST(ApplyOptions, StreamExecutionModeIsAccepted) {
+    ConfigOptions options;
+    options.execution_mode = "stream";
+    auto result = apply_options(Config{}, options);
+
+    ASSERT_TRUE(std::holds_alternative<Config>(result));
+    EXPECT_EQ(std::get<Config>(result).execution_mode, "stream");
+}
+
+TEST(ApplyOptions, UnknownExecutionModeReturnsError) {
+    ConfigOptions options;
+    options.execution_mode = "lazy";
+    auto result = apply_options(Config{}, options);
+
+    ASSERT_TRUE(std::holds_alternative<std::string>(result));
+    const auto& err = std::get<std::string>(result);
+    EXPECT_NE(err.find("[ERROR]"),        std::string::npos);
+    EXPECT_NE(err.find("EXECUTION_MODE"), std::string::npos);
+    EXPECT_NE(err.find("lazy"),           std::string::npos);
+}
+
+// ---------------------------------------------------------------------------
+// OUTPUT_GROUP_BY selects per-product summaries
+// ---------------------------------------------------------------------------
+
+TEST(ApplyOptions, GroupByProductIdIsAccepted) {
+    ConfigOptions options;
+    options.group_by = "product_id";
+    auto result = apply_options(Config{}, options);
+
+    ASSERT_TRUE(std::holds_alternative<Config>(result));
+    EXPECT_EQ(std::get<Config>(result).group_by, "product_id");
+}
+
+TEST(ApplyOptions, UnknownGroupByReturnsError) {
+    ConfigOptions options;
+    options.group_by = "region";
+    auto result = apply_options(Config{}, options);
+
+    ASSERT_TRUE(std::holds_alternative<std::string>(result));
+    const auto& err = std::get<std::string>(result);
+    EXPECT_NE(err.find("[ERROR]"),         std::string::npos);
+    EXPECT_NE(err.find("OUTPUT_GROUP_BY"), std::string::npos);
+    EXPECT_NE(err.find("region"),          std::string::npos);
+}
+
+// ---------------------------------------------------------------------------
+// INVENTORY_INDEX keeps the join index across runs
+// ---------------------------------------------------------------------------
+
+TEST(ApplyOptions, InventoryIndexIsOffByDefault) {
+    auto result = apply_options(Config{}, ConfigOptions{});
+
+    ASSERT_TRUE(std::holds_alternative<Config>(result));
+    EXPECT_FALSE(std::get<Config>(result).inventory_index);
+
+    ConfigOptions options;
+    options.inventory_index = "on";
+    result = apply_options(Config{}, options);
+    ASSERT_TRUE(std::holds_alternative<Config>(result));
+    EXPECT_TRUE(std::get<Config>(result).inventory_index);
+}
+
+TEST(ApplyOptions, UnknownInventoryIndexReturnsError) {
+    ConfigOptions options;
+    options.inventory_index = "yes";
+    auto result = apply_options(Config{}, options);
+
+    ASSERT_TRUE(std::holds_alternative<std::string>(result));
+    const auto& err = std::get<std::string>(result);
+    EXPECT_NE(err.find("[ERROR]"),         std::string::npos);
+    EXPECT_NE(err.find("INVENTORY_INDEX"), std::string::npos);
+}
+
+// ---------------------------------------------------------------------------
+// SALES_CACHE keeps the parsed sales columns across runs
+// ---------------------------------------------------------------------------
+
+TEST(ApplyOptions, SalesCacheIsOffByDefault) {
+    auto result = apply_options(Config{}, ConfigOptions{});
+
+    ASSERT_TRUE(std::holds_alternative<Config>(result));
+    EXPECT_FALSE(std::get<Config>(result).sales_cache);
+
+    ConfigOptions options;
+    options.sales_cache = "on";
+    result = apply_options(Config{}, options);
+    ASSERT_TRUE(std::holds_alternative<Config>(result));
+    EXPECT_TRUE(std::get<Config>(result).sales_cache);
+}
+
+TEST(ApplyOptions, UnknownSalesCacheReturnsError) {
+    ConfigOptions options;
+    options.sales_cache = "1";
+    auto result = apply_options(Config{}, options);
+
+    ASSERT_TRUE(std::holds_alternative<std::string>(result));
+    const auto& err = std::get<std::string>(result);
+    EXPECT_NE(err.find("[ERROR]"),     std::string::npos);
+    EXPECT_NE(err.find("SALES_CACHE"), std::string::npos);
+}
+
+// ---------------------------------------------------------------------------
+// SALES_APPEND_ONLY trusts SALES_FILE not to be edited in place
+// ---------------------------------------------------------------------------
+
+TEST(ApplyOptions, SalesAppendOnlyIsOffByDefault) {
+    auto result = apply_options(Config{}, ConfigOptions{});
+
+    ASSERT_TRUE(std::holds_alternative<Config>(result));
+    EXPECT_FALSE(std::get<Config>(result).sales_append_only);
+
+    ConfigOptions options;
+    options.sales_append_only = "on";
+    result = apply_options(Config{}, options);
+    ASSERT_TRUE(std::holds_alternative<Config>(result));
+    EXPECT_TRUE(std::get<Config>(result).sales_append_only);
+}
+
+TEST(ApplyOptions, UnknownSalesAppendOnlyReturnsError) {
+    ConfigOptions options;
+    options.sales_append_only = "yes";
+    auto result = apply_options(Config{}, options);
+
+    ASSERT_TRUE(std::holds_alternative<std::string>(result));
+    const auto& err = std::get<std::string>(result);
+    EXPECT_NE(err.find("[ERROR]"),           std::string::npos);
+    EXPECT_NE(err.find("SALES_APPEND_ONLY"), std::string::npos);
+}
+
+// ---------------------------------------------------------------------------
+// WARN_SAMPLES / WARN_RATE limit the malformed-row warnings
+// ---------------------------------------------------------------------------
+
+TEST(ApplyOptions, WarnSamplesDefaultsToTwentyAndAcceptsAll) {
+    auto result = apply_options(Config{}, ConfigOptions{});
+
+    ASSERT_TRUE(std::holds_alternative<Config>(result));
+    EXPECT_EQ(std::get<Config>(result).warn_limits.max_samples, 20u);
+    EXPECT_EQ(std::get<Config>(result).warn_limits.max_per_second, 0.0);
+
+    ConfigOptions options;
+    options.warn_samples = "all";
+    options.warn_rate    = "2.5";
+    options.warn_summary_file = "warnings.json";
+    result = apply_options(Config{}, options);
+    ASSERT_TRUE(std::holds_alternative<Config>(result));
+    EXPECT_EQ(std::get<Config>(result).warn_limits.max_samples,
+              DiagnosticsLimits{}.max_samples);
+    EXPECT_EQ(std::get<Config>(result).warn_limits.max_per_second, 2.5);
+    EXPECT_EQ(std::get<Config>(result).warn_summary_file, "warnings.json");
+
+    options.warn_samples = "0";
+    result = apply_options(Config{}, options);
+    ASSERT_TRUE(std::holds_alternative<Config>(result));
+    EXPECT_EQ(std::get<Config>(result).warn_limits.max_samples, 0u);
+}
+
+TEST(ApplyOptions, InvalidWarnSamplesOrRateReturnsError) {
+    for (const char* bad : {"-1", "many", ""}) {
+        ConfigOptions options;
+        options.warn_samples = bad;
+        auto result = apply_options(Config{}, options);
+        ASSERT_TRUE(std::holds_alternative<std::string>(result)) << bad;
+        EXPECT_NE(std::get<std::string>(result).find("WARN_SAMPLES"), std::string::npos);
+    }
+    for (const char* bad : {"-1", "fast", ""}) {
+        ConfigOptions options;
+        options.warn_rate = bad;
+        auto result = apply_options(Config{}, options);
+        ASSERT_TRUE(std::holds_alternative<std::string>(result)) << bad;
+        EXPECT_NE(std::get<std::string>(result).find("WARN_RATE"), std::string::npos);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// QUERY_FILE lists several reports for one run
+// ---------------------------------------------------------------------------
+
+namespace {
+
+std::variant<std::vector<Query>, std::string> load_queries_from(const std::string& text) {
+    const std::string path = "load_queries_test.csv";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << text;
+    }
+    auto result = load_queries(path);
+    std::remove(path.c_str());
+    return result;
+}
+
+}  // namespace
+
+TEST(LoadQueries, ReadsQueriesInFileOrder) {
+    auto result = load_queries_from(
+        "name,min_amount,output_format,group_by\n"
+        "north,1000,json\n"
+        "south,2000,csv,product_id\n");
+
+    ASSERT_TRUE(std::holds_alternative<std::vector<Query>>(result));
+    const auto& queries = std::get<std::vector<Query>>(result);
+    ASSERT_EQ(queries.size(), 2u);
+    EXPECT_EQ(queries[0].name, "north");
+    EXPECT_DOUBLE_EQ(queries[0].min_amount, 1000.0);
+    EXPECT_EQ(queries[0].output_format, "json");
+    EXPECT_EQ(queries[0].group_by, "");
+    EXPECT_EQ(queries[1].name, "south");
+    EXPECT_EQ(queries[1].output_format, "csv");
+    EXPECT_EQ(queries[1].group_by, "product_id");
+}
+
+TEST(LoadQueries, InvalidRowIsReportedWithLineNumber) {
+    auto result = load_queries_from(
+        "name,min_amount,output_format\n"
+        "north,1000,json\n"
+        "south,abc,json\n");
+
+    ASSERT_TRUE(std::holds_alternative<std::string>(result));
+    const auto& err = std::get<std::string>(result);
+    EXPECT_NE(err.find("[ERROR]"), std::string::npos);
+    EXPECT_NE(err.find("line 3"),  std::string::npos);
+    EXPECT_NE(err.find("abc"),     std::string::npos);
+}
+
+TEST(LoadQueries, MissingHeaderOrFileIsAnError) {
+    EXPECT_TRUE(std::holds_alternative<std::string>(
+        load_queries_from("north,1000,json\n")));
+    EXPECT_TRUE(std::holds_alternative<std::string>(
+        load_queries("definitely_nonexistent_queries.csv")));
+}
@@ -5,11 +5,38 @@
 //  AC-H3 – pipe-delimited CSV parses identically to comma-delimited data
 //  AC-S3 – row with fewer columns than the header is still returned (the
 //           business-logic layer in reporter_test.cpp tests the skip/warn)
+//  Parallel parsing of large inputs matches the sequential parse exactly,
+//  and LineIndex gives every row its line number.
+//  The block scanner is checked against a byte-at-a-time reference splitter
+//  on random input for each supported delimiter.
+//  parse_double / parse_int accept and reject exactly what std::stod /
+//  std::stoi do, with bit-identical results.
+//  CsvRowReader yields the same rows and line numbers as parse_csv_content.
 
 #include <gtest/gtest.h>
 
 #include "csv_parser.h"
 
+#include <cmath>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using Fields = std::vector<std::string_view>;
+
+Fields row_fields(const CsvTable& table, std::size_t row) {
+    Fields fields;
+    for (std::size_t c = 0; c < table.field_count(row); ++c) {
+        fields.push_back(table.field(row, c));
+    }
+    return fields;
+}
+
+}  // namespace
+
 // ---------------------------------------------------------------------------
 // AC-H1  Standard comma-separated parsing
 // ---------------------------------------------------------------------------
@@ -25,16 +52,16 @@ TEST(ParseCsvContent, AC_H1_HeaderAndDataRowsParsedWithCommaDelimiter) {
     ASSERT_EQ(rows.size(), 3u);
 
     // Header row at line 1
-    EXPECT_EQ(rows[0].first, 1);
-    EXPECT_EQ(rows[0].second, (CsvRow{"order_id", "product_id", "amount"}));
+    EXPECT_EQ(rows.line_number(0), 1);
+    EXPECT_EQ(row_fields(rows, 0), (Fields{"order_id", "product_id", "amount"}));
 
     // First data row at line 2
-    EXPECT_EQ(rows[1].first, 2);
-    EXPECT_EQ(rows[1].second, (CsvRow{"O001", "P001", "1500"}));
+    EXPECT_EQ(rows.line_number(1), 2);
+    EXPECT_EQ(row_fields(rows, 1), (Fields{"O001", "P001", "1500"}));
 
     // Second data row at line 3
-    EXPECT_EQ(rows[2].first, 3);
-    EXPECT_EQ(rows[2].second, (CsvRow{"O002", "P002", "800"}));
+    EXPECT_EQ(rows.line_number(2), 3);
+    EXPECT_EQ(row_fields(rows, 2), (Fields{"O002", "P002", "800"}));
 }
 
 TEST(ParseCsvContent, AC_H1_EmptyLinesAreSkipped) {
@@ -47,8 +74,8 @@ TEST(ParseCsvContent, AC_H1_EmptyLinesAreSkipped) {
 
     ASSERT_EQ(rows.size(), 2u);
     // The empty line is still counted (line 2), so the data row is at line 3
-    EXPECT_EQ(rows[0].first, 1);
-    EXPECT_EQ(rows[1].first, 3);
+    EXPECT_EQ(rows.line_number(0), 1);
+    EXPECT_EQ(rows.line_number(1), 3);
 }
 
 // ---------------------------------------------------------------------------
@@ -64,9 +91,9 @@ TEST(ParseCsvContent, AC_H3_PipeDelimiterParsesFieldsCorrectly) {
     auto rows = parse_csv_content(content, '|');
 
     ASSERT_EQ(rows.size(), 3u);
-    EXPECT_EQ(rows[0].second, (CsvRow{"order_id", "product_id", "amount"}));
-    EXPECT_EQ(rows[1].second, (CsvRow{"O001", "P001", "1500"}));
-    EXPECT_EQ(rows[2].second, (CsvRow{"O002", "P002", "800"}));
+    EXPECT_EQ(row_fields(rows, 0), (Fields{"order_id", "product_id", "amount"}));
+    EXPECT_EQ(row_fields(rows, 1), (Fields{"O001", "P001", "1500"}));
+    EXPECT_EQ(row_fields(rows, 2), (Fields{"O002", "P002", "800"}));
 }
 
 TEST(ParseCsvContent, AC_H3_PipeAndCommaResultsAreEquivalent) {
@@ -82,7 +109,7 @@ TEST(ParseCsvContent, AC_H3_PipeAndCommaResultsAreEquivalent) {
 
     ASSERT_EQ(comma_rows.size(), pipe_rows.size());
     for (std::size_t i = 0; i < comma_rows.size(); ++i) {
-        EXPECT_EQ(comma_rows[i].second, pipe_rows[i].second);
+        EXPECT_EQ(row_fields(comma_rows, i), row_fields(pipe_rows, i));
     }
 }
 
@@ -104,8 +131,250 @@ TEST(ParseCsvContent, AC_S3_MalformedRowsAreIncludedWithCorrectLineNumber) {
     ASSERT_EQ(rows.size(), 4u);
 
     // The malformed row is at line 3 and has 2 fields
-    EXPECT_EQ(rows[2].first,          3);
-    EXPECT_EQ(rows[2].second.size(),  2u);
-    EXPECT_EQ(rows[2].second[0],      "O002");
-    EXPECT_EQ(rows[2].second[1],      "P002");
+    EXPECT_EQ(rows.line_number(2),          3);
+    EXPECT_EQ(rows.field_count(2),    2u);
+    EXPECT_EQ(rows.field(2, 0),       "O002");
+    EXPECT_EQ(rows.field(2, 1),       "P002");
+}
+
+// ---------------------------------------------------------------------------
+// Field splitting edge cases match the previous std::getline-based splitter
+// ---------------------------------------------------------------------------
+
+TEST(ParseCsvContent, EmptyFieldsAndTrailingDelimiterAreHandledLikeGetline) {
+    const std::string content =
+        "a,,b\r\n"
+        ",x\n"
+        "y,\n"
+        ",\n"
+        "last";
+
+    auto rows = parse_csv_content(content, ',');
+
+    ASSERT_EQ(rows.size(), 5u);
+    EXPECT_EQ(row_fields(rows, 0), (Fields{"a", "", "b"}));
+    EXPECT_EQ(row_fields(rows, 1), (Fields{"", "x"}));
+    EXPECT_EQ(row_fields(rows, 2), (Fields{"y"}));
+    EXPECT_EQ(row_fields(rows, 3), (Fields{""}));
+    EXPECT_EQ(row_fields(rows, 4), (Fields{"last"}));
+    EXPECT_EQ(rows.line_number(4), 5);
+}
+
+TEST(ParseCsvContent, FieldsReferenceTheInputBuffer) {
+    const std::string content = "h1,h2\nv1,v2\n";
+
+    auto rows = parse_csv_content(content, ',');
+
+    ASSERT_EQ(rows.size(), 2u);
+    EXPECT_EQ(rows.field(1, 1).data(), content.data() + 9);
+}
+
+// ---------------------------------------------------------------------------
+// Block scanner agrees with a byte-at-a-time splitter on random input,
+// including lines and fields that straddle 64-byte block boundaries
+// ---------------------------------------------------------------------------
+
+namespace {
+
+struct ReferenceRow {
+    int line;
+    std::vector<std::string> fields;
+};
+
+std::vector<ReferenceRow> reference_split(const std::string& content, char delimiter) {
+    std::vector<ReferenceRow> rows;
+    int line_num = 0;
+    std::size_t pos = 0;
+    while (pos < content.size()) {
+        std::size_t end = content.find('\n', pos);
+        if (end == std::string::npos) {
+            end = content.size();
+        }
+        std::string line = content.substr(pos, end - pos);
+        pos = end + 1;
+        ++line_num;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty()) {
+            continue;
+        }
+        ReferenceRow row{line_num, {}};
+        std::string field;
+        for (char c : line) {
+            if (c == delimiter) {
+                row.fields.push_back(field);
+                field.clear();
+            } else {
+                field += c;
+            }
+        }
+        if (!field.empty()) {
+            row.fields.push_back(field);
+        }
+        rows.push_back(row);
+    }
+    return rows;
+}
+
+}  // namespace
+
+TEST(ParseCsvContent, BlockScannerMatchesReferenceOnRandomInput) {
+    std::mt19937 rng(42);
+    const std::string alphabet = "ab1,|\t\r\n\n";
+
+    for (char delimiter : {',', '|', '\t'}) {
+        for (int iter = 0; iter < 300; ++iter) {
+            std::string content(rng() % 300, ' ');
+            for (auto& c : content) {
+                c = alphabet[rng() % alphabet.size()];
+            }
+
+            const auto table    = parse_csv_content(content, delimiter);
+            const auto expected = reference_split(content, delimiter);
+
+            ASSERT_EQ(table.size(), expected.size()) << content;
+            for (std::size_t r = 0; r < expected.size(); ++r) {
+                ASSERT_EQ(table.line_number(r), expected[r].line) << content;
+                ASSERT_EQ(table.field_count(r), expected[r].fields.size()) << content;
+                for (std::size_t c = 0; c < expected[r].fields.size(); ++c) {
+                    ASSERT_EQ(table.field(r, c), expected[r].fields[c]) << content;
+                }
+            }
+        }
+    }
+}
+
+TEST(CsvRowReader, MatchesReferenceOnRandomInput) {
+    std::mt19937 rng(7);
+    const std::string alphabet = "ab1,|\t\r\n\n";
+
+    for (char delimiter : {',', '|', '\t'}) {
+        for (int iter = 0; iter < 300; ++iter) {
+            std::string content(rng() % 300, ' ');
+            for (auto& c : content) {
+                c = alphabet[rng() % alphabet.size()];
+            }
+
+            const auto expected = reference_split(content, delimiter);
+            CsvRowReader reader(content, delimiter);
+            for (const auto& row : expected) {
+                ASSERT_TRUE(reader.next()) << content;
+                ASSERT_EQ(reader.line_number(), row.line) << content;
+                ASSERT_EQ(reader.field_count(), row.fields.size()) << content;
+                for (std::size_t c = 0; c < row.fields.size(); ++c) {
+                    ASSERT_EQ(reader.field(c), row.fields[c]) << content;
+                }
+            }
+            EXPECT_FALSE(reader.next()) << content;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Chunked parallel parsing yields exactly the sequential result
+// ---------------------------------------------------------------------------
+
+TEST(ParseCsvContent, ParallelParseMatchesSequentialIncludingLineNumbers) {
+    // ~6 MiB with empty lines and CRLF endings scattered throughout, so that
+    // chunk boundaries fall among them
+    std::string content = "order_id,product_id,amount\n";
+    for (int i = 0; i < 250000; ++i) {
+        content += "O" + std::to_string(i) + ",P" + std::to_string(i % 97) + ",12.5";
+        content += (i % 7 == 0) ? "\r\n" : "\n";
+        if (i % 13 == 0) {
+            content += "\n";
+        }
+    }
+
+    const auto sequential = parse_csv_content(content, ',', 1);
+    const auto parallel   = parse_csv_content(content, ',', 4);
+
+    ASSERT_EQ(parallel.size(), sequential.size());
+    EXPECT_EQ(parallel.row_starts,   sequential.row_starts);
+    EXPECT_EQ(parallel.fields,       sequential.fields);
+
+    // LineIndex numbers every row like a newline count from the start
+    LineIndex lines(content);
+    int line = 1;
+    std::size_t counted = 0;
+    for (std::size_t r = 0; r < parallel.size(); ++r) {
+        const std::size_t offset = parallel.row_offset(r);
+        for (; counted < offset; ++counted) {
+            line += (content[counted] == '\n');
+        }
+        ASSERT_EQ(lines.line_of(offset), line) << "row " << r;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Numeric field conversion agrees with std::stod / std::stoi
+// ---------------------------------------------------------------------------
+
+namespace {
+
+// Returns true and sets value if std::stod accepts text.
+bool reference_stod(const std::string& text, double& value) {
+    try {
+        value = std::stod(text);
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+bool reference_stoi(const std::string& text, int& value) {
+    try {
+        value = std::stoi(text);
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+}  // namespace
+
+TEST(ParseNumber, ParseDoubleMatchesStod) {
+    std::vector<std::string> inputs = {
+        "0", "1500", "1200.5", "0.1", "999.99", "-3.25", "+7", " 42", "\t8.5",
+        "12abc", "1e3", "1.5E-2", "123456789012345", "1234567890123456789",
+        "0.30000000000000004", ".5", "5.", "0x1A", "0x1p-2", "inf", "-Infinity",
+        "nan", "1e400", "", "abc", "-", "+-1", " ", ".", "--5", "1,5", "1e",
+    };
+    std::mt19937 rng(99);
+    const std::string alphabet = "0123456789.-+eE x";
+    for (int i = 0; i < 2000; ++i) {
+        std::string text(1 + rng() % 12, ' ');
+        for (auto& c : text) {
+            c = alphabet[rng() % alphabet.size()];
+        }
+        inputs.push_back(text);
+    }
+
+    for (const auto& text : inputs) {
+        double expected = 0.0;
+        double actual = 0.0;
+        const bool ok = reference_stod(text, expected);
+        ASSERT_EQ(parse_double(text, actual), ok) << "'" << text << "'";
+        if (ok && !std::isnan(expected)) {
+            EXPECT_EQ(actual, expected) << "'" << text << "'";
+        }
+    }
+}
+
+TEST(ParseNumber, ParseIntMatchesStoi) {
+    const std::vector<std::string> inputs = {
+        "0", "100", "-5", "+5", " 12", "12abc", "2147483647", "2147483648",
+        "-2147483648", "-2147483649", "99999999999999999999", "", "x", "+-1",
+        "-", "1.5", "007",
+    };
+    for (const auto& text : inputs) {
+        int expected = 0;
+        int actual = 0;
+        const bool ok = reference_stoi(text, expected);
+        ASSERT_EQ(parse_int(text, actual), ok) << "'" << text << "'";
+        if (ok) {
+            EXPECT_EQ(actual, expected) << "'" << text << "'";
+        }
+    }
 }
@@ -0,0 +1,144 @@
+// data_generator_test.cpp
+//
+// The synthetic data generator is deterministic for a spec and differs
+// between seeds; writes the requested number of rows or bytes, streamed
+// output equal to the in-memory one; parses with the requested delimiter;
+// produces about the requested share of malformed rows, each counted as
+// insufficient columns or an invalid value; concentrates sales on few
+// products under Zipf skew; and lists about the requested share of products
+// in the inventory.
+
+#include <gtest/gtest.h>
+
+#include "csv_parser.h"
+#include "data_generator.h"
+#include "diagnostics.h"
+#include "reporter.h"
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+DataSpec small_spec() {
+    DataSpec spec;
+    spec.sales_rows = 20000;
+    spec.products = 1000;
+    return spec;
+}
+
+}  // namespace
+
+TEST(DataGenerator, SameSpecSameBytes) {
+    DataSpec spec = small_spec();
+    spec.zipf = 1.1;
+    spec.malformed = 0.01;
+    EXPECT_EQ(generate_sales(spec), generate_sales(spec));
+    EXPECT_EQ(generate_inventory(spec), generate_inventory(spec));
+
+    DataSpec other = spec;
+    other.seed = 2;
+    EXPECT_NE(generate_sales(other), generate_sales(spec));
+}
+
+TEST(DataGenerator, WritesRequestedRowsOrBytes) {
+    DataSpec spec = small_spec();
+    const std::string sales = generate_sales(spec);
+    EXPECT_EQ(std::count(sales.begin(), sales.end(), '\n'), 20001);
+    EXPECT_EQ(sales.substr(0, sales.find('\n')), "order_id,product_id,amount");
+
+    // Streamed in blocks, with the size as the target
+    spec.sales_bytes = 3u << 20;
+    std::ostringstream out;
+    const std::uint64_t rows = write_sales(spec, out);
+    const std::string streamed = out.str();
+    EXPECT_GE(streamed.size(), spec.sales_bytes);
+    EXPECT_LT(streamed.size(), spec.sales_bytes + 64);
+    EXPECT_EQ(static_cast<std::uint64_t>(std::count(streamed.begin(), streamed.end(), '\n')),
+              rows + 1);
+    EXPECT_EQ(streamed, generate_sales(spec));
+}
+
+TEST(DataGenerator, UsesTheDelimiter) {
+    DataSpec spec = small_spec();
+    spec.delimiter = '|';
+    std::ostringstream warnings;
+    Diagnostics diagnostics(warnings);
+    const auto sales = parse_sales_rows(parse_csv_content(generate_sales(spec), '|'),
+                                        diagnostics);
+    const auto inventory = parse_inventory_rows(
+        parse_csv_content(generate_inventory(spec), '|'), diagnostics);
+    EXPECT_EQ(sales.size(), 20000u);
+    EXPECT_FALSE(inventory.empty());
+    EXPECT_EQ(diagnostics.total(), 0u);
+    EXPECT_EQ(sales[0].order_id, "O0000000000");
+    EXPECT_EQ(sales[0].product_id.size(), 6u);   // "P" and five digits
+}
+
+TEST(DataGenerator, MalformedRowsAtTheRequestedRate) {
+    DataSpec spec = small_spec();
+    spec.malformed = 0.05;
+    std::ostringstream warnings;
+    Diagnostics diagnostics(warnings, DiagnosticsLimits{0, 0.0});
+    const auto sales = parse_sales_rows(parse_csv_content(generate_sales(spec), ','),
+                                        diagnostics);
+
+    EXPECT_EQ(sales.size() + diagnostics.total(), 20000u);
+    EXPECT_GT(diagnostics.total(), 800u);
+    EXPECT_LT(diagnostics.total(), 1200u);
+    EXPECT_GT(diagnostics.count(RowProblem::insufficient_columns), 0u);
+    EXPECT_GT(diagnostics.count(RowProblem::invalid_amount), 0u);
+
+    Diagnostics inventory_diagnostics(warnings, DiagnosticsLimits{0, 0.0});
+    spec.malformed = 0.5;
+    parse_inventory_rows(parse_csv_content(generate_inventory(spec), ','),
+                         inventory_diagnostics);
+    EXPECT_GT(inventory_diagnostics.count(RowProblem::invalid_stock_qty), 0u);
+    EXPECT_GT(inventory_diagnostics.count(RowProblem::insufficient_columns), 0u);
+}
+
+TEST(DataGenerator, ZipfSkewConcentratesSales) {
+    // Share of the sales that go to the ten best-selling products
+    auto top_ten_share = [](double zipf) {
+        DataSpec spec = small_spec();
+        spec.zipf = zipf;
+        std::ostringstream warnings;
+        const auto sales = parse_sales_rows(parse_csv_content(generate_sales(spec), ','),
+                                            warnings);
+        std::map<std::string, int> counts;
+        for (const auto& row : sales) {
+            ++counts[row.product_id];
+        }
+        std::vector<int> sorted;
+        for (const auto& entry : counts) {
+            sorted.push_back(entry.second);
+        }
+        std::sort(sorted.rbegin(), sorted.rend());
+        int top = 0;
+        for (std::size_t i = 0; i < 10 && i < sorted.size(); ++i) {
+            top += sorted[i];
+        }
+        return static_cast<double>(top) / static_cast<double>(sales.size());
+    };
+
+    EXPECT_LT(top_ten_share(0.0), 0.05);
+    // For s = 1 over 1000 products, the top ten hold H(10) / H(1000), ~39%
+    EXPECT_NEAR(top_ten_share(1.0), 0.39, 0.03);
+}
+
+TEST(DataGenerator, InventoryHoldsTheRequestedShare) {
+    DataSpec spec = small_spec();
+    spec.in_inventory = 0.3;
+    std::ostringstream warnings;
+    const auto inventory = parse_inventory_rows(
+        parse_csv_content(generate_inventory(spec), ','), warnings);
+    EXPECT_GT(inventory.size(), 250u);
+    EXPECT_LT(inventory.size(), 350u);
+    EXPECT_TRUE(std::is_sorted(inventory.begin(), inventory.end(),
+                               [](const InventoryRecord& a, const InventoryRecord& b) {
+                                   return a.product_id < b.product_id;
+                               }));
+}
@@ -0,0 +1,242 @@
+// decompress_test.cpp
+//
+// Compressed inputs are recognized by their magic bytes; DecompressPipe
+// delivers gzip data (several blocks, several members) in order, reports
+// truncated data, and can be abandoned midway; so for zstd frames where
+// libzstd is available; read_csv_file and the block-wise
+// run_queries_stream read compressed sales like plain ones.
+
+#include <gtest/gtest.h>
+
+#include "decompress.h"
+#include "inventory_index.h"
+#include "reporter.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef CSV_REPORTER_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef CSV_REPORTER_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+TEST(DetectCompression, UsesMagicBytes) {
+    EXPECT_EQ(detect_compression("\x1f\x8b\x08"), Compression::gzip);
+    EXPECT_EQ(detect_compression(std::string("\x28\xb5\x2f\xfd\x00", 5)), Compression::zstd);
+    EXPECT_EQ(detect_compression("order_id,product_id,amount\n"), Compression::none);
+    EXPECT_EQ(detect_compression(""), Compression::none);
+    EXPECT_EQ(detect_compression("\x1f"), Compression::none);
+}
+
+TEST(DecompressPipe, PassesUncompressedDataThroughInBlocks) {
+    const std::string data(DecompressPipe::kBlockSize * 2 + 17, 'x');
+    DecompressPipe pipe(data, Compression::none);
+    std::string out;
+    std::string_view block;
+    while (pipe.next(block)) {
+        EXPECT_LE(block.size(), DecompressPipe::kBlockSize);
+        out.append(block);
+    }
+    EXPECT_EQ(out, data);
+    EXPECT_TRUE(pipe.error().empty());
+}
+
+#if defined(CSV_REPORTER_HAVE_ZLIB) || defined(CSV_REPORTER_HAVE_ZSTD)
+
+namespace {
+
+// Several MiB of sales rows, with every 1000th row malformed.
+std::string make_sales(int rows) {
+    std::string csv = "order_id,product_id,amount\n";
+    for (int i = 0; i < rows; ++i) {
+        csv += "O" + std::to_string(i) + ",P00" + std::to_string(i % 4) + ",";
+        csv += (i % 1000 == 999) ? "bad" : std::to_string(i % 5000) + ".25";
+        csv += (i % 7 == 0) ? "\r\n" : "\n";
+    }
+    return csv;
+}
+
+std::vector<InventoryRecord> make_inventory() {
+    return {{"P001", 1}, {"P002", 2}, {"P003", 3}};
+}
+
+}  // namespace
+
+#endif
+
+#ifdef CSV_REPORTER_HAVE_ZLIB
+
+namespace {
+
+std::string gzip(const std::string& data) {
+    z_stream zs{};
+    deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    std::string out(deflateBound(&zs, static_cast<uLong>(data.size())), '\0');
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    zs.avail_in = static_cast<uInt>(data.size());
+    zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    zs.avail_out = static_cast<uInt>(out.size());
+    deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return out;
+}
+
+}  // namespace
+
+TEST(DecompressPipe, GzipMembersAreDecompressedInOrder) {
+    const std::string first = make_sales(150000);
+    const std::string second = "O-last,P001,1\n";
+    const std::string compressed = gzip(first) + gzip(second);
+
+    std::string out;
+    std::string error;
+    ASSERT_TRUE(decompress_all(compressed, Compression::gzip, out, error)) << error;
+    EXPECT_GT(first.size(), 2 * DecompressPipe::kBlockSize);
+    EXPECT_EQ(out, first + second);
+}
+
+TEST(DecompressPipe, TruncatedOrCorruptGzipIsAnError) {
+    const std::string compressed = gzip(make_sales(10000));
+    std::string out;
+    std::string error;
+    EXPECT_FALSE(decompress_all(compressed.substr(0, compressed.size() / 2),
+                                Compression::gzip, out, error));
+    EXPECT_FALSE(error.empty());
+
+    std::string corrupt = compressed;
+    corrupt[20] ^= 0x55;
+    corrupt[21] ^= 0x55;
+    error.clear();
+    EXPECT_FALSE(decompress_all(corrupt, Compression::gzip, out, error));
+    EXPECT_FALSE(error.empty());
+}
+
+TEST(DecompressPipe, CanBeAbandonedMidway) {
+    const std::string compressed = gzip(make_sales(300000));
+    DecompressPipe pipe(compressed, Compression::gzip);
+    std::string_view block;
+    ASSERT_TRUE(pipe.next(block));
+    EXPECT_EQ(block.size(), DecompressPipe::kBlockSize);
+    // The destructor stops the worker, which is blocked on a full ring.
+}
+
+TEST(ReadCsvFile, GzipFileIsDecompressed) {
+    const std::string path = "read_csv_file_test.csv.gz";
+    const std::string csv = make_sales(1000);
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << gzip(csv);
+    }
+
+    auto result = read_csv_file(path, "SALES_FILE");
+    ASSERT_TRUE(result.success) << result.value;
+    EXPECT_EQ(result.compression, Compression::gzip);
+    EXPECT_EQ(result.file.view(), csv);
+
+    auto raw = read_csv_file(path, "SALES_FILE", false);
+    ASSERT_TRUE(raw.success);
+    EXPECT_EQ(raw.file.view(), gzip(csv));
+
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << gzip(csv).substr(0, 100);
+    }
+    auto truncated = read_csv_file(path, "SALES_FILE");
+    EXPECT_FALSE(truncated.success);
+    EXPECT_NE(truncated.value.find("[ERROR] Cannot decompress SALES_FILE"), std::string::npos);
+    std::remove(path.c_str());
+}
+
+TEST(RunQueriesStream, CompressedBlocksMatchWholeContent) {
+    const std::vector<Query> queries = {
+        {"big", 1000.0, "json", ""},
+        {"all", 0.0,    "json", "product_id"},
+    };
+    const std::string csv = make_sales(200000);
+    const InventoryIndex inventory(make_inventory());
+
+    std::ostringstream expected_warnings;
+    const auto expected = run_queries_stream(csv, ',', inventory, queries, expected_warnings);
+
+    const std::string compressed = gzip(csv);
+    DecompressPipe pipe(compressed, Compression::gzip);
+    std::ostringstream warnings;
+    const auto actual = run_queries_stream(pipe, ',', inventory, queries, warnings);
+    EXPECT_TRUE(pipe.error().empty());
+
+    ASSERT_EQ(actual.size(), expected.size());
+    EXPECT_EQ(format_json(actual[0].summary), format_json(expected[0].summary));
+    EXPECT_EQ(format_json(actual[1].groups), format_json(expected[1].groups));
+    EXPECT_EQ(warnings.str(), expected_warnings.str());
+}
+
+#endif  // CSV_REPORTER_HAVE_ZLIB
+
+#ifdef CSV_REPORTER_HAVE_ZSTD
+
+namespace {
+
+std::string zstd(const std::string& data) {
+    std::string out(ZSTD_compressBound(data.size()), '\0');
+    out.resize(ZSTD_compress(&out[0], out.size(), data.data(), data.size(), 3));
+    return out;
+}
+
+}  // namespace
+
+TEST(DecompressPipe, ZstdFramesAreDecompressedInOrder) {
+    const std::string first = make_sales(150000);
+    const std::string second = "O-last,P001,1\n";
+    std::string out;
+    std::string error;
+    ASSERT_TRUE(decompress_all(zstd(first) + zstd(second), Compression::zstd, out, error))
+        << error;
+    EXPECT_EQ(out, first + second);
+
+    const std::string compressed = zstd(first);
+    error.clear();
+    EXPECT_FALSE(decompress_all(compressed.substr(0, compressed.size() / 2),
+                                Compression::zstd, out, error));
+    EXPECT_FALSE(error.empty());
+}
+
+TEST(RunQueriesStream, ZstdBlocksMatchWholeContent) {
+    const std::vector<Query> queries = {
+        {"big", 1000.0, "json", ""},
+        {"all", 0.0,    "json", "product_id"},
+    };
+    const std::string csv = make_sales(200000);
+    const InventoryIndex inventory(make_inventory());
+    std::ostringstream expected_warnings;
+    const auto expected = run_queries_stream(csv, ',', inventory, queries, expected_warnings);
+
+    const std::string compressed = zstd(csv);
+    DecompressPipe pipe(compressed, Compression::zstd);
+    std::ostringstream warnings;
+    const auto actual = run_queries_stream(pipe, ',', inventory, queries, warnings);
+    EXPECT_TRUE(pipe.error().empty()) << pipe.error();
+    ASSERT_EQ(actual.size(), expected.size());
+    EXPECT_EQ(format_json(actual[0].summary), format_json(expected[0].summary));
+    EXPECT_EQ(format_json(actual[1].groups), format_json(expected[1].groups));
+    EXPECT_EQ(warnings.str(), expected_warnings.str());
+}
+
+#else
+TEST(ReadCsvFile, UnsupportedCompressionIsAnError) {
+    const std::string path = "read_csv_file_test.csv.zst";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << std::string("\x28\xb5\x2f\xfd\x00\x00", 6);
+    }
+    auto result = read_csv_file(path, "SALES_FILE");
+    EXPECT_FALSE(result.success);
+    EXPECT_NE(result.value.find("zstd"), std::string::npos);
+    std::remove(path.c_str());
+}
+#endif
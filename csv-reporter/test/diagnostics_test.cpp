@@ -0,0 +1,142 @@
+// diagnostics_test.cpp
+//
+// Skipped rows are counted by kind whatever the limits; only the first
+// max_samples are written, no faster than max_per_second (but at least one
+// even below one a second), and a row's line number is only worked out when
+// it is written or recorded; finish() sums up the unshown rows in one line,
+// and json() reports the counts.
+
+#include <gtest/gtest.h>
+
+#include "diagnostics.h"
+#include "reporter.h"
+#include "csv_parser.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::size_t count_lines(const std::string& text, const std::string& prefix) {
+    std::size_t n = 0;
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line)) {
+        n += line.rfind(prefix, 0) == 0 ? 1 : 0;
+    }
+    return n;
+}
+
+}  // namespace
+
+TEST(Diagnostics, WithoutLimitsEveryRowIsWritten) {
+    std::ostringstream out;
+    Diagnostics diagnostics(out);
+    diagnostics.skip_row(RowProblem::invalid_amount, [] { return 3; });
+    diagnostics.skip_row(RowProblem::insufficient_columns, [] { return 7; });
+    diagnostics.finish();
+
+    EXPECT_EQ(out.str(),
+              "[WARN] Skipping malformed row at line 3: invalid amount value\n"
+              "[WARN] Skipping malformed row at line 7: insufficient columns\n");
+    EXPECT_EQ(diagnostics.total(), 2u);
+    EXPECT_EQ(diagnostics.shown(), 2u);
+}
+
+TEST(Diagnostics, SampleLimitCountsTheRestAndSumsThemUp) {
+    std::ostringstream out;
+    Diagnostics diagnostics(out, DiagnosticsLimits{2, 0.0}, "SALES_FILE");
+    int lines_worked_out = 0;
+    for (int i = 0; i < 10; ++i) {
+        const RowProblem problem =
+            i < 7 ? RowProblem::invalid_amount : RowProblem::insufficient_columns;
+        diagnostics.skip_row(problem, [&] { ++lines_worked_out; return i + 2; });
+    }
+
+    EXPECT_EQ(lines_worked_out, 2);
+    EXPECT_EQ(diagnostics.count(RowProblem::invalid_amount), 7u);
+    EXPECT_EQ(diagnostics.count(RowProblem::insufficient_columns), 3u);
+    EXPECT_EQ(diagnostics.count(RowProblem::invalid_stock_qty), 0u);
+    EXPECT_EQ(diagnostics.shown(), 2u);
+
+    diagnostics.finish();
+    EXPECT_EQ(count_lines(out.str(), "[WARN] Skipping malformed row"), 2u);
+    EXPECT_NE(out.str().find("[WARN] SALES_FILE: 10 malformed rows skipped "
+                             "(3 insufficient columns, 7 invalid amount value); 2 shown\n"),
+              std::string::npos);
+}
+
+TEST(Diagnostics, RateLimitHoldsOneSecondOfWarnings) {
+    std::ostringstream out;
+    Diagnostics diagnostics(out, DiagnosticsLimits{DiagnosticsLimits{}.max_samples, 2.0});
+    for (int i = 0; i < 10; ++i) {
+        diagnostics.skip_row(RowProblem::invalid_stock_qty, [&] { return i; });
+    }
+
+    // Ten rows in well under half a second: only the initial burst shows
+    EXPECT_EQ(diagnostics.shown(), 2u);
+    EXPECT_EQ(diagnostics.total(), 10u);
+}
+
+TEST(Diagnostics, RateBelowOnePerSecondStillWrites) {
+    std::ostringstream out;
+    Diagnostics diagnostics(out, DiagnosticsLimits{DiagnosticsLimits{}.max_samples, 0.5});
+    for (int i = 0; i < 10; ++i) {
+        diagnostics.skip_row(RowProblem::invalid_stock_qty, [&] { return i; });
+    }
+
+    // WARN_RATE=0.5 writes one warning now and the next two seconds later
+    EXPECT_EQ(diagnostics.shown(), 1u);
+    EXPECT_EQ(diagnostics.total(), 10u);
+    EXPECT_EQ(count_lines(out.str(), "[WARN] Skipping malformed row"), 1u);
+}
+
+TEST(Diagnostics, RecordKeepsEveryRowEvenWhenUnshown) {
+    std::ostringstream out;
+    Diagnostics diagnostics(out, DiagnosticsLimits{0, 0.0});
+    std::vector<RowIssue> issues;
+    diagnostics.record(&issues);
+    diagnostics.skip_row(RowProblem::invalid_amount, [] { return 4; });
+    diagnostics.record(nullptr);
+    diagnostics.skip_row(RowProblem::invalid_amount, [] { return 5; });
+
+    ASSERT_EQ(issues.size(), 1u);
+    EXPECT_EQ(issues[0].problem, RowProblem::invalid_amount);
+    EXPECT_EQ(issues[0].line, 4);
+    EXPECT_TRUE(out.str().empty());
+}
+
+TEST(Diagnostics, JsonReportsCountsByKind) {
+    std::ostringstream out;
+    Diagnostics diagnostics(out, DiagnosticsLimits{1, 0.0}, "INVENTORY_FILE");
+    diagnostics.skip_row(RowProblem::invalid_stock_qty, [] { return 2; });
+    diagnostics.skip_row(RowProblem::invalid_stock_qty, [] { return 3; });
+
+    EXPECT_EQ(diagnostics.json(),
+              "{\"source\": \"INVENTORY_FILE\", \"skipped\": 2, \"shown\": 1, "
+              "\"insufficient_columns\": 0, \"invalid_amount\": 0, \"invalid_stock_qty\": 2}");
+}
+
+TEST(Diagnostics, ParsersReportLinesOfSampledRows) {
+    const std::string sales =
+        "order_id,product_id,amount\n"
+        "O1,P1,x\n"
+        "O2,P2\n"
+        "\n"
+        "O3,P3,z\n"
+        "O4,P4,y\n";
+    std::ostringstream out;
+    Diagnostics diagnostics(out, DiagnosticsLimits{2, 0.0}, "SALES_FILE");
+    std::vector<RowIssue> issues;
+    diagnostics.record(&issues);
+    parse_sales_rows(parse_csv_content(sales, ','), diagnostics);
+
+    ASSERT_EQ(issues.size(), 4u);
+    EXPECT_EQ(issues[0].line, 2);
+    EXPECT_EQ(issues[1].line, 3);
+    EXPECT_EQ(issues[1].problem, RowProblem::insufficient_columns);
+    EXPECT_EQ(issues[2].line, 5);
+    EXPECT_EQ(issues[3].line, 6);
+    EXPECT_EQ(count_lines(out.str(), "[WARN] Skipping malformed row"), 2u);
+}
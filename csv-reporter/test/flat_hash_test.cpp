@@ -0,0 +1,135 @@
+// flat_hash_test.cpp
+//
+// FlatStringMap behaves like a std::unordered_map through many rehashes and
+// after a serialize/attach round trip, rejects malformed bytes -- also
+// slots whose long key lies outside the arena or whose value is out of
+// range -- and
+// BlockedBloomFilter has no false negatives and a low false positive rate.
+
+#include <gtest/gtest.h>
+
+#include "flat_hash.h"
+
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+TEST(FlatStringMap, MatchesUnorderedMapThroughGrowth) {
+    std::vector<std::string> keys;
+    for (int i = 0; i < 100000; ++i) {
+        keys.push_back("P" + std::to_string(i * 7919));
+    }
+    keys.push_back("");
+    keys.push_back(std::string(40, 'k'));  // longer than one hash step
+
+    FlatStringMap map;
+    std::unordered_map<std::string, std::uint32_t> reference;
+    for (std::uint32_t i = 0; i < keys.size(); ++i) {
+        const auto [value, inserted] = map.insert(keys[i], i);
+        const bool reference_inserted = reference.emplace(keys[i], i).second;
+        ASSERT_EQ(inserted, reference_inserted) << keys[i];
+        ASSERT_EQ(value, reference.at(keys[i])) << keys[i];
+    }
+    // Inserting an existing key keeps its original value
+    EXPECT_EQ(map.insert(keys[5], 12345u).first, 5u);
+
+    EXPECT_EQ(map.size(), reference.size());
+    for (const auto& [key, value] : reference) {
+        ASSERT_EQ(map.find(key), value) << key;
+    }
+    EXPECT_EQ(map.find("missing"), FlatStringMap::kNotFound);
+    EXPECT_EQ(map.find("P1"),      FlatStringMap::kNotFound);
+}
+
+TEST(FlatStringMap, AttachedCopyFindsEveryKey) {
+    FlatStringMap map;
+    std::vector<std::string> keys = {"", "P1", std::string(16, 'a'), std::string(40, 'k')};
+    for (int i = 0; i < 5000; ++i) {
+        keys.push_back("P" + std::to_string(i * 31));
+    }
+    for (std::uint32_t i = 0; i < keys.size(); ++i) {
+        map.insert(keys[i], i);
+    }
+
+    std::string bytes;
+    map.serialize(bytes);
+    std::vector<std::uint64_t> aligned((bytes.size() + 7) / 8);
+    std::memcpy(aligned.data(), bytes.data(), bytes.size());
+    const std::string_view view(reinterpret_cast<const char*>(aligned.data()), bytes.size());
+
+    FlatStringMap attached;
+    ASSERT_TRUE(attached.attach(view));
+    EXPECT_EQ(attached.size(), map.size());
+    for (std::uint32_t i = 0; i < keys.size(); ++i) {
+        ASSERT_EQ(attached.find(keys[i]), i) << keys[i];
+    }
+    EXPECT_EQ(attached.find("missing"), FlatStringMap::kNotFound);
+    EXPECT_EQ(attached.find(std::string(40, 'j')), FlatStringMap::kNotFound);
+
+    // Truncated or foreign bytes are rejected and leave the map as it was.
+    EXPECT_FALSE(attached.attach(view.substr(0, view.size() - 1)));
+    EXPECT_FALSE(attached.attach(view.substr(0, 8)));
+    EXPECT_EQ(attached.find("P31"), 5u);
+}
+
+TEST(FlatStringMap, AttachRejectsDamagedSlots) {
+    FlatStringMap map;
+    map.insert("P1", 0);
+    map.insert(std::string(40, 'k'), 1);
+    std::string bytes;
+    map.serialize(bytes);
+
+    // Header: magic, groups, size, key_bytes; then the tags and the 32-byte
+    // slots (hash, size, value, key bytes or arena offset).
+    std::uint64_t groups = 0;
+    std::memcpy(&groups, bytes.data() + 8, sizeof(groups));
+    const std::size_t tags_at = 32;
+    const std::size_t slots_at = tags_at + groups * 16;
+    std::size_t long_slot = 0;
+    for (std::size_t i = 0; i < groups * 16; ++i) {
+        std::uint32_t size = 0;
+        std::memcpy(&size, bytes.data() + slots_at + i * 32 + 8, sizeof(size));
+        if (static_cast<unsigned char>(bytes[tags_at + i]) != 0x80 && size == 40) {
+            long_slot = slots_at + i * 32;
+        }
+    }
+    ASSERT_NE(long_slot, 0u);
+
+    auto attaches = [](const std::string& damaged, std::uint32_t value_limit) {
+        std::vector<std::uint64_t> aligned((damaged.size() + 7) / 8);
+        std::memcpy(aligned.data(), damaged.data(), damaged.size());
+        FlatStringMap attached;
+        return attached.attach(
+            std::string_view(reinterpret_cast<const char*>(aligned.data()), damaged.size()),
+            value_limit);
+    };
+    EXPECT_TRUE(attaches(bytes, 2));
+    EXPECT_FALSE(attaches(bytes, 1));   // value 1 is out of range
+
+    std::string damaged = bytes;
+    const std::uint64_t offset = 1;     // 1 + 40 > the 40 arena bytes
+    std::memcpy(&damaged[long_slot + 16], &offset, sizeof(offset));
+    EXPECT_FALSE(attaches(damaged, 2));
+
+    damaged = bytes;
+    damaged[long_slot] = static_cast<char>(damaged[long_slot] ^ 1);   // hash and tag disagree
+    EXPECT_FALSE(attaches(damaged, 2));
+}
+
+TEST(BlockedBloomFilter, NoFalseNegativesAndFewFalsePositives) {
+    const std::size_t n = 100000;
+    BlockedBloomFilter bloom(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        bloom.insert(hash_key("in-" + std::to_string(i)));
+    }
+
+    for (std::size_t i = 0; i < n; ++i) {
+        ASSERT_TRUE(bloom.maybe_contains(hash_key("in-" + std::to_string(i))));
+    }
+    std::size_t false_positives = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        false_positives += bloom.maybe_contains(hash_key("out-" + std::to_string(i))) ? 1 : 0;
+    }
+    EXPECT_LT(false_positives, n / 100);
+}
@@ -0,0 +1,126 @@
+// inventory_index_test.cpp
+//
+// InventoryIndex answers like the inventory list it was built from, a saved
+// index loads back with the same answers, and an index saved for another
+// stamp (size, mtime, content hash or delimiter) or a damaged file is
+// rejected.
+
+#include <gtest/gtest.h>
+
+#include "csv_parser.h"
+#include "inventory_index.h"
+#include "reporter.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<InventoryRecord> make_inventory() {
+    std::vector<InventoryRecord> inventory;
+    for (int i = 0; i < 1000; ++i) {
+        inventory.push_back({"P" + std::to_string(i * 2), i});
+    }
+    inventory.push_back({"LONG-PRODUCT-IDENTIFIER-0001", 1});
+    return inventory;
+}
+
+FileStamp make_stamp() {
+    FileStamp stamp;
+    stamp.size = 1234;
+    stamp.mtime = 5678;
+    stamp.hash = hash_key("inventory");
+    stamp.delimiter = ',';
+    return stamp;
+}
+
+}  // namespace
+
+TEST(InventoryIndex, SavedIndexLoadsWithSameAnswers) {
+    const std::string path = "inventory_index_test.idx";
+    const auto stamp = make_stamp();
+    {
+        const InventoryIndex built(make_inventory());
+        ASSERT_TRUE(built.save(path, stamp));
+    }
+
+    InventoryIndex loaded;
+    ASSERT_TRUE(loaded.load(path, stamp));
+    EXPECT_EQ(loaded.size(), 1001u);
+    for (int i = 0; i < 2000; ++i) {
+        EXPECT_EQ(loaded.contains("P" + std::to_string(i)), i % 2 == 0) << i;
+    }
+    EXPECT_TRUE(loaded.contains("LONG-PRODUCT-IDENTIFIER-0001"));
+    EXPECT_FALSE(loaded.contains("LONG-PRODUCT-IDENTIFIER-0002"));
+
+    // The mapping moves with the index.
+    InventoryIndex moved(std::move(loaded));
+    EXPECT_TRUE(moved.contains("P10"));
+    std::remove(path.c_str());
+}
+
+TEST(InventoryIndex, RejectsStaleOrDamagedIndex) {
+    const std::string path = "inventory_index_stale_test.idx";
+    const auto stamp = make_stamp();
+    ASSERT_TRUE(InventoryIndex(make_inventory()).save(path, stamp));
+
+    InventoryIndex index;
+    auto changed = stamp;
+    changed.size += 1;
+    EXPECT_FALSE(index.load(path, changed));
+    changed = stamp;
+    changed.mtime += 1;
+    EXPECT_FALSE(index.load(path, changed));
+    changed = stamp;
+    changed.hash ^= 1;
+    EXPECT_FALSE(index.load(path, changed));
+    changed = stamp;
+    changed.delimiter = ';';
+    EXPECT_FALSE(index.load(path, changed));
+    EXPECT_EQ(index.size(), 0u);
+
+    // Truncated file
+    std::string bytes;
+    {
+        std::ifstream in(path, std::ios::binary);
+        std::ostringstream ss;
+        ss << in.rdbuf();
+        bytes = ss.str();
+    }
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size() - 16));
+    }
+    EXPECT_FALSE(index.load(path, stamp));
+    EXPECT_FALSE(index.load("no_such_inventory.idx", stamp));
+    std::remove(path.c_str());
+}
+
+TEST(InventoryIndex, StampFollowsContentAndDelimiter) {
+    const auto a = stamp_file("no_such_file.csv", "product_id,stock_qty\nP1,1\n", ',');
+    const auto b = stamp_file("no_such_file.csv", "product_id,stock_qty\nP1,2\n", ',');
+    const auto c = stamp_file("no_such_file.csv", "product_id,stock_qty\nP1,1\n", ';');
+    EXPECT_EQ(a.size, b.size);
+    EXPECT_NE(a.hash, b.hash);
+    EXPECT_NE(a.delimiter, c.delimiter);
+}
+
+TEST(InventoryIndex, JoinMatchesInventoryListJoin) {
+    const std::string sales_csv =
+        "order_id,product_id,amount\n"
+        "O1,P2,10\n"
+        "O2,P3,20\n"
+        "O3,LONG-PRODUCT-IDENTIFIER-0001,30\n"
+        "O4,P2,40\n"
+        "O5,P999999,50\n";
+    std::ostringstream devnull;
+    const auto sales = parse_sales_batch(parse_csv_content(sales_csv, ','), devnull);
+    const auto inventory = make_inventory();
+
+    const InventoryIndex index(inventory);
+    EXPECT_EQ(join_with_inventory(sales, index), join_with_inventory(sales, inventory));
+    EXPECT_EQ(join_with_inventory(sales, index), Selection{0b01101});
+}
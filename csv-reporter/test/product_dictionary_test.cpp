@@ -0,0 +1,81 @@
+// product_dictionary_test.cpp
+//
+// ProductDictionary assigns dense codes in first-seen order, returns the same
+// code for repeated IDs, keeps the interned bytes valid as it grows, and
+// answers the same once serialized and attached again.
+
+#include <gtest/gtest.h>
+
+#include "product_dictionary.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+TEST(ProductDictionary, CodesAreDenseInFirstSeenOrder) {
+    ProductDictionary dict;
+
+    EXPECT_EQ(dict.intern("P002"), 0u);
+    EXPECT_EQ(dict.intern("P001"), 1u);
+    EXPECT_EQ(dict.intern("P002"), 0u);
+    EXPECT_EQ(dict.intern(""),     2u);
+
+    EXPECT_EQ(dict.size(), 3u);
+    EXPECT_EQ(dict.name(0), "P002");
+    EXPECT_EQ(dict.name(1), "P001");
+    EXPECT_EQ(dict.find("P001"), 1u);
+    EXPECT_EQ(dict.find("P999"), ProductDictionary::kNotFound);
+}
+
+TEST(ProductDictionary, NamesStayValidAcrossGrowthAndMove) {
+    ProductDictionary dict;
+    std::vector<std::string> ids;
+    for (int i = 0; i < 50000; ++i) {
+        ids.push_back("SKU-" + std::to_string(i));
+    }
+    ids.push_back(std::string(100000, 'x'));  // longer than an arena block
+
+    for (const auto& id : ids) {
+        dict.intern(id);
+    }
+    const ProductDictionary moved = std::move(dict);
+
+    ASSERT_EQ(moved.size(), ids.size());
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        ASSERT_EQ(moved.name(static_cast<std::uint32_t>(i)), ids[i]);
+        ASSERT_EQ(moved.find(ids[i]), i);
+    }
+}
+
+TEST(ProductDictionary, AttachedDictionaryAnswersLikeTheOriginal) {
+    ProductDictionary dict;
+    for (int i = 0; i < 500; ++i) {
+        dict.intern("P" + std::to_string(i * 7));
+    }
+    dict.intern("A-PRODUCT-ID-LONGER-THAN-SIXTEEN-BYTES");
+    dict.intern("");
+
+    std::string bytes;
+    dict.serialize(bytes);
+    std::vector<std::uint64_t> aligned((bytes.size() + 7) / 8);
+    std::memcpy(aligned.data(), bytes.data(), bytes.size());
+    const std::string_view view(reinterpret_cast<const char*>(aligned.data()), bytes.size());
+
+    ProductDictionary attached;
+    ASSERT_TRUE(attached.attach(view));
+    ASSERT_EQ(attached.size(), dict.size());
+    for (std::uint32_t code = 0; code < dict.size(); ++code) {
+        EXPECT_EQ(attached.name(code), dict.name(code));
+        EXPECT_EQ(attached.find(dict.name(code)), code);
+    }
+    EXPECT_EQ(attached.find("P1"), ProductDictionary::kNotFound);
+
+    ProductDictionary damaged;
+    damaged.intern("P1");
+    EXPECT_FALSE(damaged.attach(view.substr(0, view.size() - 8)));
+    EXPECT_EQ(damaged.size(), 1u);
+    EXPECT_EQ(damaged.find("P1"), 0u);
+}
@@ -0,0 +1,261 @@
+// report_server_test.cpp
+//
+// ReportServer answers with what csv_reporter would print, follows rows
+// appended to SALES_FILE and changes to INVENTORY_FILE on refresh, refuses
+// a compressed SALES_FILE, rejects unknown query names, and serves
+// requests over its Unix domain socket without a stalled client holding up
+// the others, with reports that follow rows appended while it runs; it
+// replaces a stale socket but nothing else.
+
+#include <gtest/gtest.h>
+
+#include "config.h"
+#include "report_server.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+void write_file(const std::string& path, const std::string& content) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << content;
+}
+
+Config make_config(const std::string& prefix) {
+    Config config;
+    config.sales_file = prefix + "_sales.csv";
+    config.inventory_file = prefix + "_inventory.csv";
+    config.min_amount = 1000.0;
+    write_file(config.sales_file,
+               "order_id,product_id,amount\n"
+               "O001,P001,1500\n"
+               "O002,P002,800\n");
+    write_file(config.inventory_file,
+               "product_id,stock_qty\n"
+               "P001,100\n"
+               "P002,200\n");
+    return config;
+}
+
+void remove_files(const Config& config) {
+    std::remove(config.sales_file.c_str());
+    std::remove(config.inventory_file.c_str());
+}
+
+}  // namespace
+
+TEST(ReportServer, FollowsAppendedSalesAndInventoryChanges) {
+    const Config config = make_config("report_server_test");
+    ReportServer server(config);
+    std::ostringstream log;
+
+    EXPECT_EQ(server.handle_request(""), "[ERROR] No report is available yet\n");
+    ASSERT_TRUE(server.refresh(log));
+    EXPECT_EQ(server.handle_request(""),
+              "{\"count\": 1, \"total\": 1500.00, \"average\": 1500.00}\n");
+
+    {
+        std::ofstream out(config.sales_file, std::ios::binary | std::ios::app);
+        out << "O003,P002,2500\nO004,P003,9000\nO005,P001,1";   // last line unfinished
+    }
+    ASSERT_TRUE(server.refresh(log));
+    EXPECT_EQ(server.handle_request("\r\n"),
+              "{\"count\": 2, \"total\": 4000.00, \"average\": 2000.00}\n");
+
+    write_file(config.inventory_file, "product_id,stock_qty\nP001,1\nP002,2\nP003,3\n");
+    ASSERT_TRUE(server.refresh(log));
+    EXPECT_EQ(server.handle_request(""),
+              "{\"count\": 3, \"total\": 13000.00, \"average\": 4333.33}\n");
+    EXPECT_TRUE(log.str().empty()) << log.str();
+
+    EXPECT_EQ(server.handle_request("weekly"), "[ERROR] Unknown query: 'weekly'\n");
+
+    // A compressed sales file is refused, keeping the last reports
+    write_file(config.sales_file, std::string("\x1f\x8b\x08\x00", 4));
+    std::ostringstream compressed_log;
+    EXPECT_FALSE(server.refresh(compressed_log));
+    EXPECT_NE(compressed_log.str().find("[ERROR] --serve needs an uncompressed SALES_FILE"),
+              std::string::npos);
+    EXPECT_EQ(server.handle_request(""),
+              "{\"count\": 3, \"total\": 13000.00, \"average\": 4333.33}\n");
+
+    // Missing files keep the last reports
+    remove_files(config);
+    EXPECT_FALSE(server.refresh(log));
+    EXPECT_NE(log.str().find("[ERROR]"), std::string::npos);
+    EXPECT_EQ(server.handle_request(""),
+              "{\"count\": 3, \"total\": 13000.00, \"average\": 4333.33}\n");
+}
+
+TEST(ReportServer, NamedQueriesAreServedOneByOneOrTogether) {
+    Config config = make_config("report_server_named_test");
+    config.queries = {
+        {"big", 1000.0, "json", ""},
+        {"all", 0.0,    "csv",  ""},
+    };
+    ReportServer server(config);
+    std::ostringstream log;
+    ASSERT_TRUE(server.refresh(log));
+
+    const std::string big = "{\"count\": 1, \"total\": 1500.00, \"average\": 1500.00}\n";
+    const std::string all = "count,total,average\n2,2300.00,1150.00\n";
+    EXPECT_EQ(server.handle_request("big"), big);
+    EXPECT_EQ(server.handle_request("all"), all);
+    EXPECT_EQ(server.handle_request(""), "# big\n" + big + "# all\n" + all);
+    remove_files(config);
+}
+
+#ifndef _WIN32
+namespace {
+
+// Connects to socket_path, retrying until a server listens there.
+// Returns -1 if none does within five seconds.
+int connect_to(const std::string& socket_path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_path.c_str());
+    for (int attempt = 0; attempt < 500; ++attempt) {
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0) {
+            return fd;
+        }
+        ::close(fd);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return -1;
+}
+
+// Sends request and reads the reply until the server closes the
+// connection.
+std::string ask(int fd, const std::string& request) {
+    if (::send(fd, request.data(), request.size(), 0) != static_cast<ssize_t>(request.size())) {
+        ::close(fd);
+        return "send failed";
+    }
+    std::string reply;
+    char buf[256];
+    ssize_t n = 0;
+    while ((n = ::recv(fd, buf, sizeof(buf), 0)) > 0) {
+        reply.append(buf, static_cast<std::size_t>(n));
+    }
+    ::close(fd);
+    return reply;
+}
+
+}  // namespace
+
+TEST(ReportServer, AnswersOverUnixSocket) {
+    const Config config = make_config("report_server_socket_test");
+    const std::string socket_path = "report_server_test.sock";
+    ReportServer server(config);
+    std::ostringstream log;
+    ASSERT_TRUE(server.refresh(log));
+
+    bool served = false;
+    std::thread thread([&] { served = server.serve(socket_path, log); });
+    // A client that sends nothing, connected first, does not hold up the
+    // next one for the second after which it would be dropped.
+    const int stalled = connect_to(socket_path);
+    const int fd = connect_to(socket_path);
+    if (stalled < 0 || fd < 0) {
+        server.stop();
+        thread.join();
+        FAIL() << "could not connect: " << log.str();
+    }
+    const auto start = std::chrono::steady_clock::now();
+    const std::string reply = ask(fd, "\n");
+    const auto waited = std::chrono::steady_clock::now() - start;
+    ::close(stalled);
+
+    server.stop();
+    thread.join();
+    EXPECT_TRUE(served) << log.str();
+    EXPECT_EQ(reply, "{\"count\": 1, \"total\": 1500.00, \"average\": 1500.00}\n");
+    EXPECT_LT(waited, std::chrono::milliseconds(800));
+    remove_files(config);
+}
+
+TEST(ReportServer, ServedReportsFollowAppendedSales) {
+    const Config config = make_config("report_server_watch_test");
+    const std::string socket_path = "report_server_watch_test.sock";
+    ReportServer server(config);
+    std::ostringstream log;
+    ASSERT_TRUE(server.refresh(log));
+    std::thread thread([&] { server.serve(socket_path, log); });
+
+    const std::string before = "{\"count\": 1, \"total\": 1500.00, \"average\": 1500.00}\n";
+    const std::string after = "{\"count\": 2, \"total\": 4000.00, \"average\": 2000.00}\n";
+    const int fd = connect_to(socket_path);
+    const std::string first = fd >= 0 ? ask(fd, "\n") : "could not connect";
+    {
+        std::ofstream out(config.sales_file, std::ios::binary | std::ios::app);
+        out << "O003,P002,2500\n";
+    }
+    // Picked up by the file watch (or the once-a-second rescan)
+    std::string reply;
+    for (int attempt = 0; attempt < 500 && reply != after; ++attempt) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        const int next = connect_to(socket_path);
+        reply = next >= 0 ? ask(next, "\n") : "could not connect";
+    }
+
+    server.stop();
+    thread.join();
+    EXPECT_EQ(first, before);
+    EXPECT_EQ(reply, after) << log.str();
+    remove_files(config);
+}
+
+TEST(ReportServer, KeepsAnythingButAStaleSocket) {
+    const Config config = make_config("report_server_path_test");
+    const std::string socket_path = "report_server_path_test.sock";
+    std::ostringstream log;
+
+    // A regular file is left alone
+    write_file(socket_path, "keep me");
+    ReportServer server(config);
+    EXPECT_FALSE(server.serve(socket_path, log));
+    EXPECT_NE(log.str().find("[ERROR]"), std::string::npos);
+    {
+        std::ifstream in(socket_path);
+        std::string content;
+        std::getline(in, content);
+        EXPECT_EQ(content, "keep me");
+    }
+    std::remove(socket_path.c_str());
+
+    // A socket nobody listens on any more is replaced
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_path.c_str());
+    const int stale = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_EQ(::bind(stale, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)), 0);
+    ::close(stale);
+    ASSERT_TRUE(server.refresh(log));
+    std::thread thread([&] { server.serve(socket_path, log); });
+    const int fd = connect_to(socket_path);
+    ASSERT_GE(fd, 0);
+
+    // ... but one a server answers on is not
+    ReportServer second(config);
+    std::ostringstream second_log;
+    EXPECT_FALSE(second.serve(socket_path, second_log));
+    EXPECT_NE(second_log.str().find("in use"), std::string::npos);
+    EXPECT_EQ(ask(fd, "\n"), "{\"count\": 1, \"total\": 1500.00, \"average\": 1500.00}\n");
+
+    server.stop();
+    thread.join();
+    remove_files(config);
+}
+#endif
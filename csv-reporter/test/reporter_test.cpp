@@ -7,14 +7,37 @@
 //  AC-H4 – filter_by_amount with threshold above all amounts yields empty summary
 //  AC-H5 – format_csv_output produces correct CSV header + data row
 //  AC-H7 – join_with_inventory where no product_id matches → empty summary, no error
-//  AC-S2 – read_csv_file returns failure for a non-existent path
+//  AC-S2 – read_csv_file returns failure for a non-existent path, and maps
+//           existing files into a read-only view
 //  AC-S3 – parse_sales_rows skips rows with < 3 fields and warns with line number
+//  The columnar SalesBatch kernels select the same rows and give the same
+//  summary as the record-based join / filter / compute_summary
+//  parse_sales_batch with MIN_AMOUNT pushed down keeps exactly the rows that
+//  filter_by_amount would keep
+//  compute_product_summaries / summarize_sales_stream_by_product give one
+//  summary per product, the same to the bit for any thread count, also
+//  with Zipf-skewed hot products, and the grouped formatters print them
+//  run_queries / run_queries_stream give every query the result of a
+//  separate run
+//  summarize_sales_stream gives the same Summary and warnings as the batch
+//  pipeline
+//  run_queries_incremental reads only appended rows, matches a full scan,
+//  and falls back to one when the checkpoint no longer fits, also after an
+//  in-place edit; only an update of a trusted append-only file checks just
+//  the bytes before the offset, and its chained prefix hash equals a full
+//  rehash
 
 #include <gtest/gtest.h>
 
 #include "csv_parser.h"
+#include "data_generator.h"
+#include "inventory_index.h"
 #include "reporter.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <random>
 #include <sstream>
 #include <string>
 
@@ -307,3 +330,487 @@ TEST(FormatJson, AC_H7_NoMatchSummaryJsonHasCountZero) {
     EXPECT_NE(json.find("\"count\": 0"), std::string::npos);
     EXPECT_EQ(json.find("[ERROR]"), std::string::npos);
 }
+
+// ---------------------------------------------------------------------------
+// AC-S2  read_csv_file maps an existing file and exposes its content
+// ---------------------------------------------------------------------------
+
+TEST(ReadCsvFile, AC_S2_ExistingFileContentIsExposedAsView) {
+    const std::string path = "read_csv_file_test.csv";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << kSalesCsv;
+    }
+
+    auto result = read_csv_file(path, "SALES_FILE");
+
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(result.file.view(), kSalesCsv);
+
+    // The view can be parsed directly
+    std::ostringstream devnull;
+    auto sales = parse_sales_rows(parse_csv_content(result.file.view(), ','), devnull);
+    EXPECT_EQ(sales.size(), 4u);
+
+    std::remove(path.c_str());
+}
+
+TEST(ReadCsvFile, AC_S2_EmptyFileYieldsEmptyView) {
+    const std::string path = "read_csv_file_empty.csv";
+    { std::ofstream out(path); }
+
+    auto result = read_csv_file(path, "SALES_FILE");
+
+    ASSERT_TRUE(result.success);
+    EXPECT_TRUE(result.file.view().empty());
+
+    std::remove(path.c_str());
+}
+
+// ---------------------------------------------------------------------------
+// Streaming pipeline matches the batch pipeline
+// ---------------------------------------------------------------------------
+
+TEST(SummarizeSalesStream, MatchesBatchPipeline) {
+    const std::string content =
+        "order_id,product_id,amount\n"
+        "O001,P001,1500\n"
+        "\n"
+        "O002,P002\n"
+        "O003,P001,abc\r\n"
+        "O004,P999,5000\n"
+        "O005,P003,1200.5\n"
+        "O006,P002,999.99";
+    const auto inventory = make_inventory();
+
+    for (double min_amount : {0.0, 1000.0, 1e9}) {
+        std::ostringstream batch_warnings;
+        auto sales = parse_sales_rows(parse_csv_content(content, ','), batch_warnings);
+        auto batch = compute_summary(
+            filter_by_amount(join_with_inventory(sales, inventory), min_amount));
+
+        std::ostringstream stream_warnings;
+        auto stream = summarize_sales_stream(content, ',', inventory, min_amount,
+                                             stream_warnings);
+
+        EXPECT_EQ(stream.count, batch.count);
+        EXPECT_EQ(stream.total, batch.total);
+        EXPECT_EQ(stream.average, batch.average);
+        EXPECT_EQ(stream_warnings.str(), batch_warnings.str());
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Columnar batch matches the record-based pipeline
+// ---------------------------------------------------------------------------
+
+TEST(SalesBatch, ParseKeepsRowsAndWarningsOfParseSalesRows) {
+    const std::string content =
+        "order_id,product_id,amount\n"
+        "O001,P001,1500\n"
+        "O002,P002\n"
+        "O003,P001,abc\n"
+        "O004,P003,1200.5\n";
+    const auto table = parse_csv_content(content, ',');
+
+    std::ostringstream record_warnings;
+    const auto records = parse_sales_rows(table, record_warnings);
+    std::ostringstream batch_warnings;
+    const auto batch = parse_sales_batch(table, batch_warnings);
+
+    EXPECT_EQ(batch_warnings.str(), record_warnings.str());
+    ASSERT_EQ(batch.size(), records.size());
+    EXPECT_EQ(batch.products.size(), 2u);  // P001 is stored once
+    for (std::size_t i = 0; i < records.size(); ++i) {
+        EXPECT_EQ(batch.order_id(i),   records[i].order_id);
+        EXPECT_EQ(batch.product_id(i), records[i].product_id);
+        EXPECT_EQ(batch.amounts[i],    records[i].amount);
+    }
+}
+
+TEST(SalesBatch, KernelsMatchRecordPipelineOnRandomData) {
+    std::mt19937 rng(1234);
+    const auto inventory = make_inventory();  // P001..P003
+
+    // Sizes around the 64-row word and SIMD-register boundaries
+    for (std::size_t rows : {0u, 1u, 3u, 63u, 64u, 65u, 130u, 1001u}) {
+        std::string content = "order_id,product_id,amount\n";
+        for (std::size_t i = 0; i < rows; ++i) {
+            content += "O" + std::to_string(i) + ",P00" + std::to_string(rng() % 5) +
+                       "," + std::to_string(rng() % 300000 / 100.0) + "\n";
+        }
+        std::ostringstream devnull;
+        const auto table   = parse_csv_content(content, ',');
+        const auto records = parse_sales_rows(table, devnull);
+        const auto batch   = parse_sales_batch(table, devnull);
+
+        for (double min_amount : {0.0, 1000.0, 2999.99, 1e9}) {
+            const auto expected = compute_summary(filter_by_amount(
+                join_with_inventory(records, inventory), min_amount));
+
+            auto selection = join_with_inventory(batch, inventory);
+            filter_by_amount(batch, min_amount, selection);
+            const auto actual = compute_summary(batch, selection);
+
+            EXPECT_EQ(actual.count, expected.count) << rows << " rows";
+            EXPECT_EQ(actual.total, expected.total) << rows << " rows";
+            EXPECT_EQ(actual.average, expected.average) << rows << " rows";
+        }
+    }
+}
+
+TEST(SalesBatch, PushedDownMinAmountMatchesFilterByAmount) {
+    const std::string content =
+        "order_id,product_id,amount\n"
+        "O001,P001,1500\n"
+        "O002,P002\n"
+        "O003,P001,abc\n"
+        "O004,P003,999.99\n"
+        "O005,P002,1000\n"
+        "O006,P004,nan\n"
+        "O007,P004,2500\n";
+    const auto table     = parse_csv_content(content, ',');
+    const auto inventory = make_inventory();
+
+    for (double min_amount : {0.0, 1000.0, 1e9}) {
+        std::ostringstream full_warnings;
+        const auto full = parse_sales_batch(table, full_warnings);
+        auto expected_selection = join_with_inventory(full, inventory);
+        filter_by_amount(full, min_amount, expected_selection);
+        const auto expected = compute_summary(full, expected_selection);
+
+        std::ostringstream pushed_warnings;
+        const auto pushed = parse_sales_batch(table, pushed_warnings, min_amount);
+        for (std::size_t i = 0; i < pushed.size(); ++i) {
+            EXPECT_GE(pushed.amounts[i], min_amount);
+        }
+        const auto actual = compute_summary(pushed, join_with_inventory(pushed, inventory));
+
+        EXPECT_EQ(pushed_warnings.str(), full_warnings.str());
+        EXPECT_EQ(actual.count, expected.count);
+        EXPECT_EQ(actual.total, expected.total);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// OUTPUT_GROUP_BY=product_id
+// ---------------------------------------------------------------------------
+
+TEST(ProductSummaries, GroupsSelectedRowsByProduct) {
+    std::ostringstream devnull;
+    const auto batch = parse_sales_batch(parse_csv_content(kSalesCsv, ','), devnull);
+    auto selection = join_with_inventory(batch, make_inventory());
+    filter_by_amount(batch, 1000.0, selection);
+
+    const auto groups = compute_product_summaries(batch, selection);
+
+    // O001 + O003 for P001, O004 for P003; P002's only sale is below 1000
+    ASSERT_EQ(groups.size(), 2u);
+    EXPECT_EQ(groups[0].product_id, "P001");
+    EXPECT_EQ(groups[0].summary.count, 2);
+    EXPECT_DOUBLE_EQ(groups[0].summary.total, 3500.0);
+    EXPECT_DOUBLE_EQ(groups[0].summary.average, 1750.0);
+    EXPECT_EQ(groups[1].product_id, "P003");
+    EXPECT_EQ(groups[1].summary.count, 1);
+}
+
+TEST(ProductSummaries, ParallelAndStreamingMatchSequential) {
+    // Skewed: half of all rows are one hot product
+    std::mt19937 rng(77);
+    std::string content = "order_id,product_id,amount\n";
+    std::vector<InventoryRecord> inventory;
+    for (int p = 0; p < 500; ++p) {
+        inventory.push_back({"SKU" + std::to_string(p), 1});
+    }
+    for (int i = 0; i < 1100000; ++i) {
+        const int product = (rng() % 2) ? 0 : static_cast<int>(rng() % 600);
+        content += "O" + std::to_string(i) + ",SKU" + std::to_string(product) + "," +
+                   std::to_string(rng() % 100000 / 100.0) + "\n";
+    }
+
+    std::ostringstream devnull;
+    const auto batch = parse_sales_batch(parse_csv_content(content, ','), devnull, 10.0);
+    const auto selection = join_with_inventory(batch, inventory);
+
+    const auto sequential = compute_product_summaries(batch, selection, 1);
+    const auto streamed   = summarize_sales_stream_by_product(content, ',', inventory,
+                                                              10.0, devnull);
+    ASSERT_EQ(sequential.size(), 500u);
+    // Bit-identical totals for any thread count
+    for (unsigned threads : {2u, 3u, 4u, 7u}) {
+        const auto parallel = compute_product_summaries(batch, selection, threads);
+        ASSERT_EQ(parallel.size(), sequential.size());
+        for (std::size_t i = 0; i < sequential.size(); ++i) {
+            EXPECT_EQ(parallel[i].product_id,    sequential[i].product_id);
+            EXPECT_EQ(parallel[i].summary.count, sequential[i].summary.count);
+            EXPECT_EQ(parallel[i].summary.total, sequential[i].summary.total);
+        }
+    }
+    ASSERT_EQ(streamed.size(), sequential.size());
+    for (std::size_t i = 0; i < sequential.size(); ++i) {
+        EXPECT_EQ(streamed[i].product_id,    sequential[i].product_id);
+        EXPECT_EQ(streamed[i].summary.count, sequential[i].summary.count);
+        EXPECT_EQ(streamed[i].summary.total, sequential[i].summary.total);
+    }
+}
+
+TEST(ProductSummaries, ZipfHotProductsAreSplitAcrossThreadsExactly) {
+    // A few products take most of the rows; the hottest alone has many
+    // more of its own chunks than there are threads.
+    DataSpec spec;
+    spec.sales_rows = 1200000;
+    spec.products = 3000;
+    spec.zipf = 1.4;
+    spec.in_inventory = 1.0;
+    const std::string sales = generate_sales(spec);
+    const std::string inventory_csv = generate_inventory(spec);
+
+    std::ostringstream devnull;
+    const auto inventory = parse_inventory_rows(parse_csv_content(inventory_csv, ','), devnull);
+    const auto batch = parse_sales_batch(parse_csv_content(sales, ','), devnull, 0.0);
+    const auto selection = join_with_inventory(batch, inventory);
+
+    const auto sequential = compute_product_summaries(batch, selection, 1);
+    int hottest = 0;
+    for (const auto& p : sequential) {
+        hottest = std::max(hottest, p.summary.count);
+    }
+    ASSERT_GT(hottest, 200000);
+    for (unsigned threads : {2u, 5u, 8u}) {
+        const auto parallel = compute_product_summaries(batch, selection, threads);
+        ASSERT_EQ(parallel.size(), sequential.size());
+        for (std::size_t i = 0; i < sequential.size(); ++i) {
+            EXPECT_EQ(parallel[i].product_id,    sequential[i].product_id);
+            EXPECT_EQ(parallel[i].summary.count, sequential[i].summary.count);
+            EXPECT_EQ(parallel[i].summary.total, sequential[i].summary.total);
+        }
+    }
+    const auto streamed = summarize_sales_stream_by_product(sales, ',', inventory, 0.0, devnull);
+    ASSERT_EQ(streamed.size(), sequential.size());
+    for (std::size_t i = 0; i < sequential.size(); ++i) {
+        EXPECT_EQ(streamed[i].summary.total, sequential[i].summary.total);
+    }
+}
+
+TEST(FormatJson, GroupedOutputIsAnArrayOfProductObjects) {
+    const std::vector<ProductSummary> groups = {
+        {"P001", {2, 3500.0, 1750.0}},
+        {"P\"2", {1, 10.0, 10.0}},
+    };
+    EXPECT_EQ(format_json(groups),
+              "[{\"product_id\": \"P001\", \"count\": 2, \"total\": 3500.00, "
+              "\"average\": 1750.00}, {\"product_id\": \"P\\\"2\", \"count\": 1, "
+              "\"total\": 10.00, \"average\": 10.00}]");
+    EXPECT_EQ(format_json(std::vector<ProductSummary>{}), "[]");
+}
+
+TEST(FormatCsvOutput, GroupedOutputHasOneRowPerProduct) {
+    const std::vector<ProductSummary> groups = {
+        {"P001", {2, 3500.0, 1750.0}},
+        {"P,2",  {1, 10.0, 10.0}},
+    };
+    EXPECT_EQ(format_csv_output(groups),
+              "product_id,count,total,average\n"
+              "P001,2,3500.00,1750.00\n"
+              "\"P,2\",1,10.00,10.00\n");
+}
+
+// ---------------------------------------------------------------------------
+// QUERY_FILE: many reports from one scan
+// ---------------------------------------------------------------------------
+
+TEST(RunQueries, SharedScanMatchesSeparateRuns) {
+    const std::vector<Query> queries = {
+        {"north", 1000.0, "json", ""},
+        {"south", 2000.0, "csv",  ""},
+        {"all",   0.0,    "json", "product_id"},
+    };
+    const auto inventory = make_inventory();
+    std::ostringstream devnull;
+    const auto sales = parse_sales_batch(parse_csv_content(kSalesCsv, ','), devnull, 0.0);
+    const auto joined = join_with_inventory(sales, inventory);
+
+    const auto batch  = run_queries(sales, joined, queries);
+    const auto stream = run_queries_stream(kSalesCsv, ',', InventoryIndex(inventory),
+                                           queries, devnull);
+    ASSERT_EQ(batch.size(), queries.size());
+    ASSERT_EQ(stream.size(), queries.size());
+
+    for (std::size_t q = 0; q < 2; ++q) {
+        const auto separate = summarize_sales_stream(kSalesCsv, ',', inventory,
+                                                     queries[q].min_amount, devnull);
+        EXPECT_EQ(batch[q].summary.count,  separate.count);
+        EXPECT_EQ(batch[q].summary.total,  separate.total);
+        EXPECT_EQ(stream[q].summary.count, separate.count);
+        EXPECT_EQ(stream[q].summary.total, separate.total);
+    }
+    EXPECT_EQ(batch[0].summary.count, 3);   // 1500, 2000, 1200
+    EXPECT_EQ(batch[1].summary.count, 1);   // 2000
+
+    const auto separate = summarize_sales_stream_by_product(kSalesCsv, ',', inventory,
+                                                            0.0, devnull);
+    EXPECT_EQ(format_json(batch[2].groups),  format_json(separate));
+    EXPECT_EQ(format_json(stream[2].groups), format_json(separate));
+}
+
+// ---------------------------------------------------------------------------
+// CHECKPOINT_FILE: incremental runs over an appended sales file
+// ---------------------------------------------------------------------------
+
+namespace {
+
+const std::vector<Query> kIncrementalQueries = {
+    {"big", 1000.0, "json", ""},
+    {"all", 0.0,    "json", "product_id"},
+};
+
+// Results of an incremental run, in the form compared below.
+std::string incremental_report(const std::string& sales, const std::string& checkpoint,
+                               std::ostream& warnings,
+                               const std::vector<Query>& queries = kIncrementalQueries) {
+    const auto results = run_queries_incremental(sales, ',', InventoryIndex(make_inventory()),
+                                                 1, queries, checkpoint, warnings);
+    std::string report;
+    for (const auto& r : results) {
+        report += format_json(r.summary) + format_json(r.groups);
+    }
+    return report;
+}
+
+std::string full_report(const std::string& sales,
+                        const std::vector<Query>& queries = kIncrementalQueries) {
+    std::ostringstream devnull;
+    const auto results = run_queries_stream(sales, ',', InventoryIndex(make_inventory()),
+                                            queries, devnull);
+    std::string report;
+    for (const auto& r : results) {
+        report += format_json(r.summary) + format_json(r.groups);
+    }
+    return report;
+}
+
+}  // namespace
+
+TEST(RunQueriesIncremental, ReadsOnlyAppendedRows) {
+    const std::string checkpoint = "incremental_test.ckpt";
+    std::remove(checkpoint.c_str());
+    std::string sales = kSalesCsv + "O005,P002,oops\n";
+
+    std::ostringstream first;
+    EXPECT_EQ(incremental_report(sales, checkpoint, first), full_report(sales));
+    EXPECT_NE(first.str().find("line 6"), std::string::npos);
+
+    sales += "O006,P003,2500\n\nO007\n";
+    std::ostringstream second;
+    EXPECT_EQ(incremental_report(sales, checkpoint, second), full_report(sales));
+    // Only the new malformed row is reported, with its line in the file
+    EXPECT_EQ(second.str().find("line 6"), std::string::npos);
+    EXPECT_NE(second.str().find("line 9"), std::string::npos);
+
+    std::ostringstream third;
+    EXPECT_EQ(incremental_report(sales, checkpoint, third), full_report(sales));
+    EXPECT_TRUE(third.str().empty());
+    std::remove(checkpoint.c_str());
+}
+
+TEST(RunQueriesIncremental, LineBeingWrittenIsReadAgain) {
+    const std::string checkpoint = "incremental_partial_test.ckpt";
+    std::remove(checkpoint.c_str());
+    std::ostringstream devnull;
+
+    const std::string partial = kSalesCsv + "O005,P001,1";
+    EXPECT_EQ(incremental_report(partial, checkpoint, devnull), full_report(partial));
+
+    const std::string finished = kSalesCsv + "O005,P001,1800\n";
+    EXPECT_EQ(incremental_report(finished, checkpoint, devnull), full_report(finished));
+    std::remove(checkpoint.c_str());
+}
+
+TEST(RunQueriesIncremental, FallsBackToFullScan) {
+    const std::string checkpoint = "incremental_fallback_test.ckpt";
+    std::remove(checkpoint.c_str());
+    std::ostringstream devnull;
+    const std::string sales = kSalesCsv + "O005,P002,oops\n";
+    incremental_report(sales, checkpoint, devnull);
+
+    // Rewritten prefix: the old aggregates must not be reused
+    std::string rewritten = sales;
+    rewritten.replace(rewritten.find("1500"), 4, "1600");
+    std::ostringstream warnings;
+    EXPECT_EQ(incremental_report(rewritten, checkpoint, warnings), full_report(rewritten));
+    EXPECT_NE(warnings.str().find("line 6"), std::string::npos);
+
+    // A query without a saved aggregate
+    auto queries = kIncrementalQueries;
+    queries.push_back({"mid", 900.0, "json", ""});
+    EXPECT_EQ(incremental_report(rewritten, checkpoint, devnull, queries),
+              full_report(rewritten, queries));
+
+    // Truncated file and damaged checkpoint
+    const std::string shorter = kSalesCsv;
+    EXPECT_EQ(incremental_report(shorter, checkpoint, devnull), full_report(shorter));
+    {
+        std::ofstream out(checkpoint, std::ios::binary | std::ios::trunc);
+        out << "not a checkpoint";
+    }
+    EXPECT_EQ(incremental_report(shorter, checkpoint, devnull), full_report(shorter));
+    std::remove(checkpoint.c_str());
+}
+
+TEST(IncrementalQueries, AppendOnlyFileChecksOnlyTheBytesBeforeTheOffset) {
+    const InventoryIndex inventory(make_inventory());
+    std::ostringstream devnull;
+    Diagnostics diagnostics(devnull, DiagnosticsLimits{0, 0.0});
+
+    // Appended in steps across several 64 KiB hash blocks
+    std::string sales = kSalesCsv;
+    IncrementalQueries incremental(kIncrementalQueries, ',', 1);
+    FileIdentity file{1, 7, 100};
+    for (int step = 0; step < 5; ++step) {
+        for (int i = 0; i < 3000; ++i) {
+            sales += "O" + std::to_string(step * 3000 + i) + ",P00" +
+                     std::to_string(1 + i % 3) + "," + std::to_string(i % 2000) + "\n";
+        }
+        file.mtime += 1;
+        // The first update has nothing to resume from
+        EXPECT_EQ(incremental.update(sales, inventory, diagnostics, file), step > 0);
+    }
+    const std::string checkpoint = incremental.save();
+
+    // Without an identity the whole prefix is rehashed and still matches
+    IncrementalQueries rehashed(kIncrementalQueries, ',', 1);
+    ASSERT_TRUE(rehashed.load(checkpoint));
+    EXPECT_TRUE(rehashed.update(sales, inventory, diagnostics));
+    EXPECT_EQ(rehashed.offset(), sales.size());
+
+    // A changed first row is caught by the full check unless the file is
+    // trusted to be append-only, and then still once it is another file
+    std::string rewritten = sales;
+    rewritten.replace(rewritten.find("1500"), 4, "1600");
+    IncrementalQueries verified(kIncrementalQueries, ',', 1);
+    ASSERT_TRUE(verified.load(checkpoint));
+    EXPECT_FALSE(verified.update(rewritten, inventory, diagnostics));
+    std::string verified_report;
+    for (const auto& r : verified.results()) {
+        verified_report += format_json(r.summary) + format_json(r.groups);
+    }
+    EXPECT_EQ(verified_report, full_report(rewritten));
+    IncrementalQueries same(kIncrementalQueries, ',', 1);
+    ASSERT_TRUE(same.load(checkpoint));
+    EXPECT_TRUE(same.update(rewritten, inventory, diagnostics, file));
+    IncrementalQueries replaced(kIncrementalQueries, ',', 1);
+    ASSERT_TRUE(replaced.load(checkpoint));
+    EXPECT_FALSE(replaced.update(rewritten, inventory, diagnostics, {1, 8, file.mtime}));
+
+    // A change just before the offset is caught by the window check
+    std::string tail_changed = sales;
+    tail_changed[sales.size() - 3] = tail_changed[sales.size() - 3] == '1' ? '2' : '1';
+    IncrementalQueries window(kIncrementalQueries, ',', 1);
+    ASSERT_TRUE(window.load(checkpoint));
+    EXPECT_FALSE(window.update(tail_changed, inventory, diagnostics, file));
+    std::string report;
+    for (const auto& r : window.results()) {
+        report += format_json(r.summary) + format_json(r.groups);
+    }
+    EXPECT_EQ(report, full_report(tail_changed));
+}
@@ -0,0 +1,257 @@
+// sales_cache_test.cpp
+//
+// A saved sales cache loads back as a batch with the same rows, dictionary
+// and skipped rows, and gives the same reports; a cache saved for another stamp
+// or a higher MIN_AMOUNT, or a damaged one (also one whose product codes or
+// order ID offsets are out of range), is rejected; read_sales_batch writes
+// the cache on the first run, reuses it while the sales file is unchanged
+// (compressed or not), and reparses once it changes.
+
+#include <gtest/gtest.h>
+
+#include "csv_parser.h"
+#include "inventory_index.h"
+#include "reporter.h"
+#include "sales_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <variant>
+#include <vector>
+
+#ifdef CSV_REPORTER_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+const std::string kSales =
+    "order_id,product_id,amount\n"
+    "O001,P001,1500\n"
+    "O002,P002\n"
+    "O003,P003,999.99\n"
+    "O004,A-PRODUCT-ID-LONGER-THAN-SIXTEEN-BYTES,2500\n"
+    "O005,P001,abc\n"
+    "O006,P002,1000\n"
+    "O007,P009,3000\n";
+
+FileStamp make_stamp() {
+    FileStamp stamp;
+    stamp.size = kSales.size();
+    stamp.mtime = 5678;
+    stamp.hash = hash_key(kSales);
+    stamp.delimiter = ',';
+    return stamp;
+}
+
+SalesBatch parse(const std::string& content, double min_amount, std::vector<RowIssue>& skipped) {
+    std::ostringstream out;
+    Diagnostics diagnostics(out);
+    skipped.clear();
+    diagnostics.record(&skipped);
+    return parse_sales_batch(parse_csv_content(content, ','), diagnostics, min_amount);
+}
+
+bool same_issues(const std::vector<RowIssue>& a, const std::vector<RowIssue>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        if (a[i].problem != b[i].problem || a[i].line != b[i].line) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void write_file(const std::string& path, const std::string& content) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << content;
+}
+
+std::string read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+}  // namespace
+
+TEST(SalesCache, LoadedBatchMatchesParsedBatch) {
+    const std::string path = "sales_cache_test.cache";
+    std::vector<RowIssue> skipped;
+    const SalesBatch parsed = parse(kSales, 0.0, skipped);
+    ASSERT_EQ(skipped.size(), 2u);
+    ASSERT_TRUE(save_sales_cache(path, make_stamp(), 0.0, parsed, skipped));
+
+    SalesBatch loaded;
+    std::vector<RowIssue> loaded_skipped;
+    ASSERT_TRUE(load_sales_cache(path, make_stamp(), 1000.0, loaded, loaded_skipped));
+    EXPECT_TRUE(same_issues(loaded_skipped, skipped));
+    ASSERT_EQ(loaded.size(), parsed.size());
+    ASSERT_EQ(loaded.products.size(), parsed.products.size());
+    for (std::size_t i = 0; i < parsed.size(); ++i) {
+        EXPECT_EQ(loaded.order_id(i), parsed.order_id(i));
+        EXPECT_EQ(loaded.product_id(i), parsed.product_id(i));
+        EXPECT_EQ(loaded.amounts[i], parsed.amounts[i]);
+    }
+    EXPECT_EQ(loaded.products.find("P002"), parsed.products.find("P002"));
+
+    // Reports from the mapped columns equal those from the parsed ones
+    const std::vector<Query> queries = {
+        {"big", 1000.0, "json", ""},
+        {"all", 0.0,    "json", "product_id"},
+    };
+    const std::vector<InventoryRecord> inventory = {
+        {"P001", 1}, {"P002", 2}, {"A-PRODUCT-ID-LONGER-THAN-SIXTEEN-BYTES", 3}};
+    const auto expected = run_queries(parsed, join_with_inventory(parsed, inventory), queries);
+    const auto actual = run_queries(loaded, join_with_inventory(loaded, inventory), queries);
+    EXPECT_EQ(format_json(actual[0].summary), format_json(expected[0].summary));
+    EXPECT_EQ(format_json(actual[1].groups), format_json(expected[1].groups));
+
+    // The batch keeps the mapping alive when it is moved
+    SalesBatch moved = std::move(loaded);
+    EXPECT_EQ(moved.product_id(2), "A-PRODUCT-ID-LONGER-THAN-SIXTEEN-BYTES");
+    std::remove(path.c_str());
+}
+
+TEST(SalesCache, RejectsOtherStampHigherMinAmountOrDamage) {
+    const std::string path = "sales_cache_reject_test.cache";
+    std::vector<RowIssue> skipped;
+    const SalesBatch parsed = parse(kSales, 1000.0, skipped);
+    ASSERT_TRUE(save_sales_cache(path, make_stamp(), 1000.0, parsed, skipped));
+
+    SalesBatch batch = parse("order_id,product_id,amount\nO1,P1,1\n", 0.0, skipped);
+    const std::vector<RowIssue> unchanged = {{RowProblem::invalid_amount, 99}};
+    std::vector<RowIssue> loaded_warnings = unchanged;
+    for (auto change : {&FileStamp::size, &FileStamp::hash}) {
+        FileStamp other = make_stamp();
+        other.*change += 1;
+        EXPECT_FALSE(load_sales_cache(path, other, 1000.0, batch, loaded_warnings));
+    }
+    FileStamp other = make_stamp();
+    other.mtime += 1;
+    EXPECT_FALSE(load_sales_cache(path, other, 1000.0, batch, loaded_warnings));
+    other = make_stamp();
+    other.delimiter = ';';
+    EXPECT_FALSE(load_sales_cache(path, other, 1000.0, batch, loaded_warnings));
+
+    // Rows below 1000 were dropped, so a lower threshold needs a reparse
+    EXPECT_FALSE(load_sales_cache(path, make_stamp(), 999.0, batch, loaded_warnings));
+
+    const std::string bytes = read_file(path);
+    write_file(path, bytes.substr(0, bytes.size() - 8));
+    EXPECT_FALSE(load_sales_cache(path, make_stamp(), 1000.0, batch, loaded_warnings));
+
+    // A product code past the dictionary, or order ID offsets out of order.
+    // Layout: 72-byte header (rows at 48), amounts, codes padded to 8
+    // bytes, then the offsets.
+    std::uint64_t rows = 0;
+    std::memcpy(&rows, bytes.data() + 48, sizeof(rows));
+    const std::size_t codes_at = 72 + rows * 8;
+    const std::size_t offsets_at = codes_at + (rows * 4 + 7) / 8 * 8;
+    std::string damaged = bytes;
+    const std::uint32_t code = 1000;
+    std::memcpy(&damaged[codes_at], &code, sizeof(code));
+    write_file(path, damaged);
+    EXPECT_FALSE(load_sales_cache(path, make_stamp(), 1000.0, batch, loaded_warnings));
+    damaged = bytes;
+    const std::uint64_t offset = 1u << 20;
+    std::memcpy(&damaged[offsets_at + 8], &offset, sizeof(offset));
+    write_file(path, damaged);
+    EXPECT_FALSE(load_sales_cache(path, make_stamp(), 1000.0, batch, loaded_warnings));
+    write_file(path, bytes);
+    EXPECT_TRUE(load_sales_cache(path, make_stamp(), 1000.0, batch, loaded_warnings));
+    batch = parse("order_id,product_id,amount\nO1,P1,1\n", 0.0, skipped);
+    loaded_warnings = unchanged;
+    EXPECT_FALSE(load_sales_cache("no_such_sales.cache", make_stamp(), 1000.0, batch,
+                                  loaded_warnings));
+
+    EXPECT_TRUE(same_issues(loaded_warnings, unchanged));
+    ASSERT_EQ(batch.size(), 1u);
+    EXPECT_EQ(batch.product_id(0), "P1");
+    std::remove(path.c_str());
+}
+
+TEST(ReadSalesBatch, WritesReusesAndRefreshesTheCache) {
+    const std::string path = "read_sales_batch_test.csv";
+    const std::string sidecar = path + ".cache";
+    write_file(path, kSales);
+    std::remove(sidecar.c_str());
+
+    std::ostringstream first_warnings;
+    Diagnostics first_diagnostics(first_warnings);
+    auto first = read_sales_batch(path, kSales, Compression::none, ',', 0.0, true,
+                                  first_diagnostics);
+    ASSERT_TRUE(std::holds_alternative<SalesBatch>(first));
+    EXPECT_FALSE(read_file(sidecar).empty());
+
+    // A second run maps the cache and replays the warnings and counts
+    std::ostringstream second_warnings;
+    Diagnostics second_diagnostics(second_warnings);
+    auto second = read_sales_batch(path, kSales, Compression::none, ',', 500.0, true,
+                                   second_diagnostics);
+    ASSERT_TRUE(std::holds_alternative<SalesBatch>(second));
+    EXPECT_EQ(second_warnings.str(), first_warnings.str());
+    EXPECT_EQ(second_diagnostics.json(), first_diagnostics.json());
+    EXPECT_EQ(second_diagnostics.count(RowProblem::invalid_amount), 1u);
+    EXPECT_EQ(std::get<SalesBatch>(second).size(), std::get<SalesBatch>(first).size());
+    EXPECT_FALSE(std::get<SalesBatch>(second).cache.view().empty());
+
+    // A changed sales file is parsed again
+    const std::string changed = kSales + "O008,P001,42\n";
+    write_file(path, changed);
+    std::ostringstream third_warnings;
+    Diagnostics third_diagnostics(third_warnings);
+    auto third = read_sales_batch(path, changed, Compression::none, ',', 0.0, true,
+                                  third_diagnostics);
+    ASSERT_TRUE(std::holds_alternative<SalesBatch>(third));
+    EXPECT_EQ(std::get<SalesBatch>(third).size(), std::get<SalesBatch>(first).size() + 1);
+    EXPECT_TRUE(std::get<SalesBatch>(third).cache.view().empty());
+
+    std::remove(path.c_str());
+    std::remove(sidecar.c_str());
+}
+
+#ifdef CSV_REPORTER_HAVE_ZLIB
+TEST(ReadSalesBatch, CompressedSalesAreOnlyDecompressedWithoutACache) {
+    const std::string path = "read_sales_batch_test.csv.gz";
+    const std::string sidecar = path + ".cache";
+    std::string compressed(compressBound(static_cast<uLong>(kSales.size())) + 32, '\0');
+    z_stream zs{};
+    deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(kSales.data()));
+    zs.avail_in = static_cast<uInt>(kSales.size());
+    zs.next_out = reinterpret_cast<Bytef*>(&compressed[0]);
+    zs.avail_out = static_cast<uInt>(compressed.size());
+    deflate(&zs, Z_FINISH);
+    compressed.resize(zs.total_out);
+    deflateEnd(&zs);
+    write_file(path, compressed);
+    std::remove(sidecar.c_str());
+
+    std::ostringstream out;
+    Diagnostics warnings(out);
+    auto first = read_sales_batch(path, compressed, Compression::gzip, ',', 0.0, true, warnings);
+    ASSERT_TRUE(std::holds_alternative<SalesBatch>(first));
+
+    // The stamp is of the compressed bytes: the second run maps the cache
+    // without decompressing anything
+    auto second = read_sales_batch(path, compressed, Compression::gzip, ',', 0.0, true, warnings);
+    ASSERT_TRUE(std::holds_alternative<SalesBatch>(second));
+    EXPECT_EQ(std::get<SalesBatch>(second).size(), std::get<SalesBatch>(first).size());
+    EXPECT_FALSE(std::get<SalesBatch>(second).cache.view().empty());
+
+    auto truncated = read_sales_batch(path, compressed.substr(0, 20), Compression::gzip, ',',
+                                      0.0, false, warnings);
+    ASSERT_TRUE(std::holds_alternative<std::string>(truncated));
+    EXPECT_NE(std::get<std::string>(truncated).find("[ERROR] Cannot decompress SALES_FILE"),
+              std::string::npos);
+
+    std::remove(path.c_str());
+    std::remove(sidecar.c_str());
+}
+#endif
@@ -0,0 +1,124 @@
+// stable_sum_test.cpp
+//
+// StableSum gives the same bits however its blocks were accumulated, is
+// accurate where naive summation is not, resumes from a saved state with
+// the same bits, and makes the columnar summary independent of the thread
+// count.
+
+#include <gtest/gtest.h>
+
+#include "csv_parser.h"
+#include "reporter.h"
+#include "stable_sum.h"
+
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<double> random_amounts(std::size_t n, unsigned seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> dist(-1e6, 1e6);
+    std::vector<double> values(n);
+    for (auto& v : values) {
+        v = dist(rng) * ((rng() % 16 == 0) ? 1e9 : 1.0);
+    }
+    return values;
+}
+
+}  // namespace
+
+TEST(StableSum, AppendedBlocksMatchStreamingAdd) {
+    const auto values = random_amounts(10 * StableSum::kBlockSize + 17, 5);
+
+    StableSum streamed;
+    for (double v : values) {
+        streamed.add(v);
+    }
+
+    // Same values, accumulated block by block as parallel workers would
+    std::vector<StableSum::Block> blocks(
+        (values.size() + StableSum::kBlockSize - 1) / StableSum::kBlockSize);
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        blocks[i / StableSum::kBlockSize].add(values[i]);
+    }
+    StableSum appended;
+    for (const auto& block : blocks) {
+        appended.append(block);
+    }
+
+    EXPECT_EQ(appended.count(), values.size());
+    EXPECT_EQ(appended.value(), streamed.value());
+}
+
+TEST(StableSum, CompensatesCancellation) {
+    StableSum sum;
+    double naive = 0.0;
+    for (int i = 0; i < 10000; ++i) {
+        for (double v : {1e16, 1.0, -1e16}) {
+            sum.add(v);
+            naive += v;
+        }
+    }
+    EXPECT_EQ(sum.value(), 10000.0);
+    EXPECT_NE(naive, 10000.0);
+}
+
+TEST(StableSum, RestoredStateContinuesBitIdentically) {
+    const auto values = random_amounts(StableSum::kBlockSize * 13 + 517, 5);
+    StableSum whole;
+    for (double v : values) {
+        whole.add(v);
+    }
+
+    for (std::size_t split : {std::size_t{0}, std::size_t{1000}, StableSum::kBlockSize * 8 + 3}) {
+        StableSum first;
+        for (std::size_t i = 0; i < split; ++i) {
+            first.add(values[i]);
+        }
+        StableSum resumed;
+        ASSERT_TRUE(resumed.restore(first.state()));
+        for (std::size_t i = split; i < values.size(); ++i) {
+            resumed.add(values[i]);
+        }
+        EXPECT_EQ(resumed.count(), whole.count()) << split;
+        EXPECT_EQ(resumed.value(), whole.value()) << split;
+    }
+
+    StableSum::State bad;
+    bad.block_count = StableSum::kBlockSize;
+    EXPECT_FALSE(StableSum().restore(bad));
+    bad.block_count = 0;
+    bad.blocks = 5;   // pending levels 0 and 2, but none saved
+    EXPECT_FALSE(StableSum().restore(bad));
+}
+
+TEST(StableSum, EmptySumIsZero) {
+    EXPECT_EQ(StableSum().value(), 0.0);
+    EXPECT_EQ(StableSum().count(), 0u);
+}
+
+TEST(ComputeSummary, TotalIsBitIdenticalForAnyThreadCount) {
+    // Above the parallel threshold, with every third row deselected
+    const auto values = random_amounts((std::size_t{1} << 20) * 3 / 2 + 101, 11);
+    SalesBatch batch;
+    batch.amounts = values;
+    Selection selection((values.size() + 63) / 64, 0);
+    std::vector<SalesRecord> selected;
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        if (i % 3 != 0) {
+            selection[i / 64] |= std::uint64_t{1} << (i % 64);
+            selected.push_back({"", "", values[i]});
+        }
+    }
+
+    const auto expected = compute_summary(selected);
+    for (unsigned threads : {1u, 2u, 3u, 8u}) {
+        const auto actual = compute_summary(batch, selection, threads);
+        EXPECT_EQ(actual.count, expected.count) << threads << " threads";
+        EXPECT_EQ(actual.total, expected.total) << threads << " threads";
+        EXPECT_EQ(actual.average, expected.average) << threads << " threads";
+    }
+}
@@ -0,0 +1,185 @@
+// Copyright (c) 2018 Heikki Johannes Hildén <hildenjohannes@gmail.com>
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of copyright holder nor the names of other
+//       contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file dotenv_core.h
+///
+/// Declarations only. Include this header instead of dotenv.h to keep
+/// `<iostream>`, `<fstream>` and the parser out of the including translation
+/// unit, and link against the compiled `dotenv_impl` library.
+///
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#define DOTENV_HAS_STRING_VIEW 1
+#include <string_view>
+#endif
+
+#if !defined(_MSC_VER) && !defined(__MINGW32__)
+#define DOTENV_HAS_SHM 1
+#endif
+
+// Member definitions are inline when the library is used header-only, and
+// out-of-line when compiled into dotenv_impl.
+#ifndef DOTENV_INLINE
+#define DOTENV_INLINE inline
+#endif
+
+///
+/// Utility class for loading environment variables from a file.
+///
+/// ### Typical use
+///
+/// Given a file `.env`
+///
+/// \code
+/// DATABASE_HOST=localhost
+/// DATABASE_USERNAME=user
+/// DATABASE_PASSWORD="antipasto"
+/// \endcode
+///
+/// and a program `example.cpp`
+///
+/// \code
+/// // example.cpp
+/// #include <iostream>
+/// #include <dotenv.h>
+///
+/// int main()
+/// {
+///     dotenv::init();
+///
+///     std::cout << std::getenv("DATABASE_USERNAME") << std::endl;
+///     std::cout << std::getenv("DATABASE_PASSWORD") << std::endl;
+///
+///     return 0;
+/// }
+/// \endcode
+///
+/// Compile and run the program, e.g. using,
+///
+/// \code
+/// c++ example.cpp -o example -I/usr/local/include/laserpants/dotenv-0.9.3 && ./example
+/// \endcode
+///
+/// and the output is:
+///
+/// \code
+/// user
+/// antipasto
+/// \endcode
+///
+/// \see https://github.com/laserpants/dotenv-cpp
+///
+class dotenv
+{
+public:
+    dotenv() = delete;
+    ~dotenv() = delete;
+
+    static const unsigned char Preserve = 1 << 0;
+    static const unsigned char Profile  = 1 << 1;
+
+    static const int OptionsNone = 0;
+
+    static void init(const char* filename = ".env");
+    static void init(int flags, const char* filename = ".env");
+
+    static std::string getenv(const char* name, const std::string& def = "");
+
+#ifdef DOTENV_HAS_STRING_VIEW
+    static std::string_view getfile(const char* name);
+#endif
+
+    static std::string profile_report();
+
+#ifdef DOTENV_HAS_SHM
+    static bool publish(const char* shm_name, const char* filename = ".env");
+    static bool publish(int flags, const char* shm_name, const char* filename = ".env");
+    static void unpublish(const char* shm_name);
+    static bool attach(const char* shm_name);
+    static bool refresh();
+    static void detach();
+    static unsigned long long generation();
+#endif
+
+private:
+    struct mapped_file;
+    struct file_registry;
+    struct read_stats;
+    struct read_profile;
+    struct snapshot_builder;
+    struct snapshot_index;
+    struct snapshot_header;
+    struct snapshot_entry;
+    struct snapshot_state;
+
+    static void do_init(int flags, const char* filename, snapshot_builder* snapshot = nullptr);
+    static std::string strip_quotes(const std::string& str);
+
+    static std::pair<std::string,bool> resolve_vars(size_t iline, const std::string& str);
+    static void  ltrim(std::string& s);
+    static void  rtrim(std::string& s);
+    static void  trim(std::string& s);
+    static std::string trim_copy(std::string s);
+    static size_t find_var_start(const std::string& str, size_t pos, std::string& start_tag);
+    static size_t find_var_end(const std::string& str, size_t pos, const std::string& start_tag);
+
+    static bool read_file(const char* path, std::string& contents);
+    static const mapped_file* map_file(const std::string& path);
+    static std::string reference_path(const char* name, const char* path);
+    static std::string env_directory(const char* filename);
+    static void record_directory(const std::string& name, const std::string& value,
+                                 const std::string& directory);
+    static file_registry& files();
+
+    static std::string getenv_profiled(const char* name, const std::string& def, const void* site);
+#ifdef DOTENV_HAS_STRING_VIEW
+    static std::string_view lookup_file(const char* name);
+#endif
+    static void enable_profiling();
+    static void record_read(const char* name, unsigned long long ns, const void* site);
+    static void print_profile_report();
+    static read_profile& profile();
+
+    static const char* lookup(const char* name);
+    static snapshot_state& snapshot();
+#ifdef DOTENV_HAS_SHM
+    static unsigned long long published_generation(const char* shm_name);
+    static bool map_snapshot(const char* segment, snapshot_state& state, bool writable = false);
+    static void unmap_snapshot(snapshot_state& state);
+    static const char* snapshot_find(const snapshot_state& state, const char* name);
+#endif
+};
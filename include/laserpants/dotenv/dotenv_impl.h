@@ -0,0 +1,1191 @@
+// Copyright (c) 2018 Heikki Johannes Hildén <hildenjohannes@gmail.com>
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of copyright holder nor the names of other
+//       contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+///
+/// \file dotenv_impl.h
+///
+/// Definitions of the members declared in dotenv_core.h. Included by dotenv.h
+/// for header-only use, and compiled once into the `dotenv_impl` library.
+///
+#pragma once
+
+#include "dotenv_core.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <new>
+#include <vector>
+
+// The profiled entry points take their call site from their own return
+// address, so they must never be inlined into the caller: the address would
+// then be that of the caller's caller.
+#if defined(__GNUC__) || defined(__clang__)
+#define DOTENV_RETURN_ADDRESS() __builtin_return_address(0)
+#define DOTENV_NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#define DOTENV_RETURN_ADDRESS() _ReturnAddress()
+#define DOTENV_NOINLINE __declspec(noinline)
+#else
+#define DOTENV_RETURN_ADDRESS() nullptr
+#define DOTENV_NOINLINE
+#endif
+
+#if defined(_MSC_VER) || defined(__MINGW32__)
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+struct dotenv::mapped_file
+{
+    mapped_file() = default;
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+    ~mapped_file();
+
+    const char* data = nullptr;
+    size_t size = 0;
+    std::string contents;
+};
+
+struct dotenv::file_registry
+{
+    std::mutex mutex;
+    std::map<std::string, mapped_file> files;  // keyed by path
+    std::map<std::string, std::string> directories;  // keyed by variable: the
+                                                     // directory of the .env file
+                                                     // that set a relative @path
+};
+
+struct dotenv::read_stats
+{
+    unsigned long long count = 0;
+    unsigned long long total_ns = 0;
+    unsigned long long max_ns = 0;
+    std::map<const void*, unsigned long long> sites;
+};
+
+struct dotenv::read_profile
+{
+    std::atomic<bool> enabled{false};
+    std::mutex mutex;
+    std::map<std::string, read_stats> keys;
+};
+
+struct dotenv::snapshot_builder
+{
+    std::vector<std::string> names;  // in order of first assignment
+};
+
+#ifdef DOTENV_HAS_SHM
+
+// The object under the name given to dotenv::publish(). It only holds the
+// generation of the current snapshot, which lives in an object of its own
+// named "<name>.<generation>", so that a snapshot is complete before any
+// process can find it.
+struct dotenv::snapshot_index
+{
+    std::atomic<std::uint64_t> magic;
+    std::atomic<std::uint64_t> generation;  // 0 until the first publish
+};
+
+// Layout of a published snapshot: a header, an array of entries sorted by
+// key, and the NUL-terminated keys and values they refer to. All references
+// are offsets from the start of the segment, so it can be mapped anywhere.
+struct dotenv::snapshot_header
+{
+    std::atomic<std::uint64_t> magic;       // stored last
+    std::uint32_t version;
+    std::uint32_t count;
+    std::uint64_t generation;
+    std::uint64_t size;
+    std::atomic<std::uint32_t> superseded;  // set once a newer snapshot exists
+};
+
+struct dotenv::snapshot_entry
+{
+    std::uint32_t key;
+    std::uint32_t value;
+};
+
+#endif // DOTENV_HAS_SHM
+
+struct dotenv::snapshot_state
+{
+    const char* base = nullptr;
+    size_t size = 0;
+    std::string name;
+};
+
+namespace dotenv_detail {
+
+const std::uint64_t snapshot_magic = 0x48534e45544f44ULL;  // "DOTENSH"
+const std::uint32_t snapshot_version = 2;
+const std::uint64_t snapshot_index_magic = 0x58444e49544f44ULL;  // "DOTINDX"
+
+// Name of the object holding generation \a gen of the snapshot \a shm_name.
+inline std::string snapshot_segment_name(const char* shm_name, std::uint64_t gen)
+{
+    return std::string(shm_name) + '.' + std::to_string(gen);
+}
+
+// True for paths that do not start at a root directory or drive.
+inline bool is_relative_path(const char* path)
+{
+    if (path[0] == '/' || path[0] == '\\')
+        return false;
+#if defined(_MSC_VER) || defined(__MINGW32__)
+    if (path[0] != '\0' && path[1] == ':')
+        return false;
+#endif
+    return path[0] != '\0';
+}
+
+inline unsigned long long elapsed_ns(std::chrono::steady_clock::time_point start)
+{
+    return static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+} // namespace dotenv_detail
+
+///
+/// Read and initialize environment variables from the `.env` file, or a file
+/// specified by the \a filename argument.
+///
+/// \param filename a file to read environment variables from
+///
+DOTENV_INLINE void dotenv::init(const char* filename)
+{
+    dotenv::do_init(OptionsNone, filename);
+}
+
+///
+/// Read and initialize environment variables using the provided configuration
+/// flags.
+///
+/// By default, if a name is already present in the environment, `dotenv::init()`
+/// will replace it with the new value. To preserve existing variables, you
+/// must pass the `Preserve` flag.
+///
+/// \code
+/// dotenv::init(dotenv::Preserve);
+/// \endcode
+///
+/// Passing the `Profile` flag turns on read profiling, see
+/// dotenv::profile_report().
+///
+/// \param flags    configuration flags
+/// \param filename a file to read environment variables from
+///
+DOTENV_INLINE void dotenv::init(int flags, const char* filename)
+{
+    dotenv::do_init(flags, filename);
+}
+
+///
+/// Wrapper for std::getenv() which also takes a default value, in case the
+/// variable turns out to be empty.
+///
+/// \param name the name of the variable to look up
+/// \param def  a default value
+///
+/// \returns the value of the environment variable \a name, or \a def if the
+///          variable is not set
+///
+DOTENV_NOINLINE DOTENV_INLINE std::string dotenv::getenv(const char* name, const std::string& def)
+{
+    if (profile().enabled.load(std::memory_order_relaxed))
+        return getenv_profiled(name, def, DOTENV_RETURN_ADDRESS());
+
+    const char* str = lookup(name);
+    return str ? std::string(str) : def;
+}
+
+DOTENV_INLINE std::string dotenv::getenv_profiled(const char* name, const std::string& def, const void* site)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const char* str = lookup(name);
+    std::string value = str ? std::string(str) : def;
+    record_read(name, dotenv_detail::elapsed_ns(start), site);
+    return value;
+}
+
+#ifdef DOTENV_HAS_STRING_VIEW
+
+///
+/// Look up a variable holding a file reference, i.e., a value on the form
+/// `@path`, and return the contents of the referenced file.
+///
+/// \code
+/// CERT=@/etc/app/cert.pem
+/// \endcode
+///
+/// A relative path is resolved against the directory of the .env file that
+/// set the variable, so the program may run from any directory.
+///
+/// The environment only ever holds the reference itself; the file is mapped
+/// into memory the first time it is requested and stays mapped until the
+/// program exits, so repeated lookups of the same file are cheap and the
+/// returned view remains valid.
+///
+/// \param name the name of the variable to look up
+///
+/// \returns the contents of the referenced file, or an empty view if the
+///          variable is not set, does not start with `@`, or the file cannot
+///          be read (which is reported on `stderr`)
+///
+DOTENV_NOINLINE DOTENV_INLINE std::string_view dotenv::getfile(const char* name)
+{
+    if (!profile().enabled.load(std::memory_order_relaxed))
+        return lookup_file(name);
+
+    const auto start = std::chrono::steady_clock::now();
+    const std::string_view contents = lookup_file(name);
+    record_read(name, dotenv_detail::elapsed_ns(start), DOTENV_RETURN_ADDRESS());
+    return contents;
+}
+
+DOTENV_INLINE std::string_view dotenv::lookup_file(const char* name)
+{
+    const char* str = lookup(name);
+    if (!str || str[0] != '@')
+        return std::string_view();
+
+    const std::string path = reference_path(name, str + 1);
+    const mapped_file* file = map_file(path);
+    if (!file) {
+        std::fprintf(stderr, "dotenv: Cannot read file '%s' referenced by %s\n", path.c_str(), name);
+        return std::string_view();
+    }
+    return std::string_view(file->data, file->size);
+}
+
+#endif // DOTENV_HAS_STRING_VIEW
+
+///
+/// Produce a report of all reads made through dotenv::getenv() and
+/// dotenv::getfile() since profiling was turned on with the `Profile` flag,
+/// ranked by number of reads. Each key lists its read count, total and
+/// average lookup latency, and the call sites it was read from, given as
+/// return addresses which can be resolved with e.g. `addr2line`.
+///
+/// \code
+/// dotenv::init(dotenv::Profile);
+/// // ...
+/// std::cerr << dotenv::profile_report();
+/// \endcode
+///
+/// The same report is written to `stderr` when the program exits.
+///
+/// \returns the formatted report, or an empty string if nothing was recorded
+///
+DOTENV_INLINE std::string dotenv::profile_report()
+{
+    typedef std::pair<std::string, read_stats> entry;
+
+    std::vector<entry> entries;
+    {
+        read_profile& prof = profile();
+        std::lock_guard<std::mutex> lock(prof.mutex);
+        entries.assign(prof.keys.begin(), prof.keys.end());
+    }
+    if (entries.empty())
+        return std::string();
+
+    std::sort(entries.begin(), entries.end(), [](const entry& a, const entry& b) {
+        return a.second.count != b.second.count ? a.second.count > b.second.count
+                                                : a.first < b.first;
+    });
+
+    char buf[128];
+    std::string report = "dotenv: read profile\n";
+    std::snprintf(buf, sizeof(buf), "%12s %14s %10s %10s  %s\n",
+                  "reads", "total us", "avg ns", "max ns", "key");
+    report += buf;
+
+    for (const auto& e : entries)
+    {
+        const read_stats& st = e.second;
+        std::snprintf(buf, sizeof(buf), "%12llu %14.1f %10llu %10llu  ",
+                      st.count, st.total_ns / 1000.0, st.total_ns / st.count, st.max_ns);
+        report += buf;
+        report += e.first;
+        report += '\n';
+
+        std::vector<std::pair<const void*, unsigned long long>> sites(st.sites.begin(), st.sites.end());
+        std::sort(sites.begin(), sites.end(), [](const std::pair<const void*, unsigned long long>& a,
+                                                 const std::pair<const void*, unsigned long long>& b) {
+            return a.second > b.second;
+        });
+        for (const auto& site : sites)
+        {
+            std::snprintf(buf, sizeof(buf), "%12llu %14s %p\n", site.second, "at", site.first);
+            report += buf;
+        }
+    }
+    return report;
+}
+
+DOTENV_INLINE dotenv::read_profile& dotenv::profile()
+{
+    static read_profile prof;
+    return prof;
+}
+
+DOTENV_INLINE void dotenv::enable_profiling()
+{
+    // the profile must be constructed before the exit handler is registered,
+    // so that it is still alive when the handler runs
+    read_profile& prof = profile();
+
+    std::lock_guard<std::mutex> lock(prof.mutex);
+    if (!prof.enabled.exchange(true))
+        std::atexit(&dotenv::print_profile_report);
+}
+
+DOTENV_INLINE void dotenv::record_read(const char* name, unsigned long long ns, const void* site)
+{
+    read_profile& prof = profile();
+
+    std::lock_guard<std::mutex> lock(prof.mutex);
+    read_stats& st = prof.keys[name];
+    ++st.count;
+    st.total_ns += ns;
+    st.max_ns = (std::max)(st.max_ns, ns);
+    ++st.sites[site];
+}
+
+DOTENV_INLINE void dotenv::print_profile_report()
+{
+    const std::string report = profile_report();
+    std::fputs(report.c_str(), stderr);
+}
+
+DOTENV_INLINE dotenv::mapped_file::~mapped_file()
+{
+#if !defined(_MSC_VER) && !defined(__MINGW32__)
+    if (data && size)
+        munmap(const_cast<char*>(data), size);
+#endif
+}
+
+DOTENV_INLINE dotenv::file_registry& dotenv::files()
+{
+    static file_registry registry;
+    return registry;
+}
+
+///
+/// Read the whole file at \a path into \a contents using unbuffered reads.
+///
+/// \returns false if the file cannot be opened or read
+///
+DOTENV_INLINE bool dotenv::read_file(const char* path, std::string& contents)
+{
+#if defined(_MSC_VER) || defined(__MINGW32__)
+    const int fd = _open(path, _O_RDONLY | _O_TEXT);
+#else
+    const int fd = open(path, O_RDONLY);
+#endif
+    if (fd < 0)
+        return false;
+
+    char buf[8192];
+    bool ok = true;
+    for (;;)
+    {
+#if defined(_MSC_VER) || defined(__MINGW32__)
+        const int n = _read(fd, buf, sizeof(buf));
+#else
+        const ssize_t n = read(fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR)
+            continue;
+#endif
+        if (n <= 0) {
+            ok = (n == 0);
+            break;
+        }
+        contents.append(buf, static_cast<size_t>(n));
+    }
+#if defined(_MSC_VER) || defined(__MINGW32__)
+    _close(fd);
+#else
+    close(fd);
+#endif
+    return ok;
+}
+
+///
+/// The file a reference `@path` held by the variable \a name points to: a
+/// relative \a path is taken relative to the directory of the .env file that
+/// assigned it, not to the current directory.
+///
+DOTENV_INLINE std::string dotenv::reference_path(const char* name, const char* path)
+{
+    if (!dotenv_detail::is_relative_path(path))
+        return path;
+
+    file_registry& registry = files();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    const auto it = registry.directories.find(name);
+    if (it == registry.directories.end())
+        return path;
+    return it->second + '/' + path;
+}
+
+///
+/// The directory of the .env file \a filename, as an absolute path where the
+/// platform allows, so that it stays valid if the program changes directory.
+///
+DOTENV_INLINE std::string dotenv::env_directory(const char* filename)
+{
+    const char* slash = std::strrchr(filename, '/');
+#if defined(_MSC_VER) || defined(__MINGW32__)
+    const char* backslash = std::strrchr(filename, '\\');
+    if (!slash || (backslash && backslash > slash))
+        slash = backslash;
+#endif
+    std::string dir = slash ? std::string(filename, static_cast<size_t>(slash - filename)) : ".";
+    if (slash == filename)
+        dir = "/";
+#if !defined(_MSC_VER) && !defined(__MINGW32__)
+    if (dotenv_detail::is_relative_path(dir.c_str()))
+    {
+        char cwd[4096];
+        if (getcwd(cwd, sizeof(cwd)))
+            dir = dir == "." ? std::string(cwd) : std::string(cwd) + '/' + dir;
+    }
+#endif
+    return dir;
+}
+
+///
+/// Map the file at \a path into memory, or return the existing mapping if it
+/// was mapped by an earlier call. Where mmap() is not available the file is
+/// read into memory instead.
+///
+/// \returns the mapped file, or nullptr if the file cannot be read
+///
+DOTENV_INLINE const dotenv::mapped_file* dotenv::map_file(const std::string& path)
+{
+    file_registry& registry = files();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    auto it = registry.files.find(path);
+    if (it != registry.files.end())
+        return &it->second;
+
+#if !defined(_MSC_VER) && !defined(__MINGW32__)
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return nullptr;
+    }
+
+    void* addr = nullptr;
+    const size_t size = static_cast<size_t>(st.st_size);
+    if (size > 0) {
+        addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            close(fd);
+            return nullptr;
+        }
+    }
+    close(fd);
+
+    mapped_file& file = registry.files[path];
+    file.data = static_cast<const char*>(addr);
+    file.size = size;
+#else
+    std::string contents;
+    if (!read_file(path.c_str(), contents))
+        return nullptr;
+
+    mapped_file& file = registry.files[path];
+    file.contents.swap(contents);
+    file.data = file.contents.data();
+    file.size = file.contents.size();
+#endif
+    return &file;
+}
+
+///
+/// Look up \a name in the attached snapshot, if any, and otherwise in the
+/// environment.
+///
+DOTENV_INLINE const char* dotenv::lookup(const char* name)
+{
+#ifdef DOTENV_HAS_SHM
+    const snapshot_state& state = snapshot();
+    if (state.base)
+    {
+        if (const char* value = snapshot_find(state, name))
+            return value;
+    }
+#endif
+    return std::getenv(name);
+}
+
+DOTENV_INLINE dotenv::snapshot_state& dotenv::snapshot()
+{
+    static snapshot_state state;
+    return state;
+}
+
+#ifdef DOTENV_HAS_SHM
+
+///
+/// Read and resolve the variables in \a filename, as dotenv::init() does, and
+/// publish the result as a read-only snapshot in the POSIX shared memory
+/// object \a shm_name (e.g. `"/myapp-config"`).
+///
+/// Intended for prefork servers: the parent parses the file once, and each
+/// worker calls dotenv::attach() to look variables up directly in the shared
+/// mapping instead of parsing the file again and keeping its own copy.
+///
+/// Publishing again replaces the snapshot and increments its generation. The
+/// new snapshot is written to an object of its own and only then made the
+/// current one, so dotenv::attach() always finds a complete snapshot, old or
+/// new. Processes attached to the previous snapshot keep seeing it until they
+/// call dotenv::refresh(). Publishes under one name must not run concurrently.
+///
+/// \param flags    configuration flags, as for dotenv::init()
+/// \param shm_name name of the shared memory object
+/// \param filename a file to read environment variables from
+///
+/// \returns false if the shared memory objects could not be created, or
+///          \a shm_name is taken by something else
+///
+DOTENV_INLINE bool dotenv::publish(int flags, const char* shm_name, const char* filename)
+{
+    using namespace dotenv_detail;
+
+    snapshot_builder builder;
+    do_init(flags, filename, &builder);
+
+    std::sort(builder.names.begin(), builder.names.end());
+
+    // relative file references are stored resolved, since workers may run
+    // from another directory
+    std::vector<std::pair<const std::string*, std::string>> vars;
+    for (const auto& name : builder.names)
+    {
+        if (const char* value = std::getenv(name.c_str()))
+        {
+            if (value[0] == '@')
+                vars.push_back(std::make_pair(&name, '@' + reference_path(name.c_str(), value + 1)));
+            else
+                vars.push_back(std::make_pair(&name, std::string(value)));
+        }
+    }
+
+    size_t size = sizeof(snapshot_header) + vars.size() * sizeof(snapshot_entry);
+    for (const auto& var : vars)
+        size += var.first->size() + 1 + var.second.size() + 1;
+
+    // the index is created by the first publish and lives as long as the name
+    const int index_fd = shm_open(shm_name, O_CREAT | O_RDWR, 0600);
+    if (index_fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(index_fd, &st) != 0
+        || (st.st_size == 0 && ftruncate(index_fd, sizeof(snapshot_index)) != 0)
+        || (st.st_size != 0 && static_cast<size_t>(st.st_size) != sizeof(snapshot_index)))
+    {
+        close(index_fd);
+        return false;
+    }
+
+    void* index_addr = mmap(nullptr, sizeof(snapshot_index), PROT_READ | PROT_WRITE, MAP_SHARED, index_fd, 0);
+    close(index_fd);
+    if (index_addr == MAP_FAILED)
+        return false;
+
+    auto* index = static_cast<snapshot_index*>(index_addr);
+    const std::uint64_t index_magic = index->magic.load(std::memory_order_acquire);
+    if (index_magic != 0 && index_magic != snapshot_index_magic)
+    {
+        munmap(index_addr, sizeof(snapshot_index));
+        return false;
+    }
+    index->magic.store(snapshot_index_magic, std::memory_order_release);
+
+    // the new snapshot is built where no process looks for it yet; a segment
+    // left there by a publish that did not finish was never visible either
+    const std::uint64_t previous_gen = index->generation.load(std::memory_order_acquire);
+    const std::uint64_t gen = previous_gen + 1;
+    const std::string segment = snapshot_segment_name(shm_name, gen);
+
+    shm_unlink(segment.c_str());
+    const int fd = shm_open(segment.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0 || ftruncate(fd, static_cast<off_t>(size)) != 0)
+    {
+        if (fd >= 0) {
+            close(fd);
+            shm_unlink(segment.c_str());
+        }
+        munmap(index_addr, sizeof(snapshot_index));
+        return false;
+    }
+
+    void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+    {
+        shm_unlink(segment.c_str());
+        munmap(index_addr, sizeof(snapshot_index));
+        return false;
+    }
+
+    char* base = static_cast<char*>(addr);
+    snapshot_header* header = new (base) snapshot_header;
+    header->version = snapshot_version;
+    header->count = static_cast<std::uint32_t>(vars.size());
+    header->generation = gen;
+    header->size = size;
+    header->superseded.store(0);
+
+    snapshot_entry* entries = reinterpret_cast<snapshot_entry*>(base + sizeof(snapshot_header));
+    size_t offset = sizeof(snapshot_header) + vars.size() * sizeof(snapshot_entry);
+    for (size_t i = 0; i < vars.size(); ++i)
+    {
+        const std::string& key = *vars[i].first;
+        const size_t value_len = vars[i].second.size();
+
+        entries[i].key = static_cast<std::uint32_t>(offset);
+        std::memcpy(base + offset, key.c_str(), key.size() + 1);
+        offset += key.size() + 1;
+
+        entries[i].value = static_cast<std::uint32_t>(offset);
+        std::memcpy(base + offset, vars[i].second.c_str(), value_len + 1);
+        offset += value_len + 1;
+    }
+    header->magic.store(snapshot_magic, std::memory_order_release);
+    munmap(addr, size);
+
+    // attach() finds the new snapshot from here on; processes attached to the
+    // previous one keep their mapping of it until they call refresh()
+    index->generation.store(gen, std::memory_order_release);
+    munmap(index_addr, sizeof(snapshot_index));
+
+    if (previous_gen != 0)
+    {
+        const std::string previous_segment = snapshot_segment_name(shm_name, previous_gen);
+        snapshot_state previous;
+        if (map_snapshot(previous_segment.c_str(), previous, true))
+        {
+            auto* old = reinterpret_cast<snapshot_header*>(const_cast<char*>(previous.base));
+            old->superseded.store(1, std::memory_order_release);
+            unmap_snapshot(previous);
+        }
+        shm_unlink(previous_segment.c_str());
+    }
+    return true;
+}
+
+DOTENV_INLINE bool dotenv::publish(const char* shm_name, const char* filename)
+{
+    return publish(OptionsNone, shm_name, filename);
+}
+
+///
+/// Remove the shared memory objects of \a shm_name created by dotenv::publish().
+/// Processes that are still attached keep their mapping.
+///
+DOTENV_INLINE void dotenv::unpublish(const char* shm_name)
+{
+    using namespace dotenv_detail;
+
+    const unsigned long long gen = published_generation(shm_name);
+    if (gen != 0)
+        shm_unlink(snapshot_segment_name(shm_name, gen).c_str());
+    shm_unlink(shm_name);
+}
+
+///
+/// Attach to a snapshot published with dotenv::publish(). From then on,
+/// dotenv::getenv() and dotenv::getfile() look variables up in the snapshot
+/// first, and fall back to the environment for names it does not contain.
+///
+/// Attaching, refreshing and detaching must not run concurrently with lookups
+/// in other threads.
+///
+/// \param shm_name name of the shared memory object
+///
+/// \returns false if no valid snapshot is published under \a shm_name
+///
+DOTENV_INLINE bool dotenv::attach(const char* shm_name)
+{
+    using namespace dotenv_detail;
+
+    // a publish may retire the current segment between reading its generation
+    // and opening it, in which case the index already names a newer one
+    snapshot_state state;
+    unsigned long long gen = published_generation(shm_name);
+    while (gen != 0 && !map_snapshot(snapshot_segment_name(shm_name, gen).c_str(), state))
+    {
+        const unsigned long long latest = published_generation(shm_name);
+        if (latest == gen)
+            return false;
+        gen = latest;
+    }
+    if (gen == 0)
+        return false;
+    state.name = shm_name;
+
+    unmap_snapshot(snapshot());
+    snapshot() = state;
+    return true;
+}
+
+///
+/// Switch to a newer snapshot if one has been published since this process
+/// attached. Views returned by dotenv::getfile() are not affected, but values
+/// obtained from the old snapshot must not be used after a switch.
+///
+/// \returns true if a newer snapshot was attached
+///
+DOTENV_INLINE bool dotenv::refresh()
+{
+    using namespace dotenv_detail;
+
+    snapshot_state& state = snapshot();
+    if (!state.base)
+        return false;
+
+    const auto* header = reinterpret_cast<const snapshot_header*>(state.base);
+    if (!header->superseded.load(std::memory_order_acquire))
+        return false;
+
+    const std::string name = state.name;
+    return attach(name.c_str());
+}
+
+///
+/// Detach from the snapshot, so that lookups use the environment only.
+///
+DOTENV_INLINE void dotenv::detach()
+{
+    unmap_snapshot(snapshot());
+}
+
+///
+/// \returns the generation of the attached snapshot, starting at 1 for the
+///          first one published under its name, or 0 if not attached
+///
+DOTENV_INLINE unsigned long long dotenv::generation()
+{
+    const snapshot_state& state = snapshot();
+    return state.base ? reinterpret_cast<const snapshot_header*>(state.base)->generation : 0;
+}
+
+DOTENV_INLINE unsigned long long dotenv::published_generation(const char* shm_name)
+{
+    using namespace dotenv_detail;
+
+    const int fd = shm_open(shm_name, O_RDONLY, 0);
+    if (fd < 0)
+        return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) != sizeof(snapshot_index))
+    {
+        close(fd);
+        return 0;
+    }
+
+    void* addr = mmap(nullptr, sizeof(snapshot_index), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+        return 0;
+
+    const auto* index = static_cast<const snapshot_index*>(addr);
+    const std::uint64_t gen = index->magic.load(std::memory_order_acquire) == snapshot_index_magic
+        ? index->generation.load(std::memory_order_acquire) : 0;
+    munmap(addr, sizeof(snapshot_index));
+    return gen;
+}
+
+DOTENV_INLINE bool dotenv::map_snapshot(const char* segment, snapshot_state& state, bool writable)
+{
+    using namespace dotenv_detail;
+
+    const int fd = shm_open(segment, writable ? O_RDWR : O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(snapshot_header))
+    {
+        close(fd);
+        return false;
+    }
+
+    const size_t size = static_cast<size_t>(st.st_size);
+    void* addr = mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+        return false;
+
+    const char* base = static_cast<const char*>(addr);
+    const auto* header = static_cast<const snapshot_header*>(addr);
+    bool valid = header->magic.load(std::memory_order_acquire) == snapshot_magic
+        && header->version == snapshot_version && header->size == size
+        && header->count <= (size - sizeof(snapshot_header)) / sizeof(snapshot_entry);
+
+    // every key and value must start among the strings and end at a NUL inside
+    // the segment, so that lookups never read past it
+    if (valid && header->count > 0)
+    {
+        const auto* entries = reinterpret_cast<const snapshot_entry*>(base + sizeof(snapshot_header));
+        const size_t strings = sizeof(snapshot_header) + header->count * sizeof(snapshot_entry);
+        valid = base[size - 1] == '\0';
+        for (std::uint32_t i = 0; valid && i < header->count; ++i)
+        {
+            valid = entries[i].key >= strings && entries[i].key < size
+                && entries[i].value >= strings && entries[i].value < size;
+        }
+    }
+    if (!valid)
+    {
+        munmap(addr, size);
+        return false;
+    }
+
+    state.base = base;
+    state.size = size;
+    state.name = segment;
+    return true;
+}
+
+DOTENV_INLINE void dotenv::unmap_snapshot(snapshot_state& state)
+{
+    if (state.base)
+        munmap(const_cast<char*>(state.base), state.size);
+
+    state = snapshot_state();
+}
+
+DOTENV_INLINE const char* dotenv::snapshot_find(const snapshot_state& state, const char* name)
+{
+    const auto* header = reinterpret_cast<const snapshot_header*>(state.base);
+    const auto* entries = reinterpret_cast<const snapshot_entry*>(state.base + sizeof(snapshot_header));
+
+    // entries are sorted by key
+    size_t lo = 0;
+    size_t hi = header->count;
+    while (lo < hi)
+    {
+        const size_t mid = lo + (hi - lo) / 2;
+        const int cmp = std::strcmp(state.base + entries[mid].key, name);
+        if (cmp == 0)
+            return state.base + entries[mid].value;
+        if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return nullptr;
+}
+
+#endif // DOTENV_HAS_SHM
+
+#if defined(_MSC_VER) || defined(__MINGW32__)
+
+// https://stackoverflow.com/questions/17258029/c-setenv-undefined-identifier-in-visual-studio
+inline int setenv(const char *name, const char *value, int overwrite)
+{
+    int errcode = 0;
+
+    if (!overwrite)
+    {
+        size_t envsize = 0;
+        errcode = getenv_s(&envsize, NULL, 0, name);
+        if (errcode || envsize) return errcode;
+    }
+    return _putenv_s(name, value);
+}
+
+#endif // _MSC_VER
+
+///
+/// Look for start of variable expression in input string
+/// on the form $VARIABLE or ${VARIABLE}
+///
+/// \param str  in:  string to search in
+/// \param pos  in:  search from position
+/// \param pos  out: start tag found
+///
+/// \returns The start position of next variable expression or std::string::npos if not found
+///
+DOTENV_INLINE size_t dotenv::find_var_start(const std::string& str, size_t pos, std::string& start_tag)
+{
+   size_t p1      = str.find('$',pos);
+   size_t p2      = str.find("${",pos);
+   size_t pos_var = (std::min)(p1,p2);
+   if(pos_var != std::string::npos) start_tag = (pos_var == p2)? "${":"$";
+   return pos_var;
+}
+
+///
+/// Look for end of variable expression in input string
+/// on the form $VARIABLE or ${VARIABLE}
+///
+/// \param str  in:  string to search in
+/// \param pos  in:  search from position (result from find_var_start)
+/// \param pos  in:  start tag
+///
+/// \returns The next end position of variable expression or std::string::npos if not found
+///
+DOTENV_INLINE size_t dotenv::find_var_end(const std::string& str, size_t pos, const std::string& start_tag)
+{
+   char end_tag    = (start_tag == "${")? '}':' ';
+   size_t pos_end  = str.find(end_tag,pos);
+   // special case when $VARIABLE is at end of str with no trailing whitespace
+   if(pos_end == std::string::npos && end_tag==' ') pos_end = str.length();
+   return pos_end;
+}
+
+// trim whitespace from left (in place)
+DOTENV_INLINE void dotenv::ltrim(std::string& s) {
+    s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](int c) {return !std::isspace(c); }));
+}
+
+// trim whitespace from right (in place)
+DOTENV_INLINE void dotenv::rtrim(std::string& s) {
+    s.erase(std::find_if(s.rbegin(), s.rend(), [](int c) {return !std::isspace(c); }).base(), s.end());
+}
+
+// trim both ends (in place)
+DOTENV_INLINE void dotenv::trim(std::string& s) {
+    ltrim(s);
+    rtrim(s);
+}
+
+// trim from both ends (copying)
+DOTENV_INLINE std::string dotenv::trim_copy(std::string s) {
+    trim(s);
+    return s;
+}
+
+///
+/// Resolve variables of the form $VARIABLE or ${VARIABLE} in a string
+///
+/// \param iline line number in .env file
+/// \param str   the string to be resolved, containing 0 or more variables
+/// \param ok    true on return if no variables found or all variables resolved ok
+///
+/// \returns pair with <resolved, true> if ok, or <partial, false> if error
+///
+DOTENV_INLINE std::pair<std::string, bool> dotenv::resolve_vars(size_t iline, const std::string& str)
+{
+   std::string resolved;
+
+   size_t pos = 0;
+   size_t pre_pos = pos;
+   size_t nvar = 0;
+
+   bool finished=false;
+   while(!finished)
+   {
+      // look for start of variable expression after pos
+      std::string start_tag;
+      pos = find_var_start(str,pos,start_tag);
+      if(pos != std::string::npos)
+      {
+         // a variable definition detected
+         nvar++;
+
+         // keep start of variable expression
+         size_t pos_start = pos;
+
+         size_t lstart = start_tag.length();  // length of start tag
+         size_t lend   = (lstart>1)? 1 : 0;   // length of end tag
+
+         // add substring since last variable
+         resolved += str.substr(pre_pos,pos-pre_pos);
+
+         // look for end of variable expression
+         pos = find_var_end(str,pos,start_tag);
+         if(pos != std::string::npos)
+         {
+            // variable name with decoration
+            std::string var = str.substr(pos_start,pos-pos_start+1);
+
+            // variable name without decoration
+            std::string env_var = var.substr(lstart,var.length()-lstart-lend);
+
+            // remove possible whitespace at the end
+            rtrim(env_var);
+
+            // evaluate environment variable
+            if(const char* env_str = std::getenv(env_var.c_str()))
+            {
+               resolved += env_str;
+               nvar--; // decrement to indicate variable resolved
+            }
+            else
+            {
+               // could not resolve the variable, so don't decrement
+               std::printf("dotenv: Variable %s is not defined on line %u\n", var.c_str(), static_cast<unsigned>(iline));
+               std::fflush(stdout);
+            }
+
+            // skip end tag
+            pre_pos = pos+lend;
+         }
+      }
+      else {
+         // no more variables
+         finished = true;
+      }
+   }
+
+   // add possible trailing non-whitespace after last variable
+   if(pre_pos < str.length())
+   {
+      resolved += str.substr(pre_pos);
+   }
+
+   // nvar must be 0, or else we have an error
+   return std::make_pair(resolved,(nvar==0));
+}
+
+DOTENV_INLINE void dotenv::do_init(int flags, const char* filename, snapshot_builder* snapshot)
+{
+    std::string contents;
+    std::string line;
+
+    if (flags & dotenv::Profile)
+        enable_profiling();
+
+    if (read_file(filename, contents))
+    {
+        const std::string directory = env_directory(filename);
+        unsigned int i = 1;
+        size_t start = 0;
+
+        while (start < contents.length())
+        {
+            size_t end = contents.find('\n', start);
+            if (end == std::string::npos)
+                end = contents.length();
+            line.assign(contents, start, end - start);
+            start = end + 1;
+
+            const auto len = line.length();
+            if (len == 0 || line[0] == '#') {
+                continue;
+            }
+
+            const auto pos = line.find("=");
+
+            if (pos == std::string::npos) {
+                std::printf("dotenv: Ignoring ill-formed assignment on line %u: '%s'\n", i, line.c_str());
+                std::fflush(stdout);
+            } else {
+                auto name = trim_copy(line.substr(0, pos));
+                auto line_stripped = strip_quotes(trim_copy(line.substr(pos + 1)));
+
+                // resolve any contained variable expressions in 'line_stripped'
+                auto p = resolve_vars(i,line_stripped);
+                bool ok = p.second;
+                if(!ok) {
+                   std::printf("dotenv: Ignoring ill-formed assignment on line %u: '%s'\n", i, line.c_str());
+                   std::fflush(stdout);
+                }
+                else {
+
+                   // variable resolved ok, set as environment variable
+                   const auto& val = p.first;
+                   const bool assigned = (~flags & dotenv::Preserve) || !std::getenv(name.c_str());
+                   setenv(name.c_str(), val.c_str(), ~flags & dotenv::Preserve);
+                   if (assigned)
+                       record_directory(name, val, directory);
+
+                   if (snapshot && std::find(snapshot->names.begin(), snapshot->names.end(), name) == snapshot->names.end())
+                       snapshot->names.push_back(name);
+                }
+            }
+            ++i;
+        }
+    }
+}
+
+// Remembers the directory a relative file reference assigned to \a name is
+// resolved against, or forgets it once \a name holds anything else.
+DOTENV_INLINE void dotenv::record_directory(const std::string& name, const std::string& value,
+                                            const std::string& directory)
+{
+    file_registry& registry = files();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    if (value.size() > 1 && value[0] == '@' && dotenv_detail::is_relative_path(value.c_str() + 1))
+        registry.directories[name] = directory;
+    else
+        registry.directories.erase(name);
+}
+
+DOTENV_INLINE std::string dotenv::strip_quotes(const std::string& str)
+{
+    const std::size_t len = str.length();
+
+    if (len < 2)
+        return str;
+
+    const char first = str[0];
+    const char last = str[len - 1];
+
+    if (first == last && ('"' == first || '\'' == first))
+        return str.substr(1, len - 2);
+
+    return str;
+}
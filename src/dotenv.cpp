@@ -0,0 +1,6 @@
+// Compiled definitions for the dotenv_impl library. Programs linking against
+// dotenv_impl include dotenv_core.h (or dotenv.h, which then skips the inline
+// definitions) and share this single copy.
+
+#define DOTENV_INLINE
+#include "dotenv_impl.h"
@@ -1,6 +1,9 @@
 #include <gtest/gtest.h>
 #include <dotenv.h>
 
+#include <fstream>
+#include <sstream>
+
 class BaseTestFixture : public ::testing::Test {
 protected:
     void SetUp() override {
@@ -29,7 +32,7 @@ TEST_F(BaseTestFixture, VariableReferenceExpansion) {
 
 TEST(DotenvPreserveTest, PreserveExistingVariable) {
     // 设置已有环境变量
-    _putenv("PRESERVE_TEST=original");
+    setenv("PRESERVE_TEST", "original", 1);
 
     // 创建临时.env文件
     std::ofstream env_file(".env.preserve_test");
@@ -68,4 +71,267 @@ TEST(DotenvErrorTest, MalformedLineIgnored) {
     ASSERT_STREQ(std::getenv("ANOTHER_VALID"), "value2");
 
     remove(".env.malformed");
-}
\ No newline at end of file
+}
+TEST(DotenvFileReferenceTest, ReferencedFileIsMapped) {
+    std::ofstream blob(".env.blob_test", std::ios::binary);
+    blob << "-----BEGIN CERTIFICATE-----\nMIIB\n-----END CERTIFICATE-----\n";
+    blob.close();
+
+    std::ofstream env_file(".env.fileref");
+    env_file << "CERT=@.env.blob_test\n";
+    env_file.close();
+
+    dotenv::init(".env.fileref");
+
+    // 环境变量中只保存引用本身
+    ASSERT_STREQ(std::getenv("CERT"), "@.env.blob_test");
+
+    const auto first = dotenv::getfile("CERT");
+    ASSERT_EQ(first, "-----BEGIN CERTIFICATE-----\nMIIB\n-----END CERTIFICATE-----\n");
+
+    // 同一文件只映射一次
+    const auto second = dotenv::getfile("CERT");
+    ASSERT_EQ(first.data(), second.data());
+
+    remove(".env.fileref");
+    remove(".env.blob_test");
+}
+
+TEST(DotenvFileReferenceTest, PlainOrMissingReferenceYieldsEmptyView) {
+    std::ofstream env_file(".env.fileref_missing");
+    env_file << "PLAIN_VALUE=hello\n";
+    env_file << "MISSING_REF=@does/not/exist.pem\n";
+    env_file.close();
+
+    dotenv::init(".env.fileref_missing");
+
+    ASSERT_TRUE(dotenv::getfile("PLAIN_VALUE").empty());
+    ASSERT_TRUE(dotenv::getfile("MISSING_REF").empty());
+    ASSERT_TRUE(dotenv::getfile("UNDEFINED_REF").empty());
+
+    remove(".env.fileref_missing");
+}
+
+#ifndef _WIN32
+
+#include <sys/stat.h>
+
+TEST(DotenvFileReferenceTest, RelativeReferenceIsResolvedAgainstEnvFileDirectory) {
+    mkdir("envdir_test", 0755);
+    std::ofstream blob("envdir_test/relative.pem", std::ios::binary);
+    blob << "relative contents";
+    blob.close();
+
+    std::ofstream env_file("envdir_test/.env");
+    env_file << "RELATIVE_CERT=@relative.pem\n";
+    env_file.close();
+
+    // 从另一个目录加载时，引用相对于 .env 文件所在目录解析
+    dotenv::init("envdir_test/.env");
+
+    ASSERT_STREQ(std::getenv("RELATIVE_CERT"), "@relative.pem");
+    ASSERT_EQ(dotenv::getfile("RELATIVE_CERT"), "relative contents");
+
+    remove("envdir_test/.env");
+    remove("envdir_test/relative.pem");
+    rmdir("envdir_test");
+}
+
+#endif
+
+TEST(DotenvProfileTest, ReadsAreCountedPerKey) {
+    std::ofstream env_file(".env.profile");
+    env_file << "PROFILED_HOT=1\n";
+    env_file << "PROFILED_COLD=2\n";
+    env_file.close();
+
+    dotenv::init(dotenv::Profile, ".env.profile");
+
+    for (int i = 0; i < 5; ++i)
+        dotenv::getenv("PROFILED_HOT");
+    dotenv::getenv("PROFILED_COLD");
+
+    const auto report = dotenv::profile_report();
+
+    // 读取次数多的键排在前面
+    const auto hot = report.find("PROFILED_HOT");
+    const auto cold = report.find("PROFILED_COLD");
+    ASSERT_NE(hot, std::string::npos);
+    ASSERT_NE(cold, std::string::npos);
+    ASSERT_LT(hot, cold);
+
+    remove(".env.profile");
+}
+
+TEST(DotenvProfileTest, EachCallSiteIsRecorded) {
+    std::ofstream env_file(".env.profile_sites");
+    env_file << "PROFILED_SITES=1\n";
+    env_file.close();
+
+    dotenv::init(dotenv::Profile, ".env.profile_sites");
+
+    // 两个不同的调用点，即使在头文件模式下也应分别记录
+    dotenv::getenv("PROFILED_SITES");
+    dotenv::getenv("PROFILED_SITES");
+
+    const auto report = dotenv::profile_report();
+    const auto key = report.find("PROFILED_SITES\n");
+    ASSERT_NE(key, std::string::npos);
+
+    std::istringstream lines(report.substr(key));
+    std::string line;
+    std::getline(lines, line);
+    int sites = 0;
+    while (std::getline(lines, line) && line.find(" at ") != std::string::npos)
+        ++sites;
+    ASSERT_EQ(sites, 2);
+
+    remove(".env.profile_sites");
+}
+
+#ifdef DOTENV_HAS_SHM
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+TEST(DotenvSnapshotTest, WorkersReadPublishedSnapshot) {
+    const std::string shm_name = "/dotenv_test_" + std::to_string(getpid());
+
+    std::ofstream env_file(".env.snapshot");
+    env_file << "SNAPSHOT_BASE=shared\n";
+    env_file << "SNAPSHOT_EXPANDED=${SNAPSHOT_BASE} config\n";
+    env_file.close();
+
+    ASSERT_TRUE(dotenv::publish(shm_name.c_str(), ".env.snapshot"));
+
+    // 模拟 worker：环境中已没有这些变量，只能从共享内存读取
+    unsetenv("SNAPSHOT_BASE");
+    unsetenv("SNAPSHOT_EXPANDED");
+
+    ASSERT_TRUE(dotenv::attach(shm_name.c_str()));
+    ASSERT_EQ(dotenv::generation(), 1u);
+    ASSERT_EQ(dotenv::getenv("SNAPSHOT_BASE"), "shared");
+    ASSERT_EQ(dotenv::getenv("SNAPSHOT_EXPANDED"), "shared config");
+    ASSERT_EQ(dotenv::getenv("SNAPSHOT_MISSING", "none"), "none");
+
+    // 重新发布后，worker 在 refresh() 之前仍看到旧快照
+    std::ofstream update(".env.snapshot");
+    update << "SNAPSHOT_BASE=updated\n";
+    update.close();
+
+    ASSERT_TRUE(dotenv::publish(shm_name.c_str(), ".env.snapshot"));
+    unsetenv("SNAPSHOT_BASE");
+
+    ASSERT_EQ(dotenv::getenv("SNAPSHOT_BASE"), "shared");
+    ASSERT_TRUE(dotenv::refresh());
+    ASSERT_FALSE(dotenv::refresh());
+    ASSERT_EQ(dotenv::generation(), 2u);
+    ASSERT_EQ(dotenv::getenv("SNAPSHOT_BASE"), "updated");
+
+    dotenv::detach();
+    ASSERT_EQ(dotenv::generation(), 0u);
+    ASSERT_EQ(dotenv::getenv("SNAPSHOT_BASE", "none"), "none");
+
+    dotenv::unpublish(shm_name.c_str());
+    ASSERT_FALSE(dotenv::attach(shm_name.c_str()));
+
+    remove(".env.snapshot");
+}
+
+TEST(DotenvSnapshotTest, AttachRejectsDamagedSnapshot) {
+    const std::string shm_name = "/dotenv_damaged_" + std::to_string(getpid());
+
+    std::ofstream env_file(".env.damaged");
+    env_file << "DAMAGED_KEY=value\n";
+    env_file.close();
+    ASSERT_TRUE(dotenv::publish(shm_name.c_str(), ".env.damaged"));
+    unsetenv("DAMAGED_KEY");
+
+    // 直接改写第一代快照所在的共享内存对象
+    const std::string segment = shm_name + ".1";
+    const int fd = shm_open(segment.c_str(), O_RDWR, 0);
+    ASSERT_GE(fd, 0);
+    struct stat st;
+    ASSERT_EQ(fstat(fd, &st), 0);
+    const size_t size = static_cast<size_t>(st.st_size);
+    char* base = static_cast<char*>(mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    close(fd);
+    ASSERT_NE(base, MAP_FAILED);
+    ASSERT_TRUE(dotenv::attach(shm_name.c_str()));
+    dotenv::detach();
+
+    // 指向段外的键偏移
+    const std::string key("DAMAGED_KEY", sizeof("DAMAGED_KEY"));
+    const std::uint32_t key_offset = static_cast<std::uint32_t>(
+        std::search(base, base + size, key.begin(), key.end()) - base);
+    char* entry = std::search(base, base + key_offset, reinterpret_cast<const char*>(&key_offset),
+                              reinterpret_cast<const char*>(&key_offset) + sizeof(key_offset));
+    ASSERT_NE(entry, base + key_offset);
+    const std::uint32_t outside = static_cast<std::uint32_t>(size) + 100;
+    std::memcpy(entry, &outside, sizeof(outside));
+    ASSERT_FALSE(dotenv::attach(shm_name.c_str()));
+    std::memcpy(entry, &key_offset, sizeof(key_offset));
+    ASSERT_TRUE(dotenv::attach(shm_name.c_str()));
+    dotenv::detach();
+
+    // 最后一个值没有以 NUL 结尾
+    base[size - 1] = 'x';
+    ASSERT_FALSE(dotenv::attach(shm_name.c_str()));
+    ASSERT_EQ(dotenv::getenv("DAMAGED_KEY", "none"), "none");
+
+    munmap(base, size);
+    dotenv::unpublish(shm_name.c_str());
+    remove(".env.damaged");
+}
+
+TEST(DotenvSnapshotTest, AttachDuringRepublishFindsCompleteSnapshot) {
+    const std::string shm_name = "/dotenv_republish_" + std::to_string(getpid());
+
+    std::ofstream env_file(".env.republish");
+    env_file << "REPUBLISH_A=first value\n";
+    env_file << "REPUBLISH_B=second value\n";
+    env_file.close();
+    ASSERT_TRUE(dotenv::publish(shm_name.c_str(), ".env.republish"));
+    unsetenv("REPUBLISH_A");
+    unsetenv("REPUBLISH_B");
+
+    // 子进程不断重新发布，父进程同时反复 attach
+    const pid_t child = fork();
+    ASSERT_GE(child, 0);
+    if (child == 0)
+    {
+        bool ok = true;
+        for (int i = 0; i < 300 && ok; ++i)
+            ok = dotenv::publish(shm_name.c_str(), ".env.republish");
+        _exit(ok ? 0 : 1);
+    }
+
+    int status = 0;
+    int attaches = 0;
+    while (waitpid(child, &status, WNOHANG) == 0)
+    {
+        ASSERT_TRUE(dotenv::attach(shm_name.c_str()));
+        ASSERT_EQ(dotenv::getenv("REPUBLISH_A"), "first value");
+        ASSERT_EQ(dotenv::getenv("REPUBLISH_B"), "second value");
+        ++attaches;
+    }
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(WEXITSTATUS(status), 0);
+    ASSERT_GT(attaches, 0);
+
+    ASSERT_TRUE(dotenv::attach(shm_name.c_str()));
+    ASSERT_EQ(dotenv::generation(), 301u);
+    dotenv::detach();
+
+    dotenv::unpublish(shm_name.c_str());
+    remove(".env.republish");
+}
+
+#endif // DOTENV_HAS_SHM